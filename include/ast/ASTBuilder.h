@@ -3,10 +3,7 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <utility>
-#include <regex>
-#include <functional>
 
 #include "pt/ParseTree.h"
 #include "ast/Instructions.h"
@@ -14,23 +11,22 @@
 
 class ASTBuilder {
 public:
-    ASTBuilder();
+    ASTBuilder() = default;
     ~ASTBuilder() = default;
     ASTBuilder(const ASTBuilder&) = delete;
     ASTBuilder& operator=(const ASTBuilder&) = delete;
 
     void buildAST(PT::PTNode* parseTree, AST::AbstractSyntaxTree* abstractSyntaxTree);
+    // Build a single instruction node (and its operands) from a PT instruction node
+    AST::InstructionNode* buildInstruction(PT::PTNode* PTInstructionNode, AST::AbstractSyntaxTree* abstractSyntaxTree, int line);
 
 private:
-    using InstructionFactory = std::function<AST::InstructionNode*(const std::string&, int)>;
-    std::unordered_map<ASTConstants::InstructionType, InstructionFactory> instructionFactoryMap;
+    // Node factories, looked up in static tables indexed by node type
+    using InstructionFactory = AST::InstructionNode* (*)(const std::string&, int);
+    using OperandFactory = AST::OperandNode* (*)(const std::string&, int line, short int pos);
 
-    using OperandFactory = std::function<AST::OperandNode*(const std::string&, int line, short int pos)>;
-    std::unordered_map<ASTConstants::OperandType, OperandFactory> operandFactoryMap;
-
-    void initializeFactoryMaps();
-    AST::InstructionNode* instructionBuilder(ASTConstants::InstructionType nodeType, const std::string& value, int line);
-    AST::OperandNode* operandBuilder(ASTConstants::OperandType nodeType, const std::string& value, int line, short int pos);
+    static AST::InstructionNode* instructionBuilder(ASTConstants::InstructionType nodeType, const std::string& value, int line);
+    static AST::OperandNode* operandBuilder(ASTConstants::OperandType nodeType, const std::string& value, int line, short int pos);
 };
 
 #endif // STARTASM_ASTBUILDER_H
@@ -2,9 +2,9 @@
 #define ABSTRACTSYNTAXTREE_H
 
 #include <vector>
-#include <unordered_map>
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <mutex>
 #include "pt/ParseTree.h"
@@ -32,7 +32,7 @@ namespace AST {
         virtual void accept(Visitor& visitor) = 0;
 
         //Getters
-        std::string getNodeValue() const { return m_nodeValue; }
+        const std::string& getNodeValue() const { return m_nodeValue; }
         ASTConstants::NodeType getNodeType() const { return m_nodeType; }
         int getNumChildren() const { return static_cast<int>(m_children.size()); }
         const std::vector<ASTNode*>& getChildren() const { return m_children; }
@@ -118,17 +118,18 @@ namespace AST {
         AbstractSyntaxTree();
         ~AbstractSyntaxTree();
         ASTNode* getRoot();
-        ASTConstants::InstructionType getInstructionType(const std::string &instruction);
+        static ASTConstants::InstructionType getInstructionType(std::string_view instruction);
         ASTConstants::NumOperands getNumOperands(int num);
         ASTConstants::OperandType convertOperandType(PTConstants::OperandType type);
         void printTree() const;
 
         //JSON serialization for the entire tree
         nlohmann::json toJson() const;
+        //Binary serialization for the entire tree (see BinaryAST.h for the layout)
+        std::string toBinary() const;
 
     private:
         ASTNode* m_root;
-        std::unordered_map<std::string, ASTConstants::InstructionType> m_instructionDictionary;
         mutable std::mutex m_mutex;
 
         void printNode(const ASTNode* node, int level) const;
@@ -0,0 +1,119 @@
+#ifndef STARTASM_BINARYAST_H
+#define STARTASM_BINARYAST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "ast/AbstractSyntaxTree.h"
+
+namespace BinaryASTConstants {
+    constexpr char MAGIC[8] = {'S', 'A', 'S', 'M', 'A', 'S', 'T', '\0'};
+    // Bumped whenever the layout changes - readers reject any other version
+    constexpr std::uint32_t VERSION = 1;
+}
+
+namespace AST {
+    // Binary AST layout (little-endian, fixed-size fields):
+    //   BinaryHeader | BinaryNode[numNodes] | BinaryString[numStrings] | characters
+    // Every reference is an index into a table or an offset from the start of the file, so a file can be mapped at any
+    // address and walked in place. Nodes are stored breadth first, so the children of a node are consecutive records.
+    struct BinaryHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t nodeSize;
+        std::uint32_t numNodes;
+        std::uint32_t numStrings;
+        std::uint64_t nodesOffset;
+        std::uint64_t stringsOffset;
+        std::uint64_t charactersOffset;
+        std::uint64_t fileSize;
+    };
+
+    struct BinaryNode {
+        std::uint8_t nodeType;
+        // InstructionType of instructions, OperandType of operands
+        std::uint8_t kind;
+        // NumOperands of instructions, position of operands
+        std::int16_t detail;
+        std::int32_t line;
+        std::uint32_t firstChild;
+        std::uint32_t numChildren;
+        // Index of the node value in the string table (values are deduplicated)
+        std::uint32_t value;
+    };
+
+    struct BinaryString {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(BinaryHeader) == 56 && sizeof(BinaryNode) == 20 && sizeof(BinaryString) == 16, "Binary AST records must not change size");
+
+    // Zero-copy reader over a binary AST, either mapped from a file or borrowed from a caller's buffer
+    // Opening only checks that every table and reference lies inside the buffer - nothing is parsed or copied
+    class BinaryAST {
+    public:
+        // Lightweight handle to a node record
+        class Node {
+        public:
+            ASTConstants::NodeType getNodeType() const { return static_cast<ASTConstants::NodeType>(m_record->nodeType); }
+            ASTConstants::InstructionType getInstructionType() const { return static_cast<ASTConstants::InstructionType>(m_record->kind); }
+            ASTConstants::OperandType getOperandType() const { return static_cast<ASTConstants::OperandType>(m_record->kind); }
+            ASTConstants::NumOperands getNumOperands() const { return static_cast<ASTConstants::NumOperands>(m_record->detail); }
+            short int getPos() const { return m_record->detail; }
+            int getLine() const { return m_record->line; }
+            std::string_view getNodeValue() const { return m_tree->string(m_record->value); }
+            int getNumChildren() const { return static_cast<int>(m_record->numChildren); }
+            Node childAt(int index) const { return m_tree->node(m_record->firstChild + index); }
+
+        private:
+            friend class BinaryAST;
+            Node(const BinaryAST* tree, const BinaryNode* record) : m_tree(tree), m_record(record) {}
+
+            const BinaryAST* m_tree;
+            const BinaryNode* m_record;
+        };
+
+        ~BinaryAST();
+        BinaryAST(const BinaryAST&) = delete;
+        BinaryAST& operator=(const BinaryAST&) = delete;
+
+        // Map a binary AST file, nullptr with the reason in error if it can't be read or is malformed
+        static std::unique_ptr<BinaryAST> open(const std::string& pathname, std::string& error);
+        // Read a binary AST in place from a buffer that must outlive the reader (and be 8-byte aligned)
+        // The per-node checks (linear in the size of the tree) may only be skipped for buffers this compiler wrote itself
+        static std::unique_ptr<BinaryAST> fromBuffer(const void* data, std::size_t size, std::string& error, bool checkNodes = true);
+
+        // Serialize a tree into the binary layout
+        static std::string serialize(const ASTNode* root);
+
+        Node getRoot() const { return node(0); }
+        int getNumNodes() const { return static_cast<int>(m_header->numNodes); }
+        Node node(std::uint32_t index) const { return {this, m_nodes + index}; }
+
+    private:
+        BinaryAST(const char* data, std::size_t size, bool mapped);
+
+        // Check the header and every reference, so walking the tree afterwards can never leave the buffer
+        bool validate(std::string& error, bool checkNodes);
+
+        std::string_view string(std::uint32_t index) const {
+            const BinaryString& entry = m_strings[index];
+            return {m_characters + entry.offset, entry.length};
+        }
+
+        const char* m_data;
+        std::size_t m_size;
+        bool m_mapped;
+        const BinaryHeader* m_header;
+        const BinaryNode* m_nodes;
+        const BinaryString* m_strings;
+        const char* m_characters;
+    };
+}
+
+#endif //STARTASM_BINARYAST_H
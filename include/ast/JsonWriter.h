@@ -0,0 +1,65 @@
+#ifndef STARTASM_JSONWRITER_H
+#define STARTASM_JSONWRITER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "ast/AbstractSyntaxTree.h"
+#include "ast/BinaryAST.h"
+
+namespace AST {
+    // Streams the JSON form of an AST straight from the nodes into a buffered sink, with the same schema and formatting
+    // as toJson().dump(4). No JSON document is built, so memory stays constant whatever the size of the program, and the
+    // sink receives output as soon as the first buffer fills.
+    // Either a whole tree or only the instructions on a range of lines is written, from an in-memory or a binary AST.
+    // With several jobs, the root's children are serialized in parallel chunks, a window of chunks at a time, and each
+    // window is handed to the sink as one ordered list of buffers.
+    class JsonWriter {
+    public:
+        // Receives count buffers to be output in order, for instance with a single writev
+        using Sink = std::function<void(const std::string_view* buffers, std::size_t count)>;
+        static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+        // Root children serialized by one parallel task
+        static constexpr std::size_t CHUNK_NODES = 256;
+
+        explicit JsonWriter(Sink sink);
+        ~JsonWriter();
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator=(const JsonWriter&) = delete;
+
+        // Write a whole tree, without a trailing newline
+        void write(const ASTNode* root);
+        // Write a tree keeping only the root's children (instructions) on code lines [firstLine, lastLine]
+        // Instructions are stored in line order, so finding them is a binary search and the cost only depends on the range
+        void writeLines(const ASTNode* root, int firstLine, int lastLine);
+        void writeLines(const BinaryAST& tree, int firstLine, int lastLine);
+        // Hand any buffered output to the sink
+        void flush();
+
+    private:
+        // Nodes are either in-memory nodes (const ASTNode*) or binary AST nodes (BinaryAST::Node)
+        // Write the root with its children [begin, end), in parallel chunks when worthwhile
+        template <typename Node>
+        void writeRoot(const Node& root, int begin, int end);
+        template <typename Node>
+        void writeChunked(const Node& root, int begin, int end);
+        // Write a node with its children [begin, end), its opening brace sitting at the given nesting depth
+        template <typename Node>
+        void writeNode(const Node& node, int depth, int begin, int end);
+        // Write the members following "children" and close the node
+        template <typename Node>
+        void writeMembers(const Node& node, int depth);
+        void writeIndent(int depth);
+        // Start a member that follows another one
+        void writeKey(int depth, std::string_view key);
+        void writeInteger(long long value);
+        void writeString(std::string_view value);
+
+        Sink m_sink;
+        std::string m_buffer;
+    };
+}
+
+#endif //STARTASM_JSONWRITER_H
@@ -0,0 +1,53 @@
+#ifndef STARTASM_COMPILECACHE_H
+#define STARTASM_COMPILECACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "diagnostics/Diagnostics.h"
+
+namespace CacheConstants {
+    //Bumped whenever the layout of an entry changes
+    constexpr std::uint32_t FORMAT_VERSION = 2;
+}
+
+//Cached result of a compilation - the output of the target artifact and every diagnostic reported
+struct CacheEntry {
+    bool success = false;
+    //Output of the target artifact - once loaded, a view into the mapped entry (8-byte aligned)
+    std::string_view output;
+    std::vector<Diagnostic> diagnostics;
+    //Keeps the mapped entry alive for as long as the output is used
+    std::shared_ptr<const void> mapping;
+};
+
+//Content-addressed cache of compilation results
+//Entries are keyed by a hash of the source text, the options that change the result and the identity of the compiler
+//build, so entries never need invalidating - any change simply maps to a different entry
+class CompileCache {
+    public:
+        //An empty directory selects the default one
+        explicit CompileCache(std::string directory);
+        ~CompileCache() = default;
+
+        //Per-user cache directory ($XDG_CACHE_HOME/startasm or ~/.cache/startasm), created on demand, empty if there is none
+        static std::string userCacheDirectory();
+
+        //Key of a compilation - configuration lists the result-changing options, buildFiles the compiler binaries involved
+        [[nodiscard]] static std::string key(std::string_view source, const std::string& configuration, const std::vector<std::string>& buildFiles);
+
+        //Look up an entry, false on a miss or an unreadable entry
+        bool load(const std::string& key, std::string_view source, CacheEntry& entry) const;
+        //Store an entry atomically - failures are ignored, as the cache is only an optimization
+        void store(const std::string& key, std::string_view source, const CacheEntry& entry) const;
+
+    private:
+        [[nodiscard]] std::string entryPath(const std::string& key) const;
+
+        std::string m_directory;
+};
+
+#endif //STARTASM_COMPILECACHE_H
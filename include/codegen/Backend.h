@@ -0,0 +1,63 @@
+#ifndef STARTASM_BACKEND_H
+#define STARTASM_BACKEND_H
+
+#include <memory>
+#include <string>
+
+#include "ast/AbstractSyntaxTree.h"
+#include "typeinfer/TypeInference.h"
+
+class Backend;
+
+namespace BackendConstants {
+    //File name of the LLVM backend module, installed next to the executable
+    constexpr const char* MODULE_NAME = "libstartasm-llvm.so";
+    //Name of the factory function exported by the module
+    constexpr const char* FACTORY_SYMBOL = "startasmCreateBackend";
+    //File name of the runtime library bitcode linked into generated modules, installed next to the executable
+    constexpr const char* RUNTIME_NAME = "startasm-runtime.bc";
+    //File name of the runtime library compiled to a native object instead, by builds without clang
+    constexpr const char* RUNTIME_OBJECT_NAME = "startasm-runtime.o";
+    //Files the optimized module can be written to - textual IR, bitcode, assembly, an object or a linked executable
+    enum EmitFormat {NO_EMIT, LL, BC, ASM, OBJ, EXE};
+    //Runtime checks generated - failing with the line and a message, trapping without either, or none at all
+    enum Checks {FULL_CHECKS, FAST_CHECKS, NO_CHECKS};
+}
+
+//Signature of the factory function exported by the module
+using BackendFactory = Backend* (*)();
+
+//Code generation backend interface
+//The LLVM implementation lives in a separately loaded module, so LLVM is only loaded and initialized once code generation runs
+class Backend {
+    public:
+        virtual ~Backend() = default;
+
+        //Load the backend module (once per process) and create a backend, nullptr with the reason in error if unavailable
+        static std::unique_ptr<Backend> load(std::string& error);
+        //Path the backend module is loaded from first
+        static std::string modulePath();
+        //Path of the runtime library bitcode
+        static std::string runtimePath();
+        //Path of the runtime library native object
+        static std::string runtimeObjectPath();
+
+        //Generate IR for the AST with the given runtime checks, returning false if the generated module is invalid
+        //Type checks the inferred register types always pass are left out
+        virtual bool generateIR(AST::AbstractSyntaxTree* AST, const TypeInference& types, BackendConstants::Checks checks) = 0;
+        //Run the standard optimization pipeline of the level (0 to 3) over the generated IR
+        //Returns the time taken by each pass when timePasses is set, an empty report otherwise
+        virtual std::string optimize(int level, bool timePasses) = 0;
+        //Textual form of the generated IR
+        virtual std::string getIR() = 0;
+        //Write the optimized module to a file in the format, executables being linked with the system C compiler
+        //Returns false with the reason in error if it could not be written
+        virtual bool emit(BackendConstants::EmitFormat format, const std::string& path, std::string& error) = 0;
+        //JIT compile the program and run it in this process, each region between labels and branches being generated
+        //and compiled (at the optimization level) only once the program reaches it, so start up does not depend on its size
+        //Returns false with the reason in error if the JIT could not be set up, otherwise the program's exit code
+        virtual bool execute(AST::AbstractSyntaxTree* AST, const TypeInference& types, int level,
+                             BackendConstants::Checks checks, int& exitCode, std::string& error) = 0;
+};
+
+#endif //STARTASM_BACKEND_H
@@ -5,13 +5,42 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Target/TargetMachine.h>
+#include <array>
+#include <initializer_list>
 #include <memory>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "ast/Visitor.h"
 #include "ast/AbstractSyntaxTree.h"
+#include "codegen/Backend.h"
+#include "runtime/Runtime.h"
 
-class CodeGenerator : public AST::Visitor {
+namespace CodeGenConstants {
+    //Flags set by compare
+    enum Flag {GREATER, LESS, EQUAL, ZERO, NUM_FLAGS};
+    enum Constants {
+        //Values the stack holds (push, pop, call and return)
+        STACK_SIZE = 1 << 16,
+        //Smallest number of lines worth generating on a thread of its own
+        PARTITION_LINES = 1 << 14,
+        //Most partitions a program is split into
+        MAX_PARTITIONS = 16
+    };
+}
+
+//LLVM backend - built into the backend module together with LLVM, never linked into the executable
+//The program is lowered into main, with a basic block per region between jump targets and branches.
+//Every value is a (type, 32 bit payload) pair and is type checked at runtime, failing with the offending line - unless
+//type inference found the register to always hold a single type there, which makes its type a constant and the check fold.
+//Large programs are split into partitions lowered and optimized in parallel, each a function of its own run in turn by
+//main. When run, regions are instead lowered and JIT compiled one function at a time, as the program first reaches them.
+class CodeGenerator : public Backend, public AST::Visitor {
     public:
         CodeGenerator();
         ~CodeGenerator() = default;
@@ -33,6 +62,7 @@ class CodeGenerator : public AST::Visitor {
         void visit(AST::DivideInstruction& node) override;
         void visit(AST::OrInstruction& node) override;
         void visit(AST::AndInstruction& node) override;
+        void visit(AST::NotInstruction& node) override;
         void visit(AST::ShiftInstruction& node) override;
         void visit(AST::CompareInstruction& node) override;
         void visit(AST::JumpInstruction& node) override;
@@ -61,12 +91,148 @@ class CodeGenerator : public AST::Visitor {
         void visit(AST::ShiftConditionOperand& node) override;
         void visit(AST::JumpConditionOperand& node) override;
 
-        void printIR();
+        //Backend interface
+        bool generateIR(AST::AbstractSyntaxTree* AST, const TypeInference& types, BackendConstants::Checks checks) override;
+        std::string optimize(int level, bool timePasses) override;
+        bool execute(AST::AbstractSyntaxTree* AST, const TypeInference& types, int level, BackendConstants::Checks checks,
+                     int& exitCode, std::string& error) override;
+        std::string getIR() override;
+        bool emit(BackendConstants::EmitFormat format, const std::string& path, std::string& error) override;
 
     private:
-        llvm::LLVMContext context;
+        //A (type, payload) pair
+        using Value = std::pair<llvm::Value*, llvm::Value*>;
+
+        //Module setup
+        void createModule(const std::string& name);
+        void declareRuntime();
+        void defineState(bool define);
+        //Link the runtime library into the module, or only declare its functions if the build has no bitcode of it
+        void defineRuntime();
+        bool linkRuntime();
+
+        //Registers and flags are locals of the function being lowered, copied from and to the saved state around regions
+        void createLocals();
+        void saveLocals();
+
+        //Registers, flags and the stack
+        Value loadRegister(const AST::ASTNode* node);
+        void storeRegister(const AST::ASTNode* node, Value value);
+        Value loadValue(llvm::Value* pointer);
+        void storeValue(llvm::Value* pointer, Value value);
+        void push(Value value);
+        Value pop();
+
+        //Address operands - literal addresses or registers holding one
+        llvm::Value* memoryCell(const AST::ASTNode* node);
+        //Block continuing at a line (a region returning it when running lazily)
+        llvm::BasicBlock* lineBlock(int line);
+        llvm::BasicBlock* jumpTarget(const AST::ASTNode* node);
+        void dispatch(llvm::Value* address);
+
+        //Runtime checks, failing with the current line and the message when the condition is false (trapping with
+        //fast checks, and assumed to hold without checks)
+        void check(llvm::Value* condition, const std::string& message);
+        llvm::Value* isType(llvm::Value* type, std::initializer_list<RuntimeConstants::ValueType> types);
+        //Check the first two operands hold the same type, one of the given ones (described for the error)
+        void checkOperands(const AST::InstructionNode& node, Value a, Value b,
+                           std::initializer_list<RuntimeConstants::ValueType> types, const std::string& description);
+        //Float or integer form of a result, only generating the one the type needs when it is known
+        llvm::Value* byType(llvm::Value* isFloat, llvm::function_ref<llvm::Value*()> floatResult,
+                            llvm::function_ref<llvm::Value*()> integerResult);
+        llvm::Value* asFloat(llvm::Value* payload);
+        llvm::Value* fromFloat(llvm::Value* value);
+        llvm::Constant* stringConstant(const std::string& text);
+
+        //Shared lowering of add, sub and multiply
+        void arithmetic(AST::InstructionNode& node, llvm::Instruction::BinaryOps integerOp,
+                        llvm::Instruction::BinaryOps floatOp, std::initializer_list<RuntimeConstants::ValueType> types,
+                        const std::string& description);
+        //Shared lowering of or and and
+        void bitwise(AST::InstructionNode& node, llvm::Instruction::BinaryOps op);
+
+        //Lower the lines from first to last into the current function (leaders having their blocks)
+        void lowerLines(int first, int last);
+        //Parallel code generation - each partition is lowered into a module of its own, linked once optimized
+        void lowerPartition(int first, int last, const std::vector<char>& leaders);
+        bool generatePartitions(const std::vector<AST::ASTNode*>& instructions, const std::vector<char>& leaders,
+                                const std::vector<int>& starts);
+        void linkPartitions();
+
+        //Write the module to a file in a format other than an executable
+        bool writeFile(BackendConstants::EmitFormat format, const std::string& path, std::string& error);
+
+        //Lazy execution - lower the region starting at a line into a function of its own and JIT compile it
+        void lowerRegion(int start);
+        void* compileRegion(int start);
+        //Called by the program when it first reaches a line, returning the compiled region
+        static void* resolveRegion(int line);
+
+        //Shared with the JIT, which compiles modules in the same context
+        llvm::orc::ThreadSafeContext m_context;
+        llvm::LLVMContext& context;
         llvm::IRBuilder<> builder;
         std::unique_ptr<llvm::Module> module;
+        //Host target the module is generated and optimized for, null if LLVM has no backend for it
+        std::unique_ptr<llvm::TargetMachine> m_targetMachine;
+
+        //Types
+        llvm::StructType* m_valueType = nullptr;
+        llvm::IntegerType* m_int = nullptr;
+
+        //Program state - registers are a (type, payload) pair of locals, like the flags
+        std::array<std::pair<llvm::AllocaInst*, llvm::AllocaInst*>, RuntimeConstants::NUM_REGISTERS> m_registers{};
+        std::array<llvm::AllocaInst*, CodeGenConstants::NUM_FLAGS> m_flags{};
+        //Registers and flags kept in globals between regions when running lazily
+        llvm::GlobalVariable* m_savedRegisters = nullptr;
+        llvm::GlobalVariable* m_savedFlags = nullptr;
+        llvm::GlobalVariable* m_stack = nullptr;
+        llvm::GlobalVariable* m_stackPointer = nullptr;
+        llvm::GlobalVariable* m_pages = nullptr;
+
+        //C library and helper functions
+        llvm::FunctionCallee m_printf, m_scanf, m_putchar;
+        llvm::Function* m_cell = nullptr;
+        llvm::Function* m_fail = nullptr;
+        llvm::Function* m_output = nullptr;
+
+        //Function being lowered (main, or a region when running lazily), with the block of every line starting
+        //a region (1 based, the block past the last line exits)
+        llvm::Function* m_function = nullptr;
+        std::vector<llvm::BasicBlock*> m_lines;
+        //Block of the region following the one being lowered, blocks split off a region are placed before it
+        llvm::BasicBlock* m_regionEnd = nullptr;
+        llvm::AllocaInst* m_inputBuffer = nullptr;
+        //Jumps through registers branch to a switch over every line, created on first use
+        llvm::BasicBlock* m_dispatch = nullptr;
+        llvm::PHINode* m_dispatchAddress = nullptr;
+        llvm::PHINode* m_dispatchLine = nullptr;
+        //Failed runtime checks branch to a block reporting the error, created on first use
+        llvm::BasicBlock* m_failure = nullptr;
+        llvm::PHINode* m_failureLine = nullptr;
+        llvm::PHINode* m_failureMessage = nullptr;
+        //Line being lowered
+        int m_line = 0;
+        BackendConstants::Checks m_checks = BackendConstants::FULL_CHECKS;
+        //Types of the registers when each line starts
+        const TypeInference* m_types = nullptr;
+        std::unordered_map<std::string, llvm::Constant*> m_strings;
+
+        //The program is split into functions returning the line to continue at (partitions or lazily compiled
+        //regions), which keep the state in globals between them
+        bool m_split = false;
+        //Generators of the partitions, until they are linked into this module
+        std::vector<std::unique_ptr<CodeGenerator>> m_partitions;
+        //Instructions of the program
+        const std::vector<AST::ASTNode*>* m_instructions = nullptr;
+
+        //Lazy execution state - the region leaders, the region being lowered, and the lines given a block returning
+        //them from it
+        std::unique_ptr<llvm::orc::LLJIT> m_jit;
+        int m_optimizationLevel = 0;
+        std::vector<char> m_leaders;
+        int m_regionStart = 0;
+        std::vector<int> m_regionExits;
 };
 
 #endif
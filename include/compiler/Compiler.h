@@ -3,25 +3,59 @@
 
 #include "lexer/Lexer.h"
 #include "ast/AbstractSyntaxTree.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
+#include "compiler/PassManager.h"
+#include "cache/CompileCache.h"
+#include "codegen/Backend.h"
+#include "typeinfer/TypeInference.h"
 
+#include <climits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
-class Parser;
-class SymbolResolver;
-class ASTBuilder;
-class SemanticAnalyzer;
-class ScopeChecker;
-class CodeGenerator;
+//Command line options controlling a compilation
+struct CompilerOptions {
+    bool silent = false;
+    bool timings = false;
+    //Report live heap bytes and resident memory after every pass
+    bool memstats = false;
+    bool ir = false;
+    //File the optimized module is written to (compile only), in the format
+    BackendConstants::EmitFormat emit = BackendConstants::NO_EMIT;
+    std::string outputPath;
+    //LLVM optimization level (0 to 3), and whether the time of every optimization pass is printed
+    int optimizationLevel = 0;
+    bool timePasses = false;
+    //Runtime checks in the generated code
+    BackendConstants::Checks checks = BackendConstants::FULL_CHECKS;
+    //Stream chunks of lines through a pipelined front end instead of running each phase over the whole file
+    bool pipeline = false;
+    //Maximum number of errors recorded per compilation, 0 for no limit
+    int maxErrors = 0;
+    DiagnosticConstants::Format diagnosticsFormat = DiagnosticConstants::TEXT;
+    //Output the AST in the binary layout (BinaryAST.h) instead of JSON
+    bool binaryAST = false;
+    //Only output the instructions on code lines [firstLine, lastLine] of the (fully validated) AST
+    bool lineRange = false;
+    int firstLine = 1;
+    int lastLine = INT_MAX;
+    //Reuse results of earlier compilations of the same source from an on-disk cache
+    bool cache = false;
+    //Cache location, empty for the per-user default
+    std::string cacheDirectory;
+};
 
 class Compiler {
     public:
         //Constructors and Destructors
-        Compiler(std::string& pathname, bool cmdSilent, bool cmdTimings, bool cmdIr);
+        Compiler(std::string& pathname, const CompilerOptions& options);
         ~Compiler();
 
         Compiler(const Compiler&) = delete;
@@ -30,11 +64,15 @@ class Compiler {
         //Accessors
         //Get number of lines
         [[nodiscard]] int getNumLines() const {
-            return int(m_codeLines.size());
+            return m_source != nullptr ? m_source->numLines() : 0;
         }
-        //Get current status
+        //Get current status - diagnostics are only formatted here, once compilation has finished
         [[nodiscard]] std::string getStatus() const {
-            return m_statusMessage;
+            return m_diagnostics.format(m_options.diagnosticsFormat, m_source.get(), !m_warningsShown);
+        }
+        //Whether a successful compilation still has diagnostics to print (type warnings)
+        [[nodiscard]] bool hasWarnings() const {
+            return m_diagnostics.hasWarnings();
         }
 
         //Mutators
@@ -46,53 +84,75 @@ class Compiler {
         //Printers
         void cmdPrint(const std::string& message) const;
         void cmdTimingPrint(const std::string& message) const;
+        void cmdMemoryPrint(const std::string& message) const;
 
         //Public facing compile method
         //Code Compiling
         bool compileCode();
         //Public facing tree method (for interpreter
         bool outputAST();
+        //JIT compile and run the program, its exit code is then available from getExitCode
+        bool runProgram();
+        [[nodiscard]] int getExitCode() const {
+            return m_exitCode;
+        }
 
 
     private:
+        //Register every compiler pass with its inputs and outputs
+        void registerPasses(PassManager& passManager);
+        //Register the passes consuming the validated AST
+        void registerBackendPasses(PassManager& passManager);
+        //Produce a target artifact, going through the compile cache when enabled
+        bool run(PassConstants::Artifact target);
+        //Look the target up in the compile cache, compiling and storing it on a miss
+        bool runCached(PassConstants::Artifact target);
+        //Run the passes needed to produce the target artifacts
+        bool runPasses(const std::vector<PassConstants::Artifact>& targets);
+        //Load the code generation backend, reporting why it is unavailable
+        bool loadBackend();
+        //Print part of the result of the target artifact, keeping it for the compile cache
+        void emitOutput(std::string_view output, bool print);
+        void emitOutput(const std::string_view* outputs, std::size_t count, bool print);
+        //Print buffers in order
+        void printOutputs(const std::string_view* outputs, std::size_t count) const;
+        //Print a result loaded from the compile cache and report its diagnostics, false if it is unusable
+        bool replayOutput(PassConstants::Artifact target, CacheEntry& entry);
+        //Print the JSON form of the requested line range of a binary AST, false if it is unreadable
+        bool printLines(std::string_view binaryAST) const;
+        //Print the timings and memory statistics of a step
+        void reportStep(const std::string& description, double seconds) const;
+
         //Private variables
-        //Data structures
-        //Vector containing code lines
-        std::vector<std::string> m_codeLines;
+        //Data structures (intermediates are released by the pass manager after their last consumer)
+        //Shared, immutable source buffer (code lines are views into it)
+        std::shared_ptr<const SourceBuffer> m_source;
         //Vector containing code tokens and tags
         std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>> m_codeTokens;
         //Parse tree for the code
-        PT::ParseTree* m_parseTree;
+        std::unique_ptr<PT::ParseTree> m_parseTree;
         //Hash table for symbol resolution, mapping labels to instruction addresses
         std::unordered_map<std::string, std::pair<std::string, int>> m_symbolTable;
+        //AST (used directly by the compiler at multiple stages)
+        std::unique_ptr<AST::AbstractSyntaxTree> m_AST;
+        //Register types inferred over the AST, used by code generation
+        std::unique_ptr<TypeInference> m_types;
+        //Code generation backend, holding the generated module
+        std::unique_ptr<Backend> m_backend;
+        //Exit code of the program once run
+        int m_exitCode = 0;
+        //Whether type warnings were already printed before running the program
+        bool m_warningsShown = false;
+        //Result of the target artifact (AST JSON, binary AST or LLVM IR), only kept when caching
+        std::string m_output;
 
         //Variables and data structures
         //Pathname
         std::string m_pathname;
-        //String containing current status
-        std::string m_statusMessage;
-        //Lexer
-        Lexer* m_lexer;
-        //Parser (PT nested inside parser)
-        Parser* m_parser;
-        //Symbol Resolver
-        SymbolResolver* m_symbolResolver;
-        //AST (used directly by the compiler at multiple stages)
-        AST::AbstractSyntaxTree* m_AST;
-        //AST Builder
-        ASTBuilder* m_ASTBuilder;
-        //Pointer to semantic analyzer
-        SemanticAnalyzer* m_semanticAnalyzer;
-        //Pointer to scope checker
-        ScopeChecker* m_scopeChecker;
-        //Pointer to code generator
-        CodeGenerator* m_codeGenerator;
-
         //Terminal options
-        bool cmd_silent;
-        bool cmd_timings;
-        bool cmd_tree;
-        bool cmd_ir;
+        CompilerOptions m_options;
+        //Diagnostics collected from every phase
+        DiagnosticEngine m_diagnostics;
 };
 
 #endif
\ No newline at end of file
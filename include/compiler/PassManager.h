@@ -0,0 +1,66 @@
+#ifndef STARTASM_PASSMANAGER_H
+#define STARTASM_PASSMANAGER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace PassConstants {
+    //Data produced and consumed by compiler passes
+    //Marker artifacts (SCOPES_CHECKED, SEMANTICS_CHECKED, EMITTED, EXECUTED) carry no data and only order passes
+    //REGISTER_TYPES are the inferred types of the registers, MODULE is the generated LLVM module held by the backend,
+    //IR the (optimized) module once printable
+    enum Artifact {SOURCE, TOKENS, PARSE_TREE, SYMBOL_TABLE, ABSTRACT_SYNTAX_TREE, SCOPES_CHECKED, SEMANTICS_CHECKED, REGISTER_TYPES, AST_JSON, AST_BINARY, MODULE, IR, EMITTED, EXECUTED, NUM_ARTIFACTS};
+}
+
+//A single compiler phase with its declared inputs and outputs
+struct Pass {
+    std::string description;
+    std::vector<PassConstants::Artifact> inputs;
+    std::vector<PassConstants::Artifact> outputs;
+    //Returns false if the pass failed (diagnostics are reported by the pass itself)
+    std::function<bool()> run;
+};
+
+//Schedules passes from their declared dependencies
+//Only passes needed for the requested artifacts run, passes whose inputs are ready run concurrently,
+//and intermediate artifacts are released as soon as their last consumer has finished
+class PassManager {
+    public:
+        using ReportCallback = std::function<void(const Pass&, double seconds)>;
+
+        PassManager() = default;
+        ~PassManager() = default;
+        //Delete copy and assignment
+        PassManager(const PassManager&) = delete;
+        PassManager& operator=(const PassManager&) = delete;
+
+        //Register a pass. Every artifact may only have a single producer
+        void addPass(Pass pass);
+        //Register how an intermediate artifact is freed
+        void addRelease(PassConstants::Artifact artifact, std::function<void()> release);
+        //Called after every finished pass with its wall time, once the inputs it was last to consume have been released
+        void setReportCallback(ReportCallback callback) {
+            m_reportCallback = std::move(callback);
+        }
+        //Release intermediates on the calling thread, so that the callback observes the memory they held as freed
+        void setSynchronousReleases(bool synchronous) {
+            m_synchronousReleases = synchronous;
+        }
+
+        //Run every pass needed to produce the target artifacts, returns false if any pass failed
+        bool run(const std::vector<PassConstants::Artifact>& targets);
+
+    private:
+        //Mark the producers of an artifact (and their own inputs) as needed
+        bool markNeeded(PassConstants::Artifact artifact, std::vector<bool>& needed) const;
+        //Invoke the report callback for every pass of a finished wave
+        void reportWave(const std::vector<size_t>& wave, const std::vector<double>& seconds) const;
+
+        std::vector<Pass> m_passes;
+        std::function<void()> m_releases[PassConstants::NUM_ARTIFACTS];
+        ReportCallback m_reportCallback;
+        bool m_synchronousReleases = false;
+};
+
+#endif //STARTASM_PASSMANAGER_H
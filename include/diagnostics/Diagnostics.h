@@ -0,0 +1,148 @@
+#ifndef STARTASM_DIAGNOSTICS_H
+#define STARTASM_DIAGNOSTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "source/SourceBuffer.h"
+
+namespace DiagnosticConstants {
+    //Compiler phase that raised the diagnostic, in pipeline order (used for sorting)
+    enum Phase {LEXER, PARSER, SYMBOLS, SCOPE, SEMANTICS, TYPES, CODEGEN, NUM_PHASES};
+    enum Code {
+        //Lexer
+        FILE_NOT_FOUND,
+        //Parser
+        UNKNOWN_INSTRUCTION, MISSING_INSTRUCTION_PARSER, MISSING_INSTRUCTION_INFO, EXCESS_TOKENS,
+        MISSING_CONJUNCTION, UNKNOWN_CONJUNCTION, MISSING_CONDITION, UNKNOWN_CONDITION,
+        MISSING_OPERAND, UNKNOWN_OPERAND, MISSING_DESCRIPTOR, UNKNOWN_DESCRIPTOR,
+        //Symbol resolution
+        DUPLICATE_LABEL, UNDEFINED_LABEL,
+        //Scope checking
+        REGISTER_OUT_OF_RANGE, MEMORY_OUT_OF_RANGE, INSTRUCTION_OUT_OF_PROGRAM, INSTRUCTION_OUT_OF_RANGE,
+        //Semantic analysis
+        UNRECOGNIZED_OPERAND, UNEXPECTED_OPERAND,
+        //Type inference (warnings)
+        UNEXPECTED_TYPE, MISMATCHED_TYPES,
+        //Code generation
+        BACKEND_UNAVAILABLE, INVALID_IR, EMIT_FAILED, JIT_FAILED
+    };
+    enum Format {TEXT, JSON};
+    enum Constants {
+        NO_LINE = 0,
+        NO_COLUMN = -1
+    };
+}
+
+//Structured diagnostic record - no message text is built until the diagnostics are formatted
+struct Diagnostic {
+    DiagnosticConstants::Phase phase;
+    DiagnosticConstants::Code code;
+    //1-based code line, NO_LINE if the diagnostic isn't tied to a line
+    int line = DiagnosticConstants::NO_LINE;
+    //0-based byte column span inside the line, NO_COLUMN if unknown
+    int column = DiagnosticConstants::NO_COLUMN;
+    int length = 0;
+    //Numeric argument (line of a previous declaration, number of instructions, types a register holds)
+    int number = 0;
+    //Bit set of expected ASTConstants::OperandType values (semantic analysis) or RuntimeConstants::ValueType values
+    //(type inference)
+    std::uint32_t expected = 0;
+    //Token arguments (offending token, expected keyword)
+    std::string args[2];
+};
+
+//Collects diagnostics from every phase into lock-free per-thread buffers and formats them once at the end
+class DiagnosticEngine {
+    public:
+        //maxErrors of 0 means no limit
+        explicit DiagnosticEngine(int maxErrors = 0);
+        ~DiagnosticEngine();
+        //Delete copy and assignment
+        DiagnosticEngine(const DiagnosticEngine&) = delete;
+        DiagnosticEngine& operator=(const DiagnosticEngine&) = delete;
+
+        //Record a diagnostic, safe to call concurrently from any thread
+        //The cap keeps the first errors in phase and line order, whichever thread reports them first
+        //Returns false (and drops the diagnostic) if the cap already holds errors sorting before it
+        bool report(Diagnostic diagnostic);
+
+        //Accessors
+        //True once the error cap has been reached
+        [[nodiscard]] bool full() const {
+            return m_maxErrors > 0 && m_count.load(std::memory_order_relaxed) >= m_maxErrors;
+        }
+        //True if an error of the phase at the line would be dropped - phases use this to stop early
+        [[nodiscard]] bool full(DiagnosticConstants::Phase phase, int line) const {
+            return m_maxErrors > 0 && orderKey(phase, line) >= m_cutoff.load(std::memory_order_relaxed);
+        }
+        [[nodiscard]] bool hasErrors() const {
+            return m_count.load(std::memory_order_relaxed) > 0;
+        }
+        [[nodiscard]] bool hasWarnings() const {
+            return m_warnings.load(std::memory_order_relaxed) > 0;
+        }
+        [[nodiscard]] bool hasErrors(DiagnosticConstants::Phase phase) const {
+            return m_phaseCounts[phase].load(std::memory_order_relaxed) > 0;
+        }
+        [[nodiscard]] int getMaxErrors() const {
+            return m_maxErrors;
+        }
+
+        //All recorded diagnostics sorted by phase and line, errors cut to the cap. Only call once reporting threads have joined
+        [[nodiscard]] std::vector<Diagnostic> collect() const;
+        //Format all diagnostics in one pass. The source may be null if no file was read
+        //Warnings can be left out once they have already been shown
+        [[nodiscard]] std::string format(DiagnosticConstants::Format format, const SourceBuffer* source,
+                                         bool warnings = true) const;
+
+        //Helpers
+        //Type inference only warns, as the instructions it flags may never run - warnings are counted apart from
+        //errors, so they never fill the --max-errors cap or fail a compilation
+        static bool isWarning(const Diagnostic& diagnostic) {
+            return diagnostic.phase == DiagnosticConstants::TYPES;
+        }
+        //Message text for a single diagnostic, without the line header
+        static std::string message(const Diagnostic& diagnostic);
+        //Stable identifier of a diagnostic code, as printed in JSON diagnostics
+        static const char* identifier(DiagnosticConstants::Code code);
+        //Column span of the whitespace separated token at tokenIndex
+        static void setTokenSpan(Diagnostic& diagnostic, std::string_view line, int tokenIndex);
+        //Column span of the first occurrence of text in the line after the instruction keyword
+        static void setTextSpan(Diagnostic& diagnostic, std::string_view line, std::string_view text);
+
+    private:
+        //Per-thread buffer, linked into a lock-free list on first use by a thread
+        struct Buffer {
+            std::vector<Diagnostic> diagnostics;
+            Buffer* next = nullptr;
+        };
+        Buffer* localBuffer();
+        //Position of a diagnostic in the sorted order, diagnostics of one phase and line keep their report order
+        static std::int64_t orderKey(DiagnosticConstants::Phase phase, int line) {
+            return (static_cast<std::int64_t>(phase) << 32) | static_cast<std::uint32_t>(line);
+        }
+
+        std::string formatText(const std::vector<Diagnostic>& diagnostics, const SourceBuffer* source) const;
+        std::string formatJson(const std::vector<Diagnostic>& diagnostics, const SourceBuffer* source) const;
+
+        //Unique engine id, so threads never reuse a buffer belonging to an older engine
+        const std::uint64_t m_id;
+        const int m_maxErrors;
+        std::atomic<Buffer*> m_buffers{nullptr};
+        std::atomic<int> m_count{0};
+        std::atomic<int> m_warnings{0};
+        std::atomic<int> m_phaseCounts[DiagnosticConstants::NUM_PHASES] = {};
+        //Keys of the first errors in sorted order (at most the cap), and the key from which errors are dropped
+        std::mutex m_capMutex;
+        std::priority_queue<std::int64_t> m_firstErrors;
+        std::atomic<std::int64_t> m_cutoff{std::numeric_limits<std::int64_t>::max()};
+};
+
+#endif //STARTASM_DIAGNOSTICS_H
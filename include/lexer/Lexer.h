@@ -1,11 +1,13 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 #include <utility>
-#include <regex>
+
+#include "source/SourceBuffer.h"
 
 namespace LexerConstants {
     enum TokenType {INSTRUCTION, CONJUNCTION, JUMPCONDITION, TYPECONDITION, SHIFTCONDITION, REGISTER, INSTRUCTIONADDRESS, MEMORYADDRESS, INTEGER, FLOAT, BOOLEAN, CHARACTER, LABEL, STRING, BLANK, NEWLINE, UNKNOWN};
@@ -13,26 +15,24 @@ namespace LexerConstants {
 
 class Lexer {
     public:
-        Lexer();
+        Lexer() = default;
         ~Lexer() = default;
         //Delete copy and assignment
         Lexer(const Lexer&) = delete;
         Lexer& operator=(const Lexer&) = delete;
 
         //Lexer method
-        bool lexFile(const std::string&, std::vector<std::string>&, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>&);
+        bool lexFile(const std::string&, std::shared_ptr<const SourceBuffer>&, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>&);
+        //Chunk lexer method (pipelined front end) - tokenizes lines [begin, end) of the source
+        void tokenizeLines(const SourceBuffer&, int, int, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>&);
+        //Line tokenizer function (also used to look up the token under an editor cursor)
+        static std::vector<std::pair<std::string, LexerConstants::TokenType>> tokenizeLine(std::string_view);
 
     private:
-        //File reader function
-        bool readFile(const std::string&, std::vector<std::string>&);
         //File tokenizer function
-        void tokenizeFile(std::vector<std::string>&, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>&);
-        //Line tokenizer helper function
-        std::vector<std::pair<std::string, LexerConstants::TokenType>> tokenizeLine(std::string&);
-        //Dictionary of tokens
-        std::unordered_map<std::string, LexerConstants::TokenType> m_tokenDictionary;
-        std::vector<std::pair<std::regex, LexerConstants::TokenType>> m_operandDictionary;
-        std::regex m_stringTemplate;
+        void tokenizeFile(const SourceBuffer&, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>&);
+        //Classify a token as a keyword (static keyword table) or an operand (hand-written matchers)
+        static LexerConstants::TokenType classifyToken(std::string_view);
 };
 
 #endif
\ No newline at end of file
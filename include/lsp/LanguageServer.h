@@ -0,0 +1,85 @@
+#ifndef STARTASM_LANGUAGESERVER_H
+#define STARTASM_LANGUAGESERVER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "lib/json.hpp"
+#include "session/CompilationSession.h"
+
+namespace LspConstants {
+    enum Constants {
+        //Diagnostics published per document unless --max-errors says otherwise, so huge broken files stay responsive
+        MAX_DIAGNOSTICS = 1000,
+        //Bytes read from stdin at a time
+        READ_SIZE = 1 << 16
+    };
+    //JSON-RPC error codes
+    enum ErrorCode {
+        PARSE_ERROR = -32700,
+        INVALID_REQUEST = -32600,
+        METHOD_NOT_FOUND = -32601,
+        INVALID_PARAMS = -32602
+    };
+}
+
+//Language Server Protocol server over stdio
+//Every open document is kept resident as a compilation session, updated line by line from incremental
+//didChange events. Diagnostics are published once no further message is waiting, so bursts of edits
+//are coalesced into a single (capped) publication.
+class LanguageServer {
+    public:
+        //maxErrors of 0 means no limit
+        explicit LanguageServer(int maxErrors = LspConstants::MAX_DIAGNOSTICS);
+        ~LanguageServer() = default;
+        //Delete copy and assignment
+        LanguageServer(const LanguageServer&) = delete;
+        LanguageServer& operator=(const LanguageServer&) = delete;
+
+        //Serve until the exit notification or the end of input, returns the process exit code
+        int run();
+
+    private:
+        struct Document {
+            std::unique_ptr<CompilationSession> session;
+            int version = 0;
+            //Diagnostics still have to be published
+            bool dirty = true;
+        };
+
+        //Framing
+        bool readMessage(std::string& content);
+        bool inputPending() const;
+        void send(const nlohmann::json& message) const;
+        void respond(const nlohmann::json& id, nlohmann::json result) const;
+        void respondError(const nlohmann::json& id, int code, const std::string& message) const;
+
+        //Dispatch
+        void handle(const nlohmann::json& message);
+        nlohmann::json initialize(const nlohmann::json& params);
+        void didOpen(const nlohmann::json& params);
+        void didChange(const nlohmann::json& params);
+        void didClose(const nlohmann::json& params);
+        nlohmann::json definition(const nlohmann::json& params) const;
+        nlohmann::json references(const nlohmann::json& params) const;
+        nlohmann::json hover(const nlohmann::json& params) const;
+        void publishDiagnostics(const std::string& uri, Document& document) const;
+
+        //Positions - LSP columns are UTF-16 code units unless the client accepts UTF-8
+        const Document* findDocument(const nlohmann::json& params) const;
+        std::size_t toByte(std::string_view line, int character) const;
+        int toCharacter(std::string_view line, std::size_t byte) const;
+        nlohmann::json range(const CompilationSession& session, int line, std::size_t begin, std::size_t end) const;
+
+        int m_maxErrors;
+        bool m_utf8 = false;
+        bool m_shutdown = false;
+        bool m_exit = false;
+        std::unordered_map<std::string, Document> m_documents;
+        //Unconsumed input read from stdin
+        std::string m_input;
+        std::size_t m_inputPosition = 0;
+};
+
+#endif //STARTASM_LANGUAGESERVER_H
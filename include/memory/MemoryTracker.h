@@ -0,0 +1,31 @@
+#ifndef STARTASM_MEMORYTRACKER_H
+#define STARTASM_MEMORYTRACKER_H
+
+#include <cstddef>
+#include <string>
+
+//Process memory statistics reported by --memstats
+//Live heap bytes are counted by the replaced global operator new and delete, only once tracking has been enabled,
+//so runs without --memstats pay a single relaxed load per allocation
+class MemoryTracker {
+    public:
+        //Start counting heap allocations (memory allocated earlier is not counted)
+        static void enable();
+        [[nodiscard]] static bool enabled();
+
+        //Bytes currently allocated through operator new
+        [[nodiscard]] static std::size_t liveBytes();
+        //Highest live byte count since tracking started
+        [[nodiscard]] static std::size_t peakBytes();
+        //Highest live byte count since the previous call, then restarts the interval at the current live count
+        [[nodiscard]] static std::size_t takeIntervalPeakBytes();
+
+        //Current and peak resident set size of the whole process (heap, code, stacks and mapped files)
+        [[nodiscard]] static std::size_t residentBytes();
+        [[nodiscard]] static std::size_t peakResidentBytes();
+
+        //Human readable byte count
+        static std::string formatBytes(std::size_t bytes);
+};
+
+#endif //STARTASM_MEMORYTRACKER_H
@@ -0,0 +1,43 @@
+#ifndef STARTASM_COSTMODEL_H
+#define STARTASM_COSTMODEL_H
+
+#include <functional>
+#include <string>
+#include <utility>
+
+//Decides whether splitting work across threads pays off
+//Parallel time is modelled as dispatch + serial / jobs (+ worker startup the first time), so work only
+//goes parallel once the time saved clearly exceeds the overhead. The two overheads are measured on
+//the first run that needs them and cached per job count, so later runs start without measuring.
+class CostModel {
+    public:
+        explicit CostModel(int jobs) : m_jobs(jobs) {}
+        ~CostModel() = default;
+
+        //Load cached overheads or measure them - measure returns {dispatch seconds, worker startup seconds}
+        void calibrate(const std::function<std::pair<double, double>()>& measure);
+
+        //True if work taking serialSeconds on one thread should be split
+        [[nodiscard]] bool worthParallel(double serialSeconds, bool workersStarted) const;
+        //Iterations per chunk so that scheduling overhead stays small relative to the work
+        [[nodiscard]] int grainFor(double secondsPerIteration, int iterations) const;
+
+        [[nodiscard]] double getDispatchSeconds() const {
+            return m_dispatchSeconds;
+        }
+        [[nodiscard]] double getStartupSeconds() const {
+            return m_startupSeconds;
+        }
+
+    private:
+        //Cache file holding one "jobs dispatch startup" line per job count, empty if no cache directory exists
+        static std::string cachePath();
+        bool loadCache();
+        void saveCache() const;
+
+        int m_jobs;
+        double m_dispatchSeconds = 0;
+        double m_startupSeconds = 0;
+};
+
+#endif //STARTASM_COSTMODEL_H
@@ -0,0 +1,124 @@
+#ifndef STARTASM_TASKSCHEDULER_H
+#define STARTASM_TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel/CostModel.h"
+
+namespace SchedulerConstants {
+    //How parallel loops and concurrent passes are executed
+    enum Parallelism {AUTO, SERIAL, PARALLEL};
+    enum Constants {
+        //Smallest number of loop iterations worth handing to another thread
+        MIN_GRAIN = 128,
+        //Chunks created per thread by parallelFor, so faster threads can steal the rest
+        CHUNKS_PER_THREAD = 4,
+        //Iterations run serially and timed by parallelFor before deciding whether to split the rest
+        PROBE_ITERATIONS = 16,
+        //Parallel execution must save this many times its overhead
+        OVERHEAD_MARGIN = 4,
+        //Work below this many microseconds never goes parallel (no calibration or cache lookup needed)
+        MIN_PARALLEL_MICROSECONDS = 20
+    };
+}
+
+//Work-stealing task scheduler shared by every compiler phase
+//One process-wide pool of (jobs - 1) workers plus the calling thread. Each worker owns a deque
+//(LIFO for itself, FIFO for thieves), and threads waiting on a task group execute pending tasks
+//instead of blocking, so nested parallel loops never oversubscribe the machine.
+//With a single job, or loops too small to split, everything runs inline with no threads started.
+class TaskScheduler {
+    public:
+        using Task = std::function<void()>;
+
+        //Tasks that can be waited on together
+        class TaskGroup {
+            public:
+                TaskGroup() = default;
+                //Waits for outstanding tasks
+                ~TaskGroup();
+                //Delete copy and assignment
+                TaskGroup(const TaskGroup&) = delete;
+                TaskGroup& operator=(const TaskGroup&) = delete;
+
+                //Queue a task (runs inline when there is only one job)
+                void run(Task task);
+                //Execute pending tasks until every task of the group has finished
+                void wait();
+
+            private:
+                friend class TaskScheduler;
+                std::atomic<int> m_pending{0};
+        };
+
+        //Set the number of jobs - must be called before the scheduler is first used (0 picks defaultJobs())
+        static void setJobs(int jobs);
+        //Choose between the cost model (AUTO) and forcing serial or parallel execution - also before first use
+        static void setParallelism(SchedulerConstants::Parallelism parallelism);
+        //Number of threads (workers plus caller) the scheduler runs on
+        static int getJobs();
+        //Number of CPUs the process may use, honouring the affinity mask and any cgroup CPU quota
+        static int defaultJobs();
+        //Process-wide scheduler
+        static TaskScheduler& instance();
+
+        //Run body(chunkBegin, chunkEnd) over [begin, end), split into chunks of at least minGrain iterations
+        //In AUTO mode the first iterations are timed serially and the rest only split if the cost model says it pays
+        void parallelFor(int begin, int end, const std::function<void(int, int)>& body, int minGrain = SchedulerConstants::MIN_GRAIN);
+        //True if independent work estimated to take serialSeconds on one thread should run concurrently
+        bool worthParallel(double serialSeconds);
+
+        //Delete copy and assignment
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    private:
+        struct QueuedTask {
+            Task task;
+            TaskGroup* group;
+        };
+        //Task deque owned by a worker (index jobs - 1 is the shared queue of non-worker threads)
+        struct TaskQueue {
+            std::mutex mutex;
+            std::deque<QueuedTask> tasks;
+        };
+
+        explicit TaskScheduler(int jobs);
+        ~TaskScheduler();
+
+        //Start the workers on first use so runs that never go parallel create no threads
+        void startWorkers();
+        void workerLoop(int index);
+        void spawn(Task task, TaskGroup* group);
+        //Pop from the own deque, then the shared queue, then steal from other workers
+        bool findTask(QueuedTask& task);
+        void execute(QueuedTask& task);
+        void waitFor(TaskGroup& group);
+        //Load or measure the scheduling overheads used by the cost model
+        void calibrate();
+        std::pair<double, double> measureOverheads();
+        void splitLoop(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+        int m_jobs;
+        SchedulerConstants::Parallelism m_parallelism;
+        CostModel m_costModel;
+        std::once_flag m_calibrated;
+        std::atomic<bool> m_workersStarted{false};
+        std::vector<std::unique_ptr<TaskQueue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::once_flag m_started;
+        std::atomic<int> m_queued{0};
+        std::atomic<bool> m_stop{false};
+        //Idle threads sleep here until tasks are queued or a group finishes
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+};
+
+#endif //STARTASM_TASKSCHEDULER_H
@@ -3,19 +3,35 @@
 
 #include "pt/ParseTree.h"
 #include "lexer/Lexer.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <iostream>
-#include <functional>
-#include <regex>
 
 class Parser {
     public:
+        //Token sequence of a single line
+        using Tokens = std::vector<std::pair<std::string, LexerConstants::TokenType>>;
+        //Parsing template function - returns false and fills the diagnostic on a syntax error
+        using TemplateFunction = bool (*)(PT::ParseTree*, PT::PTNode*, const Tokens&, std::string_view, int, Diagnostic&);
+        //Parsing template step - the keyword expected, its index in the token sequence and the function checking it
+        struct TemplateStep {
+            std::string_view keyword;
+            int index;
+            TemplateFunction function;
+        };
+        //Instruction template - the expected number of tokens and the steps parsing them
+        struct InstructionTemplate {
+            std::string_view instruction;
+            int numTokens;
+            int numSteps;
+            TemplateStep steps[3];
+        };
+
         //Constructor and destructor
-        Parser();
+        Parser() = default;
         ~Parser() = default;
 
         //Delete copy and assignment
@@ -23,33 +39,33 @@ class Parser {
         Parser& operator=(const Parser&) = delete;
 
         //Parser main method
-        bool parseCode(PT::ParseTree* parseTree, const std::vector<std::string>& codeLines, const std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>& tokens, std::string& errorMessage);
+        bool parseCode(PT::ParseTree* parseTree, const SourceBuffer& source, const std::vector<Tokens>& tokens, DiagnosticEngine& diagnostics);
+        //Chunk parser method (pipelined front end) - tokens[0] belongs to source line firstLine (0-based)
+        bool parseLines(PT::ParseTree* parseTree, const SourceBuffer& source, const std::vector<Tokens>& tokens, int firstLine, DiagnosticEngine& diagnostics);
 
     private:
-        //Hash map containing a keyword linked to an instruction parsing function
-        std::unordered_map<std::string, std::vector<std::pair<std::pair<std::string, int>, std::function<std::string(PT::ParseTree*, PT::PTNode*, std::vector<std::pair<std::string, LexerConstants::TokenType>>, std::string&, int)>>>> m_templateMap;
-        //Hash map containing instructions with template info
-        std::unordered_map<std::string, int> m_instructionMap;
+        //Static template table lookup, nullptr if the instruction has no template
+        static const InstructionTemplate* findTemplate(std::string_view instruction);
 
         //LEVEL 1 - INSTRUCTION CHECKERS AND PARSERS
-        std::string checkInstruction(PT::ParseTree* parseTree, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens);
-        std::string parseInstruction(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::vector<std::pair<std::pair<std::string, int>, std::function<std::string(PT::ParseTree*, PT::PTNode*, std::vector<std::pair<std::string, LexerConstants::TokenType>>, std::string&, int)>>> parsingTemplate);
+        bool checkInstruction(PT::ParseTree* parseTree, const Tokens& tokens, Diagnostic& error);
+        bool parseInstruction(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, const InstructionTemplate& parsingTemplate, Diagnostic& error);
 
         //LEVEL 2 - IMPLICIT AND EXPLICIT CONJUNCTION AND CONDITION CHECKERS
-        static std::string checkImplicitConjunction(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
-        static std::string checkImplicitCondition(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
-        static std::string checkExplicitConjunction(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
-        static std::string checkExplicitCondition(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
+        static bool checkImplicitConjunction(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
+        static bool checkImplicitCondition(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
+        static bool checkExplicitConjunction(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
+        static bool checkExplicitCondition(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
 
         //LEVEL 2 - CONJUNCTION AND CONDITION PARSERS
-        static std::string parseConjunction(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
-        static std::string parseCondition(PT::ParseTree* parseTree, PT::PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::string& keyword, int index);
+        static bool parseConjunction(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
+        static bool parseCondition(PT::ParseTree* parseTree, PT::PTNode* node, const Tokens& tokens, std::string_view keyword, int index, Diagnostic& error);
 
 
 
         //LEVEL 3 - OPERAND AND DESCRIPTOR CHECKERS
-        static bool isOperand(std::pair<std::string, LexerConstants::TokenType>& token);
-        static bool isDescriptor(std::pair<std::string, LexerConstants::TokenType>& token);
+        static bool isOperand(const std::pair<std::string, LexerConstants::TokenType>& token);
+        static bool isDescriptor(const std::pair<std::string, LexerConstants::TokenType>& token);
 
         //Constants helper function
         static PTConstants::OperandType returnPTOperand(LexerConstants::TokenType tokenType);
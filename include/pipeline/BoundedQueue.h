@@ -0,0 +1,58 @@
+#ifndef STARTASM_BOUNDEDQUEUE_H
+#define STARTASM_BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+//Blocking single-producer/single-consumer queue connecting two pipeline stages
+//The capacity bounds the number of chunks in flight so a fast stage cannot run ahead of a slow one
+template <typename T>
+class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+        ~BoundedQueue() = default;
+        //Delete copy and assignment
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        //Blocks while the queue is full
+        void push(T item) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notFull.wait(lock, [this] { return m_items.size() < m_capacity; });
+            m_items.push_back(std::move(item));
+            m_notEmpty.notify_one();
+        }
+
+        //Blocks while the queue is empty, returns false once the queue is closed and drained
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait(lock, [this] { return !m_items.empty() || m_closed; });
+            if (m_items.empty()) {
+                return false;
+            }
+            item = std::move(m_items.front());
+            m_items.pop_front();
+            m_notFull.notify_one();
+            return true;
+        }
+
+        //Called by the producer once it will push no more items
+        void close() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            m_notEmpty.notify_all();
+        }
+
+    private:
+        size_t m_capacity;
+        bool m_closed = false;
+        std::deque<T> m_items;
+        std::mutex m_mutex;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+};
+
+#endif //STARTASM_BOUNDEDQUEUE_H
@@ -0,0 +1,101 @@
+#ifndef STARTASM_FRONTENDPIPELINE_H
+#define STARTASM_FRONTENDPIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lexer/Lexer.h"
+#include "parser/Parser.h"
+#include "pt/ParseTree.h"
+#include "ast/AbstractSyntaxTree.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
+#include "pipeline/BoundedQueue.h"
+
+namespace PipelineConstants {
+    enum Constants {
+        //Lines per chunk streamed through the stages
+        CHUNK_LINES = 1024,
+        //Chunks buffered between two stages
+        QUEUE_CAPACITY = 4
+    };
+}
+
+class ASTBuilder;
+class ScopeChecker;
+class SemanticAnalyzer;
+
+//Chunk-pipelined front end
+//Chunks of lines stream through lex -> parse -> AST build -> validation stages connected by bounded queues,
+//so different chunks are in different stages at the same time. Label uses are built as placeholder
+//instruction addresses and resolved in a final fixup once every declaration has been seen.
+//Diagnostics and the resulting AST are identical to the batch passes.
+class FrontendPipeline {
+    public:
+        explicit FrontendPipeline(int chunkLines = PipelineConstants::CHUNK_LINES);
+        ~FrontendPipeline();
+        //Delete copy and assignment
+        FrontendPipeline(const FrontendPipeline&) = delete;
+        FrontendPipeline& operator=(const FrontendPipeline&) = delete;
+
+        //Read, lex, parse, resolve, build and validate the file into the AST
+        bool run(const std::string& pathname, std::shared_ptr<const SourceBuffer>& source, AST::AbstractSyntaxTree* abstractSyntaxTree, DiagnosticEngine& diagnostics);
+
+    private:
+        //Stages in pipeline order
+        enum Stage {LEX, PARSE, BUILD, VALIDATE, NUM_STAGES};
+
+        //A chunk of lines and everything the stages produce for it
+        struct Chunk {
+            int firstLine = 0;
+            int endLine = 0;
+            std::vector<Parser::Tokens> tokens;
+            std::unique_ptr<PT::ParseTree> parseTree;
+            std::vector<AST::InstructionNode*> instructions;
+            //Bitmask per instruction of operand positions holding unresolved labels
+            std::vector<std::uint8_t> placeholders;
+        };
+        //Label declaration or use recorded during AST build (line is 1-based)
+        struct LabelReference {
+            std::string label;
+            int line;
+            int tokenIndex;
+            AST::ASTNode* operand;
+        };
+
+        //Stages run in groups of consecutive stages, one thread per group (at most --jobs threads)
+        void runGroup(int group, int numGroups, std::vector<std::unique_ptr<BoundedQueue<Chunk>>>& queues);
+        void runStage(Stage stage, Chunk& chunk);
+        void lexChunk(Chunk& chunk);
+        void parseChunk(Chunk& chunk);
+        void buildChunk(Chunk& chunk);
+        void validateChunk(Chunk& chunk);
+        //Final fixup - builds the symbol table in line order and binds every label use
+        bool resolveLabels();
+
+        //Phase objects - every stage is only ever run by one thread at a time
+        Lexer m_lexer;
+        Parser m_parser;
+        std::unique_ptr<ASTBuilder> m_builder;
+        std::unique_ptr<ScopeChecker> m_scopeChecker;
+        std::unique_ptr<SemanticAnalyzer> m_semanticAnalyzer;
+
+        int m_chunkLines;
+        std::shared_ptr<const SourceBuffer> m_source;
+        AST::AbstractSyntaxTree* m_AST = nullptr;
+        DiagnosticEngine* m_diagnostics = nullptr;
+        //Scope and semantic diagnostics are held back until it is known that parsing and symbol resolution succeeded
+        DiagnosticEngine m_deferred;
+        //Set once a parse error is seen (later stages stop working) or the error cap is reached
+        std::atomic<bool> m_parseFailed{false};
+        std::atomic<bool> m_cancelled{false};
+
+        std::vector<LabelReference> m_declarations;
+        std::vector<LabelReference> m_uses;
+};
+
+#endif //STARTASM_FRONTENDPIPELINE_H
@@ -0,0 +1,40 @@
+#ifndef STARTASM_RUNTIME_H
+#define STARTASM_RUNTIME_H
+
+#include <cstdint>
+
+namespace RuntimeConstants {
+    //Runtime type tag carried next to every register, stack and memory value
+    enum ValueType {UNDEFINED, INTEGER, FLOAT, BOOLEAN, CHARACTER, MEMORY, INSTRUCTION};
+    enum Constants {
+        NUM_REGISTERS = 10,
+        //Memory m<0> to m<999999999> is allocated a page of cells at a time, on first use
+        MEMORY_SIZE = 1000000000,
+        PAGE_BITS = 16,
+        NUM_PAGES = (MEMORY_SIZE >> PAGE_BITS) + 1
+    };
+}
+
+//Runtime support library of generated programs
+//Compiled to LLVM bitcode by the build and linked into every generated module before it is optimized, so the helpers
+//are inlined into the program like the code around them. Builds without clang compile it to a native object instead,
+//loaded by the JIT and linked into emitted executables. Only the C library is called, as emitted executables link
+//against nothing else. The symbol names are the ones the code generator calls.
+namespace Runtime {
+    //A register, stack or memory value, laid out like the generated (type, payload) pair
+    struct Value {
+        std::int32_t type;
+        std::int32_t payload;
+    };
+}
+
+extern "C" {
+    //Report a runtime error at a line and exit
+    [[noreturn]] void startasmFail(std::int32_t line, const char* message) __asm__("startasm.fail");
+    //Cell of an address in range, allocating its page in the page table on first use
+    Runtime::Value* startasmCell(Runtime::Value** pages, std::int32_t line, std::int32_t address) __asm__("startasm.cell");
+    //Print a value in its type's format
+    void startasmOutput(std::int32_t type, std::int32_t payload) __asm__("startasm.output");
+}
+
+#endif //STARTASM_RUNTIME_H
@@ -3,36 +3,49 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <utility>
-#include <regex>
-#include <map>
+#include <memory>
 
 #include "ast/Instructions.h"
 #include "ast/Operands.h"
 #include "ast/Visitor.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
 
 class ScopeChecker: public AST::Visitor {
 public:
     //Constructor/destructor
-    explicit ScopeChecker(std::vector<std::string>& lines);
+    ScopeChecker() = default;
     ~ScopeChecker() = default;
     //Delete copy and assignment
     ScopeChecker(const ScopeChecker&) = delete;
     ScopeChecker& operator=(const ScopeChecker&) = delete;
 
     //Main address scope checking function
-    bool checkAddressScopes(AST::ASTNode* AST, std::string& errorMessage, const std::vector<std::string>& codeLines);
+    bool checkAddressScopes(AST::ASTNode* AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source);
+
+    //Incremental checking (pipelined front end) - set the context once, then check nodes as they are built
+    void beginChecks(DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source);
+    void checkNode(AST::ASTNode& node) {
+        node.accept(*this);
+    }
+    //Bound instruction addresses by the lines of a whole program rather than the checked source (compilation sessions check a few lines at a time)
+    void setProgramLines(int numLines) {
+        m_numLines = numLines;
+    }
 
 private:
-    //Error messages map and code lines
-    std::vector<std::string> m_codeLines;
-    std::map<int, std::string> m_invalidLines;
+    //Diagnostics sink and shared source buffer
+    DiagnosticEngine* m_diagnostics = nullptr;
+    std::shared_ptr<const SourceBuffer> m_source;
+    //Number of lines instruction addresses may refer to
+    int m_numLines = 0;
+
+    //Record a scope error for an operand
+    void reportError(AST::OperandNode& node, DiagnosticConstants::Code code, int number = 0);
 
-    //Regex templates
-    const std::regex registerTemplate = std::regex("r[0-9]");
-    const std::regex instructionTemplate = std::regex("i\\[[0-9]{1,9}\\]");
-    const std::regex memoryTemplate = std::regex("m<[0-9]{1,9}>");
+    //StartASM address bound - memory and instruction addresses have at most 9 digits
+    static constexpr size_t MAX_ADDRESS_DIGITS = 9;
 
     // Visitor Methods
     void visit(AST::RootNode& node) override {};
@@ -7,15 +7,18 @@
 #include <unordered_set>
 #include <set>
 #include <map>
+#include <memory>
 
 #include "ast/Instructions.h"
 #include "ast/Operands.h"
 #include "ast/Visitor.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
 
 class SemanticAnalyzer: public AST::Visitor {
 public:
     // Constructor/destructor
-    SemanticAnalyzer(std::vector<std::string>& lines);
+    SemanticAnalyzer() = default;
     ~SemanticAnalyzer() = default;
 
     // Remove copy and assignment operator
@@ -23,15 +26,24 @@ public:
     SemanticAnalyzer& operator=(const SemanticAnalyzer&) = delete;
 
     // Main Semantic Analysis Method
-    bool analyzeSemantics(AST::ASTNode *AST, std::string &errorMessage);
+    bool analyzeSemantics(AST::ASTNode *AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source);
+
+    // Incremental analysis (pipelined front end) - begin once, analyze instructions as they are built, then end
+    void beginAnalysis(DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source);
+    void analyzeNode(AST::ASTNode& node) {
+        node.accept(*this);
+    }
+    void endAnalysis() {
+        m_semanticContext.clear();
+    }
 
 private:
     // Data structure to store local semantic context
     std::vector<std::vector<ASTConstants::OperandType>> m_semanticContext;
-    // Data structure for errors
-    std::map<int, std::string> m_invalidLines;
-    // Reference to code lines
-    std::vector<std::string>& m_lines;
+    // Diagnostics sink
+    DiagnosticEngine* m_diagnostics = nullptr;
+    // Shared source buffer for error reporting
+    std::shared_ptr<const SourceBuffer> m_source;
 
     // Visitor Methods
     void visit(AST::RootNode& node) override;
@@ -78,7 +90,7 @@ private:
     // Helper functions
     void handleAtomicInstructionError(int line, const std::vector<ASTConstants::OperandType>& expectedTemplate, AST::InstructionNode& node); // Handle error logging for atomic instructions
     void handleMultipleInstructionError(int line, const std::vector<std::unordered_set<ASTConstants::OperandType>>& expectedTemplate, AST::InstructionNode& node); // Handle error logging for multiple type instructions
-    std::string enumToString(ASTConstants::OperandType type); // Error logging helper function
+    void reportOperandError(int line, int pos, std::uint32_t expected, AST::InstructionNode& node); // Record a single operand error
 };
 
 #endif
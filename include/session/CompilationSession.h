@@ -0,0 +1,132 @@
+#ifndef STARTASM_COMPILATIONSESSION_H
+#define STARTASM_COMPILATIONSESSION_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "diagnostics/Diagnostics.h"
+
+namespace SessionConstants {
+    enum Constants {
+        //Lines analyzed together as one batch (batches of a large edit are analyzed in parallel)
+        BATCH_LINES = 1024
+    };
+}
+
+//Long-lived compilation of a single document, kept up to date by line edits
+//StartASM lines only depend on each other through labels and the i[N] bound check, so an edit re-lexes,
+//re-parses and re-validates the lines it touches, rebinds the labels those lines declare or use, and rechecks
+//the instruction addresses crossing the program length. Diagnostics are identical to a full compile.
+class CompilationSession {
+    public:
+        //maxErrors of 0 means no limit
+        explicit CompilationSession(int maxErrors = 0);
+        ~CompilationSession() = default;
+        //Delete copy and assignment
+        CompilationSession(const CompilationSession&) = delete;
+        CompilationSession& operator=(const CompilationSession&) = delete;
+
+        //Replace the whole document
+        void open(std::string_view text);
+        //Replace the file lines [firstLine, endLine) (0-based, blank lines included) with the given lines
+        void edit(int firstLine, int endLine, const std::vector<std::string>& lines);
+
+        //Diagnostics a full compile of the current document reports, in the same order
+        [[nodiscard]] std::vector<Diagnostic> diagnostics() const;
+
+        //Accessors
+        //Number of file lines, blank ones included
+        [[nodiscard]] int numLines() const {
+            return static_cast<int>(m_fileLines.size());
+        }
+        //Number of (non-blank) code lines, the line numbering used in every diagnostic
+        [[nodiscard]] int numCodeLines() const {
+            return static_cast<int>(m_codeLines.size());
+        }
+        //0-based file line, without the trailing newline
+        [[nodiscard]] std::string_view line(int fileLine) const {
+            return m_text[m_fileLines[fileLine]];
+        }
+        //0-based code line of a file line, -1 if the line is blank
+        [[nodiscard]] int codeLine(int fileLine) const;
+        //0-based file line of a code line
+        [[nodiscard]] int fileLine(int codeLine) const {
+            return m_positions[m_codeLines[codeLine]].fileLine;
+        }
+        //Current document, file lines joined by newlines
+        [[nodiscard]] std::string text() const;
+
+        //Label queries, in file line order (the first declaration is the one every use binds to)
+        [[nodiscard]] std::vector<int> labelDeclarations(const std::string& label) const;
+        [[nodiscard]] std::vector<int> labelUses(const std::string& label) const;
+
+    private:
+        //Lines are identified by ids that stay valid while other lines move, so nothing keyed by them shifts on an edit
+        using LineId = std::uint32_t;
+
+        //Everything the analysis of a code line produces - lines that declare, use or report nothing keep no state
+        struct LineState {
+            //Parse errors, or scope and semantic diagnostics, with the line number left out
+            std::vector<Diagnostic> diagnostics;
+            bool parseFailed = false;
+            //Label declared by the line, labels used by it with their token index (in operand order)
+            std::string declaration;
+            std::vector<std::pair<std::string, int>> uses;
+            //Literal instruction addresses, whose bound check depends on the program length
+            std::vector<long long> addresses;
+
+            [[nodiscard]] bool empty() const {
+                return diagnostics.empty() && declaration.empty() && uses.empty() && addresses.empty();
+            }
+        };
+        //Lines declaring and using a label (a line using a label twice is listed twice)
+        struct Label {
+            std::vector<LineId> declarations;
+            std::vector<LineId> uses;
+        };
+        //File line and number of code lines before a line
+        struct Position {
+            int fileLine = 0;
+            int codeLine = 0;
+            bool code = false;
+        };
+
+        LineId addLine(std::string text);
+        void removeLine(LineId id);
+        //Renumber the lines from firstLine on, stopping early once the numbering is back in step
+        void updatePositions(int firstLine, int stableLine);
+
+        //Analyze code lines, replacing whatever they previously declared, used and reported
+        void analyze(std::vector<LineId>& ids);
+        void analyzeBatch(const LineId* ids, int count, LineState* states) const;
+        void attach(LineId id, LineState state);
+        void detach(LineId id);
+        //Keep the duplicate and undefined label sets in step with a label's declarations and uses
+        void updateLabel(const std::string& name);
+        //Sorted, distinct file lines of a set of line ids
+        [[nodiscard]] std::vector<int> fileLines(const std::vector<LineId>& ids) const;
+
+        int m_maxErrors;
+        //Per-id line text and position, ids of removed lines are reused
+        std::vector<std::string> m_text;
+        std::vector<Position> m_positions;
+        std::vector<LineId> m_freeIds;
+        //Ids of every line and of code lines, in file order
+        std::vector<LineId> m_fileLines;
+        std::vector<LineId> m_codeLines;
+
+        std::unordered_map<LineId, LineState> m_states;
+        std::unordered_map<std::string, Label> m_labels;
+        std::unordered_set<std::string> m_duplicateLabels;
+        std::unordered_set<std::string> m_undefinedLabels;
+        std::unordered_set<LineId> m_parseErrors;
+        std::unordered_set<LineId> m_checkErrors;
+        std::multimap<long long, LineId> m_addresses;
+};
+
+#endif //STARTASM_COMPILATIONSESSION_H
@@ -0,0 +1,58 @@
+#ifndef STARTASM_SOURCEBUFFER_H
+#define STARTASM_SOURCEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Immutable, reference-counted copy of a source file shared by every compiler phase
+//Lines are indexed by offset into a single contiguous buffer, so no per-line strings are ever allocated
+//Only non-blank lines are indexed, matching the line numbering used in every diagnostic
+class SourceBuffer {
+    public:
+        //Factory methods - buffers are only ever handed out as shared, read-only instances
+        static std::shared_ptr<const SourceBuffer> fromFile(const std::string& pathname);
+        static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+        //Read a whole file without indexing it, false if it can't be read
+        static bool readFile(const std::string& pathname, std::string& text);
+
+        ~SourceBuffer() = default;
+        //Delete copy and assignment
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+        //Accessors
+        //Number of (non-blank) code lines
+        [[nodiscard]] int numLines() const {
+            return static_cast<int>(m_lines.size());
+        }
+        //O(1) view of a 0-based code line, without the trailing newline
+        [[nodiscard]] std::string_view line(int index) const {
+            const LineSpan& span = m_lines[index];
+            return {m_text.data() + span.offset, span.length};
+        }
+        //Full file contents
+        [[nodiscard]] const std::string& text() const {
+            return m_text;
+        }
+
+    private:
+        explicit SourceBuffer(std::string text);
+
+        //Build the line-offset index over m_text
+        void indexLines();
+
+        struct LineSpan {
+            std::size_t offset;
+            std::uint32_t length;
+        };
+
+        //Raw file contents and offsets of every non-blank line inside them
+        std::string m_text;
+        std::vector<LineSpan> m_lines;
+};
+
+#endif //STARTASM_SOURCEBUFFER_H
@@ -6,10 +6,11 @@
 #include <vector>
 #include <unordered_map>
 #include <utility>
-#include <regex>
 #include <map>
 
 #include "pt/ParseTree.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
 
 class SymbolResolver {
     public:
@@ -21,15 +22,13 @@ class SymbolResolver {
         SymbolResolver& operator=(const SymbolResolver&) = delete;
 
         //Main symbol resolution function
-        bool resolveSymbols(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, std::string& errorMessage, const std::vector<std::string>& codeLines);
+        bool resolveSymbols(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, DiagnosticEngine& diagnostics, const SourceBuffer& source);
 
     private:
         //Helper functions
-        void buildSymbolTable(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, const std::vector<std::string>& codeLines);
-        void bindSymbols(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, const std::vector<std::string>& codeLines);
-
-        //Error messages map
-        std::map<int, std::string> m_invalidLinesMap;
+        void buildSymbolTable(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, DiagnosticEngine& diagnostics, const SourceBuffer& source);
+        void bindSymbols(std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* parseTree, DiagnosticEngine& diagnostics, const SourceBuffer& source);
+        static void bindLine(const std::unordered_map<std::string, std::pair<std::string, int>>& symbolTable, PT::PTNode* lineNode, int line, DiagnosticEngine& diagnostics, const SourceBuffer& source);
 
 };
 
@@ -0,0 +1,95 @@
+#ifndef STARTASM_TYPEINFERENCE_H
+#define STARTASM_TYPEINFERENCE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ast/AbstractSyntaxTree.h"
+#include "source/SourceBuffer.h"
+#include "diagnostics/Diagnostics.h"
+#include "runtime/Runtime.h"
+
+namespace TypeConstants {
+    //Bit set of the RuntimeConstants::ValueType values a register may hold, empty on lines the program never reaches
+    using TypeSet = std::uint8_t;
+    constexpr TypeSet NO_TYPES = 0;
+    constexpr TypeSet ALL_TYPES = (1u << (RuntimeConstants::INSTRUCTION + 1)) - 1;
+    //Types of every register when a line starts
+    using RegisterTypes = std::array<TypeSet, RuntimeConstants::NUM_REGISTERS>;
+}
+
+//Static type inference over the registers of a validated program
+//A forward dataflow analysis over the control flow graph computes the types each register may hold when each line
+//starts. Memory and the stack are not tracked, so loads and pops may give any type. Jumps through registers and returns
+//may continue at any line an instruction address can be made of, which is every line once the program can compute one.
+//Instructions whose runtime type check can never pass are reported as warnings, and end their paths like the failure does.
+class TypeInference {
+public:
+    //Constructor/destructor
+    TypeInference() = default;
+    ~TypeInference() = default;
+    //Delete copy and assignment
+    TypeInference(const TypeInference&) = delete;
+    TypeInference& operator=(const TypeInference&) = delete;
+
+    //Main type inference function - always succeeds, type errors are only warnings as the paths may never run
+    bool inferTypes(AST::ASTNode* AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source);
+
+    //Accessors
+    //Types a register may hold when a line (1 based) starts, NO_TYPES if the line is unreachable
+    [[nodiscard]] TypeConstants::TypeSet typesAt(int line, int reg) const {
+        return line >= 1 && line < static_cast<int>(m_types.size()) ? m_types[line][reg] : TypeConstants::ALL_TYPES;
+    }
+    //The single type a register holds when a line starts, UNDEFINED with known false if it may hold several
+    [[nodiscard]] RuntimeConstants::ValueType knownType(int line, int reg, bool& known) const {
+        TypeConstants::TypeSet types = typesAt(line, reg);
+        known = types != TypeConstants::NO_TYPES && (types & (types - 1)) == 0;
+        int type = 0;
+        while (known && (types >> type) != 1) {
+            type++;
+        }
+        return static_cast<RuntimeConstants::ValueType>(type);
+    }
+    //Whether the program can compute an instruction address (arithmetic on addresses, casts or inputs to them)
+    [[nodiscard]] bool computesAddresses() const {
+        return m_computed;
+    }
+
+private:
+    //Outcome of an instruction's type checks - passing for some of the possible types, or never
+    struct Failure {
+        DiagnosticConstants::Code code;
+        const AST::ASTNode* first = nullptr;
+        const AST::ASTNode* second = nullptr;
+        TypeConstants::TypeSet expected = TypeConstants::NO_TYPES;
+    };
+
+    //Run the analysis to a fixed point, with jumps through registers continuing at the dynamic targets
+    void solve(const std::vector<AST::ASTNode*>& instructions);
+    //Apply a line's instruction to the register types, returning false (with the failed check) if it can never pass
+    bool transfer(const AST::ASTNode* instruction, TypeConstants::RegisterTypes& types, Failure& failure) const;
+    //Join types into a line's, queueing it if they grew
+    void join(int line, const TypeConstants::RegisterTypes& types);
+    //Whether a reachable instruction produces a computed instruction address with the inferred types
+    bool computesAddress(const AST::ASTNode* instruction) const;
+    //Record a warning for an instruction that can never pass its type checks
+    void reportFailure(int line, const Failure& failure);
+
+    //Diagnostics sink and shared source buffer
+    DiagnosticEngine* m_diagnostics = nullptr;
+    std::shared_ptr<const SourceBuffer> m_source;
+
+    //Register types when each line starts (indexed 1 to one past the last line)
+    std::vector<TypeConstants::RegisterTypes> m_types;
+    //Lines jumps through registers and returns may continue at, and the types they carry there
+    std::vector<int> m_dynamicTargets;
+    TypeConstants::RegisterTypes m_dynamicTypes{};
+    //Lines whose types grew since they were last visited
+    std::vector<int> m_worklist;
+    std::vector<char> m_queued;
+    bool m_computed = false;
+};
+
+#endif //STARTASM_TYPEINFERENCE_H
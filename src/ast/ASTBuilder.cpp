@@ -1,57 +1,20 @@
 #include "ast/ASTBuilder.h"
+#include "parallel/TaskScheduler.h"
+
 #include <vector>
 
 using namespace std;
 
-ASTBuilder::ASTBuilder() {
-    initializeFactoryMaps();
-}
-
-void ASTBuilder::initializeFactoryMaps() {
-    //Factory map for creating instruction nodes
-    instructionFactoryMap = {
-            {ASTConstants::MOVE, [](const std::string& value, int line) { return new AST::MoveInstruction(value, line); }},
-            {ASTConstants::LOAD, [](const std::string& value, int line) { return new AST::LoadInstruction(value, line); }},
-            {ASTConstants::STORE, [](const std::string& value, int line) { return new AST::StoreInstruction(value, line); }},
-            {ASTConstants::CREATE, [](const std::string& value, int line) { return new AST::CreateInstruction(value, line); }},
-            {ASTConstants::CAST, [](const std::string& value, int line) { return new AST::CastInstruction(value, line); }},
-            {ASTConstants::ADD, [](const std::string& value, int line) { return new AST::AddInstruction(value, line); }},
-            {ASTConstants::SUB, [](const std::string& value, int line) { return new AST::SubInstruction(value, line); }},
-            {ASTConstants::MULTIPLY, [](const std::string& value, int line) { return new AST::MultiplyInstruction(value, line); }},
-            {ASTConstants::DIVIDE, [](const std::string& value, int line) { return new AST::DivideInstruction(value, line); }},
-            {ASTConstants::OR, [](const std::string& value, int line) { return new AST::OrInstruction(value, line); }},
-            {ASTConstants::AND, [](const std::string& value, int line) { return new AST::AndInstruction(value, line); }},
-            {ASTConstants::NOT, [](const std::string& value, int line) { return new AST::NotInstruction(value, line); }},
-            {ASTConstants::SHIFT, [](const std::string& value, int line) { return new AST::ShiftInstruction(value, line); }},
-            {ASTConstants::COMPARE, [](const std::string& value, int line) { return new AST::CompareInstruction(value, line); }},
-            {ASTConstants::JUMP, [](const std::string& value, int line) { return new AST::JumpInstruction(value, line); }},
-            {ASTConstants::CALL, [](const std::string& value, int line) { return new AST::CallInstruction(value, line); }},
-            {ASTConstants::PUSH, [](const std::string& value, int line) { return new AST::PushInstruction(value, line); }},
-            {ASTConstants::POP, [](const std::string& value, int line) { return new AST::PopInstruction(value, line); }},
-            {ASTConstants::RETURN, [](const std::string& value, int line) { return new AST::ReturnInstruction(value, line); }},
-            {ASTConstants::STOP, [](const std::string& value, int line) { return new AST::StopInstruction(value, line); }},
-            {ASTConstants::INPUT, [](const std::string& value, int line) { return new AST::InputInstruction(value, line); }},
-            {ASTConstants::OUTPUT, [](const std::string& value, int line) { return new AST::OutputInstruction(value, line); }},
-            {ASTConstants::PRINT, [](const std::string& value, int line) { return new AST::PrintInstruction(value, line); }},
-            {ASTConstants::LABEL, [](const std::string& value, int line) { return new AST::LabelInstruction(value, line); }},
-            {ASTConstants::COMMENT, [](const std::string& value, int line) { return new AST::CommentInstruction(value, line); }},
-    };
+namespace {
+    template <typename Node>
+    AST::InstructionNode* makeInstruction(const std::string& value, int line) {
+        return new Node(value, line);
+    }
 
-    //Factory map for creating operand nodes
-    operandFactoryMap = {
-            {ASTConstants::REGISTER, [](const std::string& value, int line, short int pos) { return new AST::RegisterOperand(value, line, pos); }},
-            {ASTConstants::INSTRUCTIONADDRESS, [](const std::string& value, int line, short int pos) { return new AST::InstructionAddressOperand(value, line, pos); }},
-            {ASTConstants::MEMORYADDRESS, [](const std::string& value, int line, short int pos) { return new AST::MemoryAddressOperand(value, line, pos); }},
-            {ASTConstants::INTEGER, [](const std::string& value, int line, short int pos) { return new AST::IntegerOperand(value, line, pos); }},
-            {ASTConstants::FLOAT, [](const std::string& value, int line, short int pos) { return new AST::FloatOperand(value, line, pos); }},
-            {ASTConstants::BOOLEAN, [](const std::string& value, int line, short int pos) { return new AST::BooleanOperand(value, line, pos); }},
-            {ASTConstants::CHARACTER, [](const std::string& value, int line, short int pos) { return new AST::CharacterOperand(value, line, pos); }},
-            {ASTConstants::STRING, [](const std::string& value, int line, short int pos) { return new AST::StringOperand(value, line, pos); }},
-            {ASTConstants::NEWLINE, [](const std::string& value, int line, short int pos) { return new AST::NewlineOperand(value, line, pos); }},
-            {ASTConstants::TYPECONDITION, [](const std::string& value, int line, short int pos) { return new AST::TypeConditionOperand(value, line, pos); }},
-            {ASTConstants::SHIFTCONDITION, [](const std::string& value, int line, short int pos) { return new AST::ShiftConditionOperand(value, line, pos); }},
-            {ASTConstants::JUMPCONDITION, [](const std::string& value, int line, short int pos) { return new AST::JumpConditionOperand(value, line, pos); }},
-    };
+    template <typename Node>
+    AST::OperandNode* makeOperand(const std::string& value, int line, short int pos) {
+        return new Node(value, line, pos);
+    }
 }
 
 void ASTBuilder::buildAST(PT::PTNode* parseTree, AST::AbstractSyntaxTree* abstractSyntaxTree) {
@@ -64,38 +27,15 @@ void ASTBuilder::buildAST(PT::PTNode* parseTree, AST::AbstractSyntaxTree* abstra
 
     // Iterate over all children (instructions) in the parse tree
     // Parallelize the creation of instruction nodes and their children
-#pragma omp parallel for schedule(dynamic) default(none) shared(parseTree, PTSize, instructionNodes, abstractSyntaxTree)
-    for (int i = 0; i < PTSize; i++) {
-        // Get the pointer to the instruction node from the PT
-        PT::PTNode* PTInstructionNode = parseTree->childAt(i);
-
-        // Initialize a new AST instruction node, using built-in conversion methods found in the AST class
-        auto ASTInstructionNode = instructionBuilder(
-                abstractSyntaxTree->getInstructionType(PTInstructionNode->getNodeValue()),
-                PTInstructionNode->getNodeValue(),
-                i + 1
-        );
-
-        // Store the instruction node in the vector
-        instructionNodes[i] = ASTInstructionNode;
+    TaskScheduler::instance().parallelFor(0, PTSize, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            // Get the pointer to the instruction node from the PT
+            PT::PTNode* PTInstructionNode = parseTree->childAt(i);
 
-        // Add all operands from the PT for the AST
-        for (int j = 0; j < PTInstructionNode->getNumChildren(); j++) {
-            // Get the operand node from the PT and cast to an OperandNode (parser guarantees this)
-            auto PTOperandNode = dynamic_cast<PT::OperandNode*>(PTInstructionNode->childAt(j)->childAt(0));
-
-            // Do a check anyway to make sure dynamic cast was successful
-            if (PTOperandNode != nullptr && ASTInstructionNode != nullptr) {
-                // Add a child for the instruction node in the AST, using conversion functions from the AST as necessary
-                ASTInstructionNode->insertChild(operandBuilder(
-                        abstractSyntaxTree->convertOperandType(PTOperandNode->getOperandType()),
-                        PTOperandNode->getNodeValue(),
-                        i+1,
-                        static_cast<short>(j)
-                ));
-            }
+            // Build the instruction node and store it in the vector
+            instructionNodes[i] = buildInstruction(PTInstructionNode, abstractSyntaxTree, i + 1);
         }
-    }
+    });
 
     // Insert instruction nodes into the AST root node (sequential part to ensure thread safety)
     ASTRoot->reserveChildren(PTSize);
@@ -104,18 +44,64 @@ void ASTBuilder::buildAST(PT::PTNode* parseTree, AST::AbstractSyntaxTree* abstra
     }
 }
 
+AST::InstructionNode* ASTBuilder::buildInstruction(PT::PTNode* PTInstructionNode, AST::AbstractSyntaxTree* abstractSyntaxTree, int line) {
+    // Initialize a new AST instruction node, using built-in conversion methods found in the AST class
+    auto ASTInstructionNode = instructionBuilder(
+            abstractSyntaxTree->getInstructionType(PTInstructionNode->getNodeValue()),
+            PTInstructionNode->getNodeValue(),
+            line
+    );
+
+    // Add all operands from the PT for the AST
+    for (int j = 0; j < PTInstructionNode->getNumChildren(); j++) {
+        // Get the operand node from the PT and cast to an OperandNode (parser guarantees this)
+        auto PTOperandNode = dynamic_cast<PT::OperandNode*>(PTInstructionNode->childAt(j)->childAt(0));
+
+        // Do a check anyway to make sure dynamic cast was successful
+        if (PTOperandNode != nullptr && ASTInstructionNode != nullptr) {
+            // Add a child for the instruction node in the AST, using conversion functions from the AST as necessary
+            ASTInstructionNode->insertChild(operandBuilder(
+                    abstractSyntaxTree->convertOperandType(PTOperandNode->getOperandType()),
+                    PTOperandNode->getNodeValue(),
+                    line,
+                    static_cast<short>(j)
+            ));
+        }
+    }
+    return ASTInstructionNode;
+}
+
 AST::InstructionNode* ASTBuilder::instructionBuilder(ASTConstants::InstructionType nodeType, const std::string& value, int line) {
-    auto it = instructionFactoryMap.find(nodeType);
-    if (it != instructionFactoryMap.end()) {
-        return it->second(value, line);
+    // Factory table for creating instruction nodes, in InstructionType order
+    static constexpr InstructionFactory INSTRUCTION_FACTORIES[] = {
+            makeInstruction<AST::MoveInstruction>, makeInstruction<AST::LoadInstruction>, makeInstruction<AST::StoreInstruction>,
+            makeInstruction<AST::CreateInstruction>, makeInstruction<AST::CastInstruction>, makeInstruction<AST::AddInstruction>,
+            makeInstruction<AST::SubInstruction>, makeInstruction<AST::MultiplyInstruction>, makeInstruction<AST::DivideInstruction>,
+            makeInstruction<AST::OrInstruction>, makeInstruction<AST::AndInstruction>, makeInstruction<AST::NotInstruction>,
+            makeInstruction<AST::ShiftInstruction>, makeInstruction<AST::CompareInstruction>, makeInstruction<AST::JumpInstruction>,
+            makeInstruction<AST::CallInstruction>, makeInstruction<AST::PushInstruction>, makeInstruction<AST::PopInstruction>,
+            makeInstruction<AST::ReturnInstruction>, makeInstruction<AST::StopInstruction>, makeInstruction<AST::InputInstruction>,
+            makeInstruction<AST::OutputInstruction>, makeInstruction<AST::PrintInstruction>, makeInstruction<AST::LabelInstruction>,
+            makeInstruction<AST::CommentInstruction>,
+    };
+    static_assert(sizeof(INSTRUCTION_FACTORIES) / sizeof(INSTRUCTION_FACTORIES[0]) == ASTConstants::NONE, "One factory per instruction type");
+    if (nodeType >= 0 && nodeType < ASTConstants::NONE) {
+        return INSTRUCTION_FACTORIES[nodeType](value, line);
     }
     return nullptr;
 }
 
 AST::OperandNode* ASTBuilder::operandBuilder(ASTConstants::OperandType nodeType, const std::string& value, int line, short int pos) {
-    auto it = operandFactoryMap.find(nodeType);
-    if (it != operandFactoryMap.end()) {
-        return it->second(value, line, pos);
+    // Factory table for creating operand nodes, in OperandType order
+    static constexpr OperandFactory OPERAND_FACTORIES[] = {
+            makeOperand<AST::RegisterOperand>, makeOperand<AST::InstructionAddressOperand>, makeOperand<AST::MemoryAddressOperand>,
+            makeOperand<AST::IntegerOperand>, makeOperand<AST::FloatOperand>, makeOperand<AST::BooleanOperand>,
+            makeOperand<AST::CharacterOperand>, makeOperand<AST::StringOperand>, makeOperand<AST::NewlineOperand>,
+            makeOperand<AST::TypeConditionOperand>, makeOperand<AST::ShiftConditionOperand>, makeOperand<AST::JumpConditionOperand>,
+    };
+    static_assert(sizeof(OPERAND_FACTORIES) / sizeof(OPERAND_FACTORIES[0]) == ASTConstants::UNKNOWN, "One factory per operand type");
+    if (nodeType >= 0 && nodeType < ASTConstants::UNKNOWN) {
+        return OPERAND_FACTORIES[nodeType](value, line, pos);
     }
     return nullptr;
 }
@@ -1,6 +1,8 @@
 #include "ast/Instructions.h"
 #include "ast/Operands.h"
+#include "ast/BinaryAST.h"
 #include "lib/json.hpp"
+#include "parallel/TaskScheduler.h"
 
 namespace AST {
 
@@ -72,10 +74,11 @@ namespace AST {
 
     void RootNode::accept(AST::Visitor &visitor) {
         visitor.visit(*this);
-#pragma omp parallel for schedule(auto) default(none) shared(visitor)
-        for (auto* child : m_children) {
-            child->accept(visitor);
-        }
+        TaskScheduler::instance().parallelFor(0, static_cast<int>(m_children.size()), [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                m_children[i]->accept(visitor);
+            }
+        });
     }
 
     nlohmann::json RootNode::toJson() const {
@@ -119,32 +122,6 @@ namespace AST {
     // AbstractSyntaxTree Implementation
     AbstractSyntaxTree::AbstractSyntaxTree() {
         m_root = new RootNode();
-        m_instructionDictionary.reserve(26);
-        m_instructionDictionary.emplace("move", ASTConstants::InstructionType::MOVE);
-        m_instructionDictionary.emplace("load", ASTConstants::InstructionType::LOAD);
-        m_instructionDictionary.emplace("store", ASTConstants::InstructionType::STORE);
-        m_instructionDictionary.emplace("create", ASTConstants::InstructionType::CREATE);
-        m_instructionDictionary.emplace("cast", ASTConstants::InstructionType::CAST);
-        m_instructionDictionary.emplace("add", ASTConstants::InstructionType::ADD);
-        m_instructionDictionary.emplace("sub", ASTConstants::InstructionType::SUB);
-        m_instructionDictionary.emplace("multiply", ASTConstants::InstructionType::MULTIPLY);
-        m_instructionDictionary.emplace("divide", ASTConstants::InstructionType::DIVIDE);
-        m_instructionDictionary.emplace("or", ASTConstants::InstructionType::OR);
-        m_instructionDictionary.emplace("and", ASTConstants::InstructionType::AND);
-        m_instructionDictionary.emplace("not", ASTConstants::InstructionType::NOT);
-        m_instructionDictionary.emplace("shift", ASTConstants::InstructionType::SHIFT);
-        m_instructionDictionary.emplace("compare", ASTConstants::InstructionType::COMPARE);
-        m_instructionDictionary.emplace("jump", ASTConstants::InstructionType::JUMP);
-        m_instructionDictionary.emplace("call", ASTConstants::InstructionType::CALL);
-        m_instructionDictionary.emplace("push", ASTConstants::InstructionType::PUSH);
-        m_instructionDictionary.emplace("pop", ASTConstants::InstructionType::POP);
-        m_instructionDictionary.emplace("return", ASTConstants::InstructionType::RETURN);
-        m_instructionDictionary.emplace("stop", ASTConstants::InstructionType::STOP);
-        m_instructionDictionary.emplace("input", ASTConstants::InstructionType::INPUT);
-        m_instructionDictionary.emplace("output", ASTConstants::InstructionType::OUTPUT);
-        m_instructionDictionary.emplace("print", ASTConstants::InstructionType::PRINT);
-        m_instructionDictionary.emplace("label", ASTConstants::InstructionType::LABEL);
-        m_instructionDictionary.emplace("comment", ASTConstants::InstructionType::COMMENT);
     }
 
     AbstractSyntaxTree::~AbstractSyntaxTree() {
@@ -156,10 +133,23 @@ namespace AST {
         return m_root;
     }
 
-    ASTConstants::InstructionType AbstractSyntaxTree::getInstructionType(const std::string &instruction) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        auto itr = m_instructionDictionary.find(instruction);
-        if (itr != m_instructionDictionary.end()) {
+    ASTConstants::InstructionType AbstractSyntaxTree::getInstructionType(std::string_view instruction) {
+        // Instruction table, sorted for binary search (read only, so no locking is needed)
+        static constexpr std::pair<std::string_view, ASTConstants::InstructionType> INSTRUCTIONS[] = {
+            {"add", ASTConstants::ADD}, {"and", ASTConstants::AND}, {"call", ASTConstants::CALL},
+            {"cast", ASTConstants::CAST}, {"comment", ASTConstants::COMMENT}, {"compare", ASTConstants::COMPARE},
+            {"create", ASTConstants::CREATE}, {"divide", ASTConstants::DIVIDE}, {"input", ASTConstants::INPUT},
+            {"jump", ASTConstants::JUMP}, {"label", ASTConstants::LABEL}, {"load", ASTConstants::LOAD},
+            {"move", ASTConstants::MOVE}, {"multiply", ASTConstants::MULTIPLY}, {"not", ASTConstants::NOT},
+            {"or", ASTConstants::OR}, {"output", ASTConstants::OUTPUT}, {"pop", ASTConstants::POP},
+            {"print", ASTConstants::PRINT}, {"push", ASTConstants::PUSH}, {"return", ASTConstants::RETURN},
+            {"shift", ASTConstants::SHIFT}, {"stop", ASTConstants::STOP}, {"store", ASTConstants::STORE},
+            {"sub", ASTConstants::SUB},
+        };
+        auto itr = std::lower_bound(std::begin(INSTRUCTIONS), std::end(INSTRUCTIONS), instruction, [](const std::pair<std::string_view, ASTConstants::InstructionType>& entry, std::string_view value) {
+            return entry.first < value;
+        });
+        if (itr != std::end(INSTRUCTIONS) && itr->first == instruction) {
             return itr->second;
         } else {
             return ASTConstants::InstructionType::NONE;
@@ -217,4 +207,9 @@ namespace AST {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_root->toJson();
     }
+
+    std::string AbstractSyntaxTree::toBinary() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return BinaryAST::serialize(m_root);
+    }
 }
@@ -0,0 +1,192 @@
+#include "ast/BinaryAST.h"
+#include "ast/Instructions.h"
+#include "ast/Operands.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace AST {
+
+    // Records are written in host byte order, which the layout fixes as little-endian
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The binary AST layout is little-endian");
+
+    namespace {
+        // Append the raw bytes of a table to the output
+        template <typename T>
+        void appendRecords(std::string& output, const std::vector<T>& records) {
+            output.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+        }
+
+        std::uint64_t alignTo(std::uint64_t offset, std::uint64_t alignment) {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    BinaryAST::BinaryAST(const char* data, std::size_t size, bool mapped)
+            : m_data(data), m_size(size), m_mapped(mapped), m_header(reinterpret_cast<const BinaryHeader*>(data)),
+              m_nodes(nullptr), m_strings(nullptr), m_characters(nullptr) {}
+
+    BinaryAST::~BinaryAST() {
+        if (m_mapped) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    std::unique_ptr<BinaryAST> BinaryAST::open(const std::string& pathname, std::string& error) {
+        int file = ::open(pathname.c_str(), O_RDONLY);
+        if (file < 0) {
+            error = "cannot open " + pathname + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        struct stat status{};
+        if (fstat(file, &status) != 0 || status.st_size <= 0) {
+            ::close(file);
+            error = pathname + " is empty or unreadable";
+            return nullptr;
+        }
+        // The mapping stays valid once the descriptor is closed
+        void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (data == MAP_FAILED) {
+            error = "cannot map " + pathname + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        std::unique_ptr<BinaryAST> tree(new BinaryAST(static_cast<const char*>(data), static_cast<std::size_t>(status.st_size), true));
+        if (!tree->validate(error, true)) {
+            return nullptr;
+        }
+        return tree;
+    }
+
+    std::unique_ptr<BinaryAST> BinaryAST::fromBuffer(const void* data, std::size_t size, std::string& error, bool checkNodes) {
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t) != 0) {
+            error = "binary AST buffer is not 8-byte aligned";
+            return nullptr;
+        }
+        std::unique_ptr<BinaryAST> tree(new BinaryAST(static_cast<const char*>(data), size, false));
+        if (!tree->validate(error, checkNodes)) {
+            return nullptr;
+        }
+        return tree;
+    }
+
+    bool BinaryAST::validate(std::string& error, bool checkNodes) {
+        if (m_size < sizeof(BinaryHeader) || std::memcmp(m_header->magic, BinaryASTConstants::MAGIC, sizeof(BinaryASTConstants::MAGIC)) != 0) {
+            error = "not a binary AST";
+            return false;
+        }
+        if (m_header->version != BinaryASTConstants::VERSION || m_header->nodeSize != sizeof(BinaryNode)) {
+            error = "unsupported binary AST version " + std::to_string(m_header->version);
+            return false;
+        }
+        // Tables must be aligned and lie inside the buffer (all sizes fit in 64 bits, so none of this can overflow)
+        const std::uint64_t nodesEnd = m_header->nodesOffset + static_cast<std::uint64_t>(m_header->numNodes) * sizeof(BinaryNode);
+        const std::uint64_t stringsEnd = m_header->stringsOffset + static_cast<std::uint64_t>(m_header->numStrings) * sizeof(BinaryString);
+        if (m_header->fileSize != m_size || m_header->numNodes == 0 ||
+            m_header->nodesOffset % alignof(BinaryNode) != 0 || m_header->nodesOffset < sizeof(BinaryHeader) || nodesEnd > m_size ||
+            m_header->stringsOffset % alignof(BinaryString) != 0 || m_header->stringsOffset < nodesEnd || stringsEnd > m_size ||
+            m_header->charactersOffset < stringsEnd || m_header->charactersOffset > m_size) {
+            error = "truncated or corrupt binary AST";
+            return false;
+        }
+        m_nodes = reinterpret_cast<const BinaryNode*>(m_data + m_header->nodesOffset);
+        m_strings = reinterpret_cast<const BinaryString*>(m_data + m_header->stringsOffset);
+        m_characters = m_data + m_header->charactersOffset;
+
+        if (!checkNodes) {
+            return true;
+        }
+        const std::uint64_t numCharacters = m_size - m_header->charactersOffset;
+        for (std::uint32_t i = 0; i < m_header->numStrings; i++) {
+            if (m_strings[i].offset > numCharacters || m_strings[i].length > numCharacters - m_strings[i].offset) {
+                error = "corrupt binary AST string table";
+                return false;
+            }
+        }
+        // Children always come after their parent, so a walk can neither leave the table nor loop
+        for (std::uint32_t i = 0; i < m_header->numNodes; i++) {
+            const BinaryNode& record = m_nodes[i];
+            if (record.nodeType > ASTConstants::OPERAND || record.value >= m_header->numStrings ||
+                (record.numChildren != 0 && (record.firstChild <= i ||
+                 static_cast<std::uint64_t>(record.firstChild) + record.numChildren > m_header->numNodes))) {
+                error = "corrupt binary AST node " + std::to_string(i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string BinaryAST::serialize(const ASTNode* root) {
+        // Breadth first order, assigning each node's children the next consecutive indexes
+        std::vector<const ASTNode*> order = {root};
+        std::vector<BinaryNode> nodes;
+        std::vector<BinaryString> strings;
+        std::string characters;
+        std::unordered_map<std::string_view, std::uint32_t> interned;
+
+        for (std::size_t i = 0; i < order.size(); i++) {
+            const ASTNode* current = order[i];
+            BinaryNode record{};
+            record.nodeType = static_cast<std::uint8_t>(current->getNodeType());
+            if (current->getNodeType() == ASTConstants::INSTRUCTION) {
+                auto instruction = static_cast<const InstructionNode*>(current);
+                record.kind = static_cast<std::uint8_t>(instruction->getInstructionType());
+                record.detail = static_cast<std::int16_t>(instruction->getNumOperands());
+                record.line = instruction->getLine();
+            }
+            else if (current->getNodeType() == ASTConstants::OPERAND) {
+                auto operand = static_cast<const OperandNode*>(current);
+                record.kind = static_cast<std::uint8_t>(operand->getOperandType());
+                record.detail = operand->getPos();
+                record.line = operand->getLine();
+            }
+
+            // Children are skipped if empty, as in the JSON serialization
+            for (const ASTNode* child : current->getChildren()) {
+                if (child != nullptr) {
+                    if (record.numChildren == 0) {
+                        record.firstChild = static_cast<std::uint32_t>(order.size());
+                    }
+                    order.push_back(child);
+                    record.numChildren++;
+                }
+            }
+
+            // Values repeat heavily (instruction keywords, registers), so each distinct one is stored once
+            const std::string& value = current->getNodeValue();
+            auto [itr, inserted] = interned.try_emplace(value, static_cast<std::uint32_t>(strings.size()));
+            if (inserted) {
+                strings.push_back({characters.size(), static_cast<std::uint32_t>(value.size()), 0});
+                characters += value;
+            }
+            record.value = itr->second;
+            nodes.push_back(record);
+        }
+
+        BinaryHeader header{};
+        std::memcpy(header.magic, BinaryASTConstants::MAGIC, sizeof(header.magic));
+        header.version = BinaryASTConstants::VERSION;
+        header.nodeSize = sizeof(BinaryNode);
+        header.numNodes = static_cast<std::uint32_t>(nodes.size());
+        header.numStrings = static_cast<std::uint32_t>(strings.size());
+        header.nodesOffset = sizeof(BinaryHeader);
+        header.stringsOffset = alignTo(header.nodesOffset + nodes.size() * sizeof(BinaryNode), alignof(BinaryString));
+        header.charactersOffset = header.stringsOffset + strings.size() * sizeof(BinaryString);
+        header.fileSize = header.charactersOffset + characters.size();
+
+        std::string output;
+        output.reserve(header.fileSize);
+        output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        appendRecords(output, nodes);
+        output.resize(header.stringsOffset, '\0');
+        appendRecords(output, strings);
+        output += characters;
+        return output;
+    }
+}
@@ -0,0 +1,359 @@
+#include "ast/JsonWriter.h"
+#include "ast/Instructions.h"
+#include "ast/Operands.h"
+#include "parallel/TaskScheduler.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <vector>
+#include <utility>
+
+namespace AST {
+
+    namespace {
+        // Spaces per nesting level, matching dump(4)
+        constexpr int INDENT = 4;
+
+        const char* nodeTypeName(ASTConstants::NodeType type) {
+            switch (type) {
+                case ASTConstants::NodeType::ROOT: return "ROOT";
+                case ASTConstants::NodeType::INSTRUCTION: return "INSTRUCTION";
+                case ASTConstants::NodeType::OPERAND: return "OPERAND";
+                default: return "UNKNOWN";
+            }
+        }
+
+        // Uniform access to in-memory and binary AST nodes, so both are written by the same code
+        struct NodeFields {
+            ASTConstants::NodeType type;
+            // Instruction or operand type
+            int kind;
+            // Number of operands of instructions, position of operands
+            int detail;
+            int line;
+            std::string_view value;
+        };
+
+        int numChildren(const ASTNode* node) {
+            return node->getNumChildren();
+        }
+
+        const ASTNode* childAt(const ASTNode* node, int index) {
+            return node->getChildren()[index];
+        }
+
+        // Children are skipped if empty, as in toJson
+        bool isEmpty(const ASTNode* node) {
+            return node == nullptr;
+        }
+
+        NodeFields fieldsOf(const ASTNode* node) {
+            NodeFields fields{node->getNodeType(), 0, 0, 0, node->getNodeValue()};
+            if (fields.type == ASTConstants::INSTRUCTION) {
+                auto instruction = static_cast<const InstructionNode*>(node);
+                fields.kind = instruction->getInstructionType();
+                fields.detail = instruction->getNumOperands();
+                fields.line = instruction->getLine();
+            } else if (fields.type == ASTConstants::OPERAND) {
+                auto operand = static_cast<const OperandNode*>(node);
+                fields.kind = operand->getOperandType();
+                fields.detail = operand->getPos();
+                fields.line = operand->getLine();
+            }
+            return fields;
+        }
+
+        int numChildren(const BinaryAST::Node& node) {
+            return node.getNumChildren();
+        }
+
+        BinaryAST::Node childAt(const BinaryAST::Node& node, int index) {
+            return node.childAt(index);
+        }
+
+        bool isEmpty(const BinaryAST::Node&) {
+            return false;
+        }
+
+        NodeFields fieldsOf(const BinaryAST::Node& node) {
+            bool instruction = node.getNodeType() == ASTConstants::INSTRUCTION;
+            return {node.getNodeType(), instruction ? static_cast<int>(node.getInstructionType()) : static_cast<int>(node.getOperandType()),
+                    instruction ? static_cast<int>(node.getNumOperands()) : node.getPos(), node.getLine(), node.getNodeValue()};
+        }
+
+        // Root children on code lines [firstLine, lastLine] - they are stored in line order, so this is a binary search
+        template <typename Node>
+        std::pair<int, int> findLines(const Node& root, int firstLine, int lastLine) {
+            auto lowerBound = [&](int line) {
+                int low = 0, high = numChildren(root);
+                while (low < high) {
+                    int middle = low + (high - low) / 2;
+                    if (fieldsOf(childAt(root, middle)).line < line) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                return low;
+            };
+            int begin = lowerBound(firstLine);
+            int end = lastLine == INT_MAX ? numChildren(root) : lowerBound(lastLine + 1);
+            return {begin, std::max(begin, end)};
+        }
+
+        // Length of the valid UTF-8 sequence starting at position, 0 if the bytes there are not valid UTF-8
+        std::size_t utf8Length(std::string_view text, std::size_t position) {
+            auto byte = [&](std::size_t index) { return static_cast<unsigned char>(text[index]); };
+            unsigned char lead = byte(position);
+            std::size_t length;
+            unsigned char low = 0x80, high = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF) {
+                length = 2;
+            } else if (lead >= 0xE0 && lead <= 0xEF) {
+                length = 3;
+                // Reject overlong forms and UTF-16 surrogates
+                if (lead == 0xE0) low = 0xA0;
+                if (lead == 0xED) high = 0x9F;
+            } else if (lead >= 0xF0 && lead <= 0xF4) {
+                length = 4;
+                // Reject overlong forms and code points past U+10FFFF
+                if (lead == 0xF0) low = 0x90;
+                if (lead == 0xF4) high = 0x8F;
+            } else {
+                return 0;
+            }
+            if (position + length > text.size() || byte(position + 1) < low || byte(position + 1) > high) {
+                return 0;
+            }
+            for (std::size_t i = 2; i < length; i++) {
+                if (byte(position + i) < 0x80 || byte(position + i) > 0xBF) {
+                    return 0;
+                }
+            }
+            return length;
+        }
+    }
+
+    JsonWriter::JsonWriter(Sink sink) : m_sink(std::move(sink)) {
+        if (m_sink) {
+            m_buffer.reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+        }
+    }
+
+    JsonWriter::~JsonWriter() {
+        flush();
+    }
+
+    void JsonWriter::flush() {
+        // Writers without a sink (parallel chunks) keep everything in their buffer
+        if (m_sink && !m_buffer.empty()) {
+            std::string_view buffer = m_buffer;
+            m_sink(&buffer, 1);
+            m_buffer.clear();
+        }
+    }
+
+    void JsonWriter::write(const ASTNode* root) {
+        writeRoot(root, 0, numChildren(root));
+    }
+
+    void JsonWriter::writeLines(const ASTNode* root, int firstLine, int lastLine) {
+        auto [begin, end] = findLines(root, firstLine, lastLine);
+        writeRoot(root, begin, end);
+    }
+
+    void JsonWriter::writeLines(const BinaryAST& tree, int firstLine, int lastLine) {
+        auto [begin, end] = findLines(tree.getRoot(), firstLine, lastLine);
+        writeRoot(tree.getRoot(), begin, end);
+    }
+
+    template <typename Node>
+    void JsonWriter::writeRoot(const Node& root, int begin, int end) {
+        if (TaskScheduler::getJobs() > 1 && end - begin > static_cast<int>(CHUNK_NODES)) {
+            writeChunked(root, begin, end);
+        } else {
+            writeNode(root, 0, begin, end);
+        }
+    }
+
+    template <typename Node>
+    void JsonWriter::writeChunked(const Node& root, int begin, int end) {
+        m_buffer += "{\n";
+        writeIndent(1);
+        m_buffer += "\"children\": ";
+
+        // A window holds a few chunks per thread, so memory depends on the number of jobs and not on the program size
+        const int windowNodes = static_cast<int>(CHUNK_NODES) * SchedulerConstants::CHUNKS_PER_THREAD * TaskScheduler::getJobs();
+        std::vector<std::string> chunks;
+        std::vector<std::string_view> buffers;
+        bool empty = true;
+        for (int windowBegin = begin; windowBegin < end; windowBegin += windowNodes) {
+            const int windowEnd = std::min(end, windowBegin + windowNodes);
+            const int numChunks = (windowEnd - windowBegin + static_cast<int>(CHUNK_NODES) - 1) / static_cast<int>(CHUNK_NODES);
+            chunks.assign(numChunks, std::string());
+
+            // Each chunk is a contiguous slice of the children array, joined without its leading separator
+            TaskScheduler::instance().parallelFor(0, numChunks, [&](int chunkFirst, int chunkLast) {
+                for (int chunk = chunkFirst; chunk < chunkLast; chunk++) {
+                    JsonWriter writer(nullptr);
+                    const int chunkBegin = windowBegin + chunk * static_cast<int>(CHUNK_NODES);
+                    const int chunkEnd = std::min(windowEnd, chunkBegin + static_cast<int>(CHUNK_NODES));
+                    for (int i = chunkBegin; i < chunkEnd; i++) {
+                        auto child = childAt(root, i);
+                        if (isEmpty(child)) {
+                            continue;
+                        }
+                        if (!writer.m_buffer.empty()) {
+                            writer.m_buffer += ",\n";
+                        }
+                        writer.writeIndent(2);
+                        writer.writeNode(child, 2, 0, numChildren(child));
+                    }
+                    chunks[chunk] = std::move(writer.m_buffer);
+                }
+            }, 1);
+
+            // Hand the pending output and the window's chunks to the sink in order, with the separators between them
+            buffers.clear();
+            buffers.emplace_back(m_buffer);
+            for (const std::string& chunk : chunks) {
+                if (chunk.empty()) {
+                    continue;
+                }
+                buffers.emplace_back(empty ? "[\n" : ",\n");
+                buffers.emplace_back(chunk);
+                empty = false;
+            }
+            m_sink(buffers.data(), buffers.size());
+            m_buffer.clear();
+        }
+
+        if (empty) {
+            m_buffer += "[]";
+        } else {
+            m_buffer += '\n';
+            writeIndent(1);
+            m_buffer += ']';
+        }
+        writeMembers(root, 0);
+    }
+
+    template <typename Node>
+    void JsonWriter::writeNode(const Node& node, int depth, int begin, int end) {
+        // Keys are written in the sorted order nlohmann::json objects use
+        m_buffer += "{\n";
+        writeIndent(depth + 1);
+        m_buffer += "\"children\": ";
+        bool empty = true;
+        for (int i = begin; i < end; i++) {
+            auto child = childAt(node, i);
+            if (isEmpty(child)) {
+                continue;
+            }
+            m_buffer += empty ? "[\n" : ",\n";
+            empty = false;
+            writeIndent(depth + 2);
+            writeNode(child, depth + 2, 0, numChildren(child));
+            // Flushing between children bounds the buffer to BUFFER_SIZE plus a single instruction
+            if (m_buffer.size() >= BUFFER_SIZE) {
+                flush();
+            }
+        }
+        if (empty) {
+            m_buffer += "[]";
+        } else {
+            m_buffer += '\n';
+            writeIndent(depth + 1);
+            m_buffer += ']';
+        }
+        writeMembers(node, depth);
+    }
+
+    template <typename Node>
+    void JsonWriter::writeMembers(const Node& node, int depth) {
+        const NodeFields fields = fieldsOf(node);
+        if (fields.type == ASTConstants::INSTRUCTION) {
+            writeKey(depth + 1, "instruction_type");
+            writeInteger(fields.kind);
+            writeKey(depth + 1, "line");
+            writeInteger(fields.line);
+            writeKey(depth + 1, "num_operands");
+            writeInteger(fields.detail);
+        } else if (fields.type == ASTConstants::OPERAND) {
+            writeKey(depth + 1, "line");
+            writeInteger(fields.line);
+            writeKey(depth + 1, "operand_type");
+            writeInteger(fields.kind);
+            writeKey(depth + 1, "position");
+            writeInteger(fields.detail);
+        }
+        writeKey(depth + 1, "type");
+        writeString(nodeTypeName(fields.type));
+        writeKey(depth + 1, "value");
+        writeString(fields.value);
+        m_buffer += '\n';
+        writeIndent(depth);
+        m_buffer += '}';
+    }
+
+    void JsonWriter::writeIndent(int depth) {
+        m_buffer.append(static_cast<std::size_t>(depth * INDENT), ' ');
+    }
+
+    void JsonWriter::writeKey(int depth, std::string_view key) {
+        // Every key but the first ("children", written by writeNode) follows another member
+        m_buffer += ",\n";
+        writeIndent(depth);
+        m_buffer += '"';
+        m_buffer += key;
+        m_buffer += "\": ";
+    }
+
+    void JsonWriter::writeInteger(long long value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_buffer.append(digits, result.ptr);
+    }
+
+    void JsonWriter::writeString(std::string_view value) {
+        // Same escapes as dump(): short forms where JSON has them, \u00xx for other control characters
+        static constexpr char HEX[] = "0123456789abcdef";
+        m_buffer += '"';
+        std::size_t position = 0;
+        while (position < value.size()) {
+            auto c = static_cast<unsigned char>(value[position]);
+            if (c >= 0x80) {
+                // Valid UTF-8 is copied as is, invalid bytes become U+FFFD rather than aborting the whole output
+                std::size_t length = utf8Length(value, position);
+                if (length == 0) {
+                    m_buffer += "\xEF\xBF\xBD";
+                    position++;
+                } else {
+                    m_buffer.append(value.data() + position, length);
+                    position += length;
+                }
+                continue;
+            }
+            switch (c) {
+                case '"': m_buffer += "\\\""; break;
+                case '\\': m_buffer += "\\\\"; break;
+                case '\b': m_buffer += "\\b"; break;
+                case '\f': m_buffer += "\\f"; break;
+                case '\n': m_buffer += "\\n"; break;
+                case '\r': m_buffer += "\\r"; break;
+                case '\t': m_buffer += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        m_buffer += "\\u00";
+                        m_buffer += HEX[c >> 4];
+                        m_buffer += HEX[c & 0xF];
+                    } else {
+                        m_buffer += static_cast<char>(c);
+                    }
+            }
+            position++;
+        }
+        m_buffer += '"';
+    }
+}
@@ -0,0 +1,300 @@
+#include "cache/CompileCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    //XXH64 - hashes the source at memory bandwidth, so warm lookups of huge files stay cheap
+    constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+    constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+    constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+    constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+    constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+    uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t read64(const char* data) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t read32(const char* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint64_t round(uint64_t accumulator, uint64_t input) {
+        accumulator += input * PRIME2;
+        return rotateLeft(accumulator, 31) * PRIME1;
+    }
+
+    uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+        accumulator ^= round(0, value);
+        return accumulator * PRIME1 + PRIME4;
+    }
+
+    uint64_t hash64(const char* data, size_t length, uint64_t seed) {
+        const char* end = data + length;
+        uint64_t hash;
+        if (length >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+            for (; data + 32 <= end; data += 32) {
+                v1 = round(v1, read64(data));
+                v2 = round(v2, read64(data + 8));
+                v3 = round(v3, read64(data + 16));
+                v4 = round(v4, read64(data + 24));
+            }
+            hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+            hash = mergeRound(mergeRound(mergeRound(mergeRound(hash, v1), v2), v3), v4);
+        }
+        else {
+            hash = seed + PRIME5;
+        }
+        hash += length;
+        for (; data + 8 <= end; data += 8) {
+            hash ^= round(0, read64(data));
+            hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+        }
+        if (data + 4 <= end) {
+            hash ^= static_cast<uint64_t>(read32(data)) * PRIME1;
+            hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+            data += 4;
+        }
+        for (; data < end; data++) {
+            hash ^= static_cast<uint64_t>(static_cast<unsigned char>(*data)) * PRIME5;
+            hash = rotateLeft(hash, 11) * PRIME1;
+        }
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    string toHex(uint64_t value) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    //Create a directory and its missing parents
+    void makeDirectories(const string& path) {
+        for (size_t position = path.find('/', 1); position != string::npos; position = path.find('/', position + 1)) {
+            mkdir(path.substr(0, position).c_str(), 0755);
+        }
+        mkdir(path.c_str(), 0755);
+    }
+
+    //Entry serialization helpers (native byte order - entries never leave the machine that wrote them)
+    template <typename T>
+    void writeValue(string& buffer, T value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void writeString(string& buffer, const string& value) {
+        writeValue<uint64_t>(buffer, value.size());
+        buffer += value;
+    }
+
+    //Output is stored 8-byte aligned, so binary results (such as a binary AST) can be used in place from the mapping
+    void writeAlignedString(string& buffer, string_view value) {
+        writeValue<uint64_t>(buffer, value.size());
+        buffer.resize((buffer.size() + 7) / 8 * 8, '\0');
+        buffer += value;
+    }
+
+    //Reads values from an entry, failing on truncated input
+    class EntryReader {
+        public:
+            explicit EntryReader(string_view buffer) : m_buffer(buffer) {}
+
+            template <typename T>
+            bool read(T& value) {
+                if (m_position + sizeof(value) > m_buffer.size()) {
+                    return false;
+                }
+                memcpy(&value, m_buffer.data() + m_position, sizeof(value));
+                m_position += sizeof(value);
+                return true;
+            }
+
+            bool read(string& value) {
+                uint64_t length;
+                if (!read(length) || length > m_buffer.size() - m_position) {
+                    return false;
+                }
+                value.assign(m_buffer, m_position, length);
+                m_position += length;
+                return true;
+            }
+
+            bool readAligned(string_view& value) {
+                uint64_t length;
+                if (!read(length)) {
+                    return false;
+                }
+                m_position = min(m_buffer.size(), (m_position + 7) / 8 * 8);
+                if (length > m_buffer.size() - m_position) {
+                    return false;
+                }
+                value = m_buffer.substr(m_position, length);
+                m_position += length;
+                return true;
+            }
+
+            [[nodiscard]] bool atEnd() const {
+                return m_position == m_buffer.size();
+            }
+
+        private:
+            string_view m_buffer;
+            size_t m_position = 0;
+    };
+
+    constexpr char MAGIC[8] = {'S', 'A', 'S', 'M', 'C', 'A', 'C', 'H'};
+}
+
+CompileCache::CompileCache(std::string directory) : m_directory(std::move(directory)) {
+    if (m_directory.empty()) {
+        string base = userCacheDirectory();
+        m_directory = base.empty() ? "" : base + "/compile";
+    }
+}
+
+std::string CompileCache::userCacheDirectory() {
+    //Follow the XDG base directory convention
+    string directory;
+    if (const char* cacheHome = getenv("XDG_CACHE_HOME"); cacheHome != nullptr && *cacheHome != '\0') {
+        directory = cacheHome;
+    }
+    else if (const char* home = getenv("HOME"); home != nullptr && *home != '\0') {
+        directory = string(home) + "/.cache";
+    }
+    else {
+        return "";
+    }
+    mkdir(directory.c_str(), 0755);
+    directory += "/startasm";
+    mkdir(directory.c_str(), 0755);
+    return directory;
+}
+
+std::string CompileCache::key(std::string_view source, const std::string& configuration, const std::vector<std::string>& buildFiles) {
+    //The build identity is the size and modification time of every compiler binary, so rebuilding invalidates old entries
+    string identity = configuration + " format=" + to_string(CacheConstants::FORMAT_VERSION);
+    for (const string& file : buildFiles) {
+        struct stat status{};
+        if (stat(file.c_str(), &status) == 0) {
+            identity += " " + to_string(status.st_size) + ":" + to_string(status.st_mtim.tv_sec) + "." + to_string(status.st_mtim.tv_nsec);
+        }
+    }
+    return toHex(hash64(source.data(), source.size(), 0)) + toHex(hash64(identity.data(), identity.size(), 0));
+}
+
+std::string CompileCache::entryPath(const std::string& key) const {
+    return m_directory + "/" + key + ".entry";
+}
+
+bool CompileCache::load(const std::string& key, std::string_view source, CacheEntry& entry) const {
+    if (m_directory.empty()) {
+        return false;
+    }
+    //Map the entry rather than reading it, as AST entries can be as large as the JSON they hold and often only a part is used
+    int file = open(entryPath(key).c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status{};
+    void* data = fstat(file, &status) == 0 && status.st_size > 0 ?
+                 mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    entry.mapping = shared_ptr<const void>(data, [size](const void* mapping) {
+        munmap(const_cast<void*>(mapping), size);
+    });
+
+    EntryReader reader(string_view(static_cast<const char*>(data), size));
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint64_t sourceSize;
+    uint8_t success;
+    uint64_t numDiagnostics;
+    //The source size is checked as well, guarding against hash collisions on top of the 128 bit key
+    if (!reader.read(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !reader.read(version) || version != CacheConstants::FORMAT_VERSION ||
+        !reader.read(sourceSize) || sourceSize != source.size() || !reader.read(success) || !reader.read(numDiagnostics)) {
+        return false;
+    }
+    entry.success = success != 0;
+    entry.diagnostics.clear();
+    for (uint64_t i = 0; i < numDiagnostics; i++) {
+        uint8_t phase;
+        uint16_t code;
+        //Every field is filled in from the entry
+        Diagnostic diagnostic{};
+        if (!reader.read(phase) || !reader.read(code) || !reader.read(diagnostic.line) || !reader.read(diagnostic.column) ||
+            !reader.read(diagnostic.length) || !reader.read(diagnostic.number) || !reader.read(diagnostic.expected) ||
+            !reader.read(diagnostic.args[0]) || !reader.read(diagnostic.args[1]) || phase >= DiagnosticConstants::NUM_PHASES) {
+            return false;
+        }
+        diagnostic.phase = static_cast<DiagnosticConstants::Phase>(phase);
+        diagnostic.code = static_cast<DiagnosticConstants::Code>(code);
+        entry.diagnostics.push_back(std::move(diagnostic));
+    }
+    return reader.readAligned(entry.output) && reader.atEnd();
+}
+
+void CompileCache::store(const std::string& key, std::string_view source, const CacheEntry& entry) const {
+    if (m_directory.empty()) {
+        return;
+    }
+    string buffer(MAGIC, sizeof(MAGIC));
+    writeValue<uint32_t>(buffer, CacheConstants::FORMAT_VERSION);
+    writeValue<uint64_t>(buffer, source.size());
+    writeValue<uint8_t>(buffer, entry.success ? 1 : 0);
+    writeValue<uint64_t>(buffer, entry.diagnostics.size());
+    for (const Diagnostic& diagnostic : entry.diagnostics) {
+        writeValue<uint8_t>(buffer, diagnostic.phase);
+        writeValue<uint16_t>(buffer, diagnostic.code);
+        writeValue(buffer, diagnostic.line);
+        writeValue(buffer, diagnostic.column);
+        writeValue(buffer, diagnostic.length);
+        writeValue(buffer, diagnostic.number);
+        writeValue(buffer, diagnostic.expected);
+        writeString(buffer, diagnostic.args[0]);
+        writeString(buffer, diagnostic.args[1]);
+    }
+    writeAlignedString(buffer, entry.output);
+
+    //Write to a temporary file and rename, so concurrent compilers never read a partial entry
+    makeDirectories(m_directory);
+    string path = entryPath(key);
+    string temporary = path + "." + to_string(getpid()) + ".tmp";
+    {
+        ofstream output(temporary, ios::binary | ios::trunc);
+        if (!output.write(buffer.data(), static_cast<streamsize>(buffer.size()))) {
+            output.close();
+            remove(temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,59 @@
+#include "codegen/Backend.h"
+
+#include <dlfcn.h>
+#include <unistd.h>
+#include <climits>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+namespace {
+    //Directory of the running executable (with a trailing slash), where the build places the backend module
+    string executableDirectory() {
+        char path[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (length <= 0) {
+            return "";
+        }
+        string directory(path, length);
+        return directory.substr(0, directory.find_last_of('/') + 1);
+    }
+}
+
+string Backend::modulePath() {
+    return executableDirectory() + BackendConstants::MODULE_NAME;
+}
+
+string Backend::runtimePath() {
+    return executableDirectory() + BackendConstants::RUNTIME_NAME;
+}
+
+string Backend::runtimeObjectPath() {
+    return executableDirectory() + BackendConstants::RUNTIME_OBJECT_NAME;
+}
+
+unique_ptr<Backend> Backend::load(string& error) {
+    //The module is opened at most once and stays loaded for the rest of the process
+    static once_flag loaded;
+    static BackendFactory factory = nullptr;
+    static string loadError;
+    call_once(loaded, [] {
+        void* handle = dlopen(modulePath().c_str(), RTLD_LAZY | RTLD_LOCAL);
+        if (handle == nullptr) {
+            //Fall back to the dynamic linker search path, keeping the first error as the more useful one
+            loadError = dlerror();
+            handle = dlopen(BackendConstants::MODULE_NAME, RTLD_LAZY | RTLD_LOCAL);
+            if (handle == nullptr) {
+                return;
+            }
+        }
+        factory = reinterpret_cast<BackendFactory>(dlsym(handle, BackendConstants::FACTORY_SYMBOL));
+        loadError = factory == nullptr ? dlerror() : "";
+    });
+    if (factory == nullptr) {
+        error = loadError;
+        return nullptr;
+    }
+    return unique_ptr<Backend>(factory());
+}
@@ -2,160 +2,1352 @@
 #include "ast/Instructions.h"
 #include "ast/Operands.h"
 
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "parallel/TaskScheduler.h"
+
+using namespace CodeGenConstants;
+using namespace RuntimeConstants;
+
+namespace {
+    //Generator whose program is running, which compiles the regions it reaches (a process runs one program at a time)
+    CodeGenerator* running = nullptr;
+
+    //Register index of a register operand (the scope checker guarantees r0-r9)
+    int registerIndex(const AST::ASTNode* node) {
+        return node->getNodeValue()[1] - '0';
+    }
+
+    //Index of an m<N> or i[N] operand (the scope checker guarantees it fits)
+    int addressIndex(const AST::ASTNode* node) {
+        return static_cast<int>(std::strtol(node->getNodeValue().c_str() + 2, nullptr, 10));
+    }
+
+    ASTConstants::OperandType operandType(const AST::ASTNode* node) {
+        return static_cast<const AST::OperandNode*>(node)->getOperandType();
+    }
+
+    ValueType typeOf(const std::string& typeCondition) {
+        if (typeCondition == "integer") return INTEGER;
+        if (typeCondition == "float") return FLOAT;
+        if (typeCondition == "boolean") return BOOLEAN;
+        if (typeCondition == "character") return CHARACTER;
+        if (typeCondition == "memory") return MEMORY;
+        return INSTRUCTION;
+    }
+
+    //32 bit payload of an immediate operand created as the given type
+    //NOTE - the operand is read by the type it is created as, since digits lex as integers (create character 0)
+    std::int32_t immediate(ValueType type, const AST::ASTNode* node) {
+        const std::string& value = node->getNodeValue();
+        switch (type) {
+            case FLOAT: {
+                float number = std::strtof(value.c_str(), nullptr);
+                std::int32_t bits;
+                std::memcpy(&bits, &number, sizeof(bits));
+                return bits;
+            }
+            case BOOLEAN:
+                return value == "true" || value == "1";
+            case CHARACTER:
+                return static_cast<unsigned char>(value[0]);
+            case MEMORY:
+            case INSTRUCTION:
+                if (operandType(node) == ASTConstants::MEMORYADDRESS || operandType(node) == ASTConstants::INSTRUCTIONADDRESS) {
+                    return addressIndex(node);
+                }
+                [[fallthrough]];
+            default:
+                return static_cast<std::int32_t>(std::strtoll(value.c_str(), nullptr, 10));
+        }
+    }
+
+    //Lines starting a block (indexed 1 to one past the last line) - the program start, literal instruction
+    //addresses, and lines following a jump, call, return or stop, so a label's region becomes one block
+    //Register jumps and returns dispatch on these lines only, unless the program computes an address (arithmetic on
+    //addresses, casts or inputs - see TypeInference), in which case every line has to be a block. Running lazily,
+    //a region can start at any line, so the leaders are found as if none was computed
+    std::vector<char> findLeaders(const std::vector<AST::ASTNode*>& instructions, bool computed) {
+        int numLines = static_cast<int>(instructions.size());
+        std::vector<char> leaders(numLines + 2, false);
+        leaders[1] = true;
+        leaders[numLines + 1] = true;
+        bool dynamic = false;
+        for (auto* child : instructions) {
+            auto* instruction = static_cast<AST::InstructionNode*>(child);
+            const auto& operands = instruction->getChildren();
+            int line = instruction->getLine();
+            for (auto* operand : operands) {
+                if (operandType(operand) == ASTConstants::INSTRUCTIONADDRESS) {
+                    leaders[std::max(addressIndex(operand), 1)] = true;
+                }
+            }
+            switch (instruction->getInstructionType()) {
+                case ASTConstants::JUMP:
+                case ASTConstants::CALL:
+                    dynamic = dynamic || operandType(operands.back()) == ASTConstants::REGISTER;
+                    leaders[line + 1] = true;
+                    break;
+                case ASTConstants::RETURN:
+                    dynamic = true;
+                    leaders[line + 1] = true;
+                    break;
+                case ASTConstants::STOP:
+                    leaders[line + 1] = true;
+                    break;
+                case ASTConstants::CREATE:
+                    //Instruction addresses can also be created from integers
+                    if (typeOf(operands[0]->getNodeValue()) == INSTRUCTION) {
+                        std::int32_t target = immediate(INSTRUCTION, operands[1]);
+                        if (target >= 0 && target <= numLines + 1) {
+                            leaders[std::max(target, 1)] = true;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (dynamic && computed) {
+            std::fill(leaders.begin(), leaders.end(), true);
+        }
+        return leaders;
+    }
+
+    //Target machine of the host, so the optimizer knows its data layout and cost model
+    std::unique_ptr<llvm::TargetMachine> hostTargetMachine() {
+        static std::once_flag initialized;
+        std::call_once(initialized, [] {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+        });
+        std::string triple = llvm::sys::getDefaultTargetTriple();
+        std::string error;
+        const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (target == nullptr) {
+            return nullptr;
+        }
+        //Position independent, as the system C compiler links executables as PIE by default
+        return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+            triple, llvm::sys::getHostCPUName(), "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+    }
+
+    //Link an object into an executable with the C compiler ($CC, cc by default), which adds the startup code and the
+    //C library the program calls into
+    //The native runtime object is linked in as well if given
+    bool linkExecutable(const std::string& object, const std::string& runtime, const std::string& path, std::string& error) {
+        const char* compiler = std::getenv("CC");
+        std::string name = compiler != nullptr && *compiler != '\0' ? compiler : "cc";
+        llvm::ErrorOr<std::string> program = llvm::sys::findProgramByName(name);
+        if (!program) {
+            error = "no C compiler '" + name + "' to link with";
+            return false;
+        }
+        std::vector<llvm::StringRef> arguments = {*program, object};
+        if (!runtime.empty()) {
+            arguments.push_back(runtime);
+        }
+        arguments.insert(arguments.end(), {"-o", path, "-lm"});
+        std::string message;
+        int status = llvm::sys::ExecuteAndWait(*program, arguments, llvm::None, {}, 0, 0, &message);
+        if (status != 0) {
+            error = message.empty() ? "linking with " + name + " failed" : message;
+            return false;
+        }
+        return true;
+    }
+
+    //Bitcode of the runtime library, read once per process, null if the build did not produce it
+    const llvm::MemoryBuffer* runtimeBitcode() {
+        static std::once_flag loaded;
+        static std::unique_ptr<llvm::MemoryBuffer> bitcode;
+        std::call_once(loaded, [] {
+            llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file = llvm::MemoryBuffer::getFile(Backend::runtimePath());
+            if (file) {
+                bitcode = std::move(*file);
+            }
+        });
+        return bitcode.get();
+    }
+
+    //Whether a module calls runtime functions it doesn't define, which the native runtime object then provides
+    bool needsRuntimeObject(const llvm::Module& module) {
+        for (const char* name : {"startasm.fail", "startasm.cell", "startasm.output"}) {
+            const llvm::Function* function = module.getFunction(name);
+            if (function != nullptr && function->isDeclaration()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //First line of each partition (and one past the last line) - about as many lines each, starting at leaders so no
+    //region is split across partitions
+    std::vector<int> partitionStarts(const std::vector<char>& leaders, int count) {
+        int numLines = static_cast<int>(leaders.size()) - 2;
+        std::vector<int> starts = {1};
+        for (int partition = 1; partition < count; partition++) {
+            int line = std::max(static_cast<int>(1 + static_cast<long long>(numLines) * partition / count), starts.back() + 1);
+            while (line <= numLines && !leaders[line]) {
+                line++;
+            }
+            if (line > numLines) {
+                break;
+            }
+            starts.push_back(line);
+        }
+        starts.push_back(numLines + 1);
+        return starts;
+    }
+
+    //Run the standard pipeline of the level over a module, timing the passes through the instrumentation if given
+    void runPipeline(llvm::Module& module, llvm::TargetMachine* targetMachine, int level,
+                     llvm::PassInstrumentationCallbacks* instrumentation) {
+        llvm::PassBuilder passBuilder(targetMachine, llvm::PipelineTuningOptions(), llvm::None, instrumentation);
+        llvm::LoopAnalysisManager loopAnalyses;
+        llvm::FunctionAnalysisManager functionAnalyses;
+        llvm::CGSCCAnalysisManager sccAnalyses;
+        llvm::ModuleAnalysisManager moduleAnalyses;
+        passBuilder.registerModuleAnalyses(moduleAnalyses);
+        passBuilder.registerCGSCCAnalyses(sccAnalyses);
+        passBuilder.registerFunctionAnalyses(functionAnalyses);
+        passBuilder.registerLoopAnalyses(loopAnalyses);
+        passBuilder.crossRegisterProxies(loopAnalyses, functionAnalyses, sccAnalyses, moduleAnalyses);
+
+        llvm::ModulePassManager passes;
+        switch (level) {
+            case 0:
+                passes = passBuilder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+                break;
+            case 1:
+                passes = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1);
+                break;
+            case 2:
+                passes = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+                break;
+            default:
+                passes = passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+                break;
+        }
+        passes.run(module, moduleAnalyses);
+    }
+}
+
 
 CodeGenerator::CodeGenerator()
-        : context(), builder(context) {
-    module = std::make_unique<llvm::Module>("StartASMModule", context);
+        : m_context(std::make_unique<llvm::LLVMContext>()), context(*m_context.getContext()), builder(context) {
+    m_targetMachine = hostTargetMachine();
+    createModule("StartASMModule");
+    m_int = builder.getInt32Ty();
+    m_valueType = llvm::StructType::create(context, {m_int, m_int}, "value");
 }
 
 void CodeGenerator::visit(AST::RootNode& node) {
-    std::cout << "TODO: Root Node\n";
+    declareRuntime();
+    defineState(true);
+    defineRuntime();
+
+    m_function = llvm::Function::Create(llvm::FunctionType::get(m_int, false), llvm::GlobalValue::ExternalLinkage,
+                                        "main", *module);
+    auto* entry = llvm::BasicBlock::Create(context, "entry", m_function);
+
+    //i[N] is code line N - i[0] is the start of the program, the line past the end exits
+    const auto& children = node.getChildren();
+    m_instructions = &children;
+    int numLines = static_cast<int>(children.size());
+    std::vector<char> leaders = findLeaders(children, m_types->computesAddresses());
+    m_lines.assign(numLines + 2, nullptr);
+    for (int line = 1; line <= numLines; line++) {
+        if (leaders[line]) {
+            m_lines[line] = llvm::BasicBlock::Create(context, "i" + std::to_string(line), m_function);
+        }
+    }
+    m_lines[numLines + 1] = llvm::BasicBlock::Create(context, "exit", m_function);
+    m_lines[0] = m_lines[1];
+    builder.SetInsertPoint(m_lines[numLines + 1]);
+    builder.CreateRet(builder.getInt32(0));
+
+    builder.SetInsertPoint(entry);
+    createLocals();
+    builder.CreateBr(m_lines[0]);
+    lowerLines(1, numLines);
+
+    if (m_dispatch != nullptr) {
+        auto* invalid = llvm::BasicBlock::Create(context, "invalid.address", m_function);
+        builder.SetInsertPoint(m_dispatch);
+        auto* dispatch = builder.CreateSwitch(m_dispatchAddress, invalid, numLines + 2);
+        for (int line = 0; line <= numLines + 1; line++) {
+            if (m_lines[line] != nullptr) {
+                dispatch->addCase(builder.getInt32(line), m_lines[line]);
+            }
+        }
+        builder.SetInsertPoint(invalid);
+        if (m_checks == BackendConstants::FULL_CHECKS) {
+            builder.CreateCall(m_fail, {m_dispatchLine, stringConstant("Jump to an instruction address outside the program")});
+        }
+        else if (m_checks == BackendConstants::FAST_CHECKS) {
+            builder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+        }
+        builder.CreateUnreachable();
+    }
+}
+
+void CodeGenerator::lowerLines(int first, int last) {
+    //Lower the instructions in order - each region runs from a leader to the next, falling through to it
+    const auto& instructions = *m_instructions;
+    for (int line = first; line <= last; line++) {
+        m_line = line;
+        if (m_lines[m_line] != nullptr) {
+            if (m_line > first && builder.GetInsertBlock()->getTerminator() == nullptr) {
+                builder.CreateBr(m_lines[m_line]);
+            }
+            builder.SetInsertPoint(m_lines[m_line]);
+            int next = m_line + 1;
+            while (m_lines[next] == nullptr) {
+                next++;
+            }
+            m_regionEnd = m_lines[next];
+        }
+        instructions[line - 1]->accept(*this);
+    }
+    if (last >= first && builder.GetInsertBlock()->getTerminator() == nullptr) {
+        builder.CreateBr(m_lines[last + 1]);
+    }
+}
+
+void CodeGenerator::lowerPartition(int first, int last, const std::vector<char>& leaders) {
+    //i32 partition.N(i32 line) - runs the program from one of its leaders until it leaves the partition
+    m_lines.assign(m_instructions->size() + 2, nullptr);
+    m_function = llvm::Function::Create(llvm::FunctionType::get(m_int, {m_int}, false), llvm::GlobalValue::ExternalLinkage,
+                                        "partition." + std::to_string(first), *module);
+    auto* entry = llvm::BasicBlock::Create(context, "entry", m_function);
+    for (int line = first; line <= last; line++) {
+        if (leaders[line]) {
+            m_lines[line] = llvm::BasicBlock::Create(context, "i" + std::to_string(line), m_function);
+        }
+    }
+    if (first == 1) {
+        m_lines[0] = m_lines[1];
+    }
+    //Main only enters a partition at one of its leaders - every line a register can hold is one (findLeaders)
+    auto* unknown = llvm::BasicBlock::Create(context, "unknown.line", m_function);
+    builder.SetInsertPoint(unknown);
+    builder.CreateUnreachable();
+    builder.SetInsertPoint(entry);
+    createLocals();
+    auto* lines = builder.CreateSwitch(m_function->getArg(0), unknown);
+    for (int line = first; line <= last; line++) {
+        if (m_lines[line] != nullptr) {
+            lines->addCase(builder.getInt32(line), m_lines[line]);
+        }
+    }
+    lineBlock(last + 1);
+    lowerLines(first, last);
+}
+
+bool CodeGenerator::generatePartitions(const std::vector<AST::ASTNode*>& instructions, const std::vector<char>& leaders,
+                                       const std::vector<int>& starts) {
+    //Partitions are lowered on threads of their own, each by a generator with its own context and module
+    int count = static_cast<int>(starts.size()) - 1;
+    m_partitions.resize(count);
+    std::vector<char> valid(count, false);
+    {
+        TaskScheduler::TaskGroup partitions;
+        for (int partition = 0; partition < count; partition++) {
+            partitions.run([&, partition] {
+                auto generator = std::make_unique<CodeGenerator>();
+                generator->m_split = true;
+                generator->m_checks = m_checks;
+                generator->m_types = m_types;
+                generator->m_instructions = &instructions;
+                generator->declareRuntime();
+                generator->defineState(false);
+                generator->defineRuntime();
+                generator->lowerPartition(starts[partition], starts[partition + 1] - 1, leaders);
+                valid[partition] = !llvm::verifyModule(*generator->module);
+                m_partitions[partition] = std::move(generator);
+            });
+        }
+        partitions.wait();
+    }
+
+    //This module holds the state, and main runs the partition holding the current line until the program exits
+    m_split = true;
+    defineState(true);
+    int numLines = static_cast<int>(instructions.size());
+    auto* partitionType = llvm::FunctionType::get(m_int, {m_int}, false);
+    m_function = llvm::Function::Create(llvm::FunctionType::get(m_int, false), llvm::GlobalValue::ExternalLinkage,
+                                        "main", *module);
+    auto* entry = llvm::BasicBlock::Create(context, "entry", m_function);
+    auto* loop = llvm::BasicBlock::Create(context, "loop", m_function);
+    auto* exit = llvm::BasicBlock::Create(context, "exit", m_function);
+    builder.SetInsertPoint(entry);
+    builder.CreateBr(loop);
+    builder.SetInsertPoint(loop);
+    llvm::PHINode* line = builder.CreatePHI(m_int, count + 1, "line");
+    line->addIncoming(builder.getInt32(1), entry);
+    auto* route = llvm::BasicBlock::Create(context, "route", m_function, exit);
+    builder.CreateCondBr(builder.CreateICmpEQ(line, builder.getInt32(numLines + 1)), exit, route);
+    for (int partition = 0; partition < count; partition++) {
+        std::string name = "partition." + std::to_string(starts[partition]);
+        auto* call = llvm::BasicBlock::Create(context, name, m_function, exit);
+        if (partition + 1 < count) {
+            auto* next = llvm::BasicBlock::Create(context, "route", m_function, exit);
+            builder.SetInsertPoint(route);
+            builder.CreateCondBr(builder.CreateICmpSLT(line, builder.getInt32(starts[partition + 1])), call, next);
+            route = next;
+        }
+        else {
+            builder.SetInsertPoint(route);
+            builder.CreateBr(call);
+        }
+        builder.SetInsertPoint(call);
+        line->addIncoming(builder.CreateCall(module->getOrInsertFunction(name, partitionType), {line}), call);
+        builder.CreateBr(loop);
+    }
+    builder.SetInsertPoint(exit);
+    builder.CreateRet(builder.getInt32(0));
+    return std::all_of(valid.begin(), valid.end(), [](char partition) { return partition; }) && !llvm::verifyModule(*module);
+}
+
+void CodeGenerator::linkPartitions() {
+    //Modules of different contexts can't be linked directly - each partition is written out as bitcode on a thread
+    //of its own, then read back into this context
+    std::vector<llvm::SmallVector<char, 0>> bitcode(m_partitions.size());
+    {
+        TaskScheduler::TaskGroup writers;
+        for (std::size_t partition = 0; partition < m_partitions.size(); partition++) {
+            writers.run([&, partition] {
+                llvm::raw_svector_ostream stream(bitcode[partition]);
+                llvm::WriteBitcodeToFile(*m_partitions[partition]->module, stream);
+                m_partitions[partition].reset();
+            });
+        }
+        writers.wait();
+    }
+    m_partitions.clear();
+    llvm::Linker linker(*module);
+    for (const auto& code : bitcode) {
+        //The bitcode was just written by this process, so reading it can't fail
+        auto partition = llvm::cantFail(llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(llvm::StringRef(code.data(), code.size()), "partition"), context));
+        if (linker.linkInModule(std::move(partition))) {
+            llvm::report_fatal_error("Code generation failed. The partitions could not be linked.");
+        }
+    }
+    //Once linked, only main has to be visible
+    for (auto& function : module->functions()) {
+        if (!function.isDeclaration() && function.getName() != "main") {
+            function.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+    for (auto& global : module->globals()) {
+        if (!global.isDeclaration()) {
+            global.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
 }
 
 void CodeGenerator::visit(AST::MoveInstruction& node) {
-    std::cout << "TODO: MoveInstruction\n";
+    storeRegister(node.getChildren()[1], loadRegister(node.getChildren()[0]));
 }
 
 void CodeGenerator::visit(AST::LoadInstruction& node) {
-    std::cout << "TODO: LoadInstruction\n";
+    llvm::Value* cell = memoryCell(node.getChildren()[0]);
+    storeRegister(node.getChildren()[1], loadValue(cell));
 }
 
 void CodeGenerator::visit(AST::StoreInstruction& node) {
-    std::cout << "TODO: StoreInstruction\n";
+    Value value = loadRegister(node.getChildren()[0]);
+    storeValue(memoryCell(node.getChildren()[1]), value);
 }
 
 void CodeGenerator::visit(AST::CreateInstruction& node) {
-    std::cout << "TODO: CreateInstruction\n";
+    const auto& operands = node.getChildren();
+    ValueType type = typeOf(operands[0]->getNodeValue());
+    storeRegister(operands[2], {builder.getInt32(type), builder.getInt32(immediate(type, operands[1]))});
 }
 
 void CodeGenerator::visit(AST::CastInstruction& node) {
-    std::cout << "TODO: CastInstruction\n";
+    //Casting reinterprets the payload as the new type
+    const auto& operands = node.getChildren();
+    Value value = loadRegister(operands[1]);
+    storeRegister(operands[1], {builder.getInt32(typeOf(operands[0]->getNodeValue())), value.second});
 }
 
 void CodeGenerator::visit(AST::AddInstruction& node) {
-    std::cout << "TODO: AddInstruction\n";
+    arithmetic(node, llvm::Instruction::Add, llvm::Instruction::FAdd, {INTEGER, FLOAT, CHARACTER, MEMORY, INSTRUCTION},
+               "integers, floats, characters or addresses");
 }
 
 void CodeGenerator::visit(AST::SubInstruction& node) {
-    std::cout << "TODO: SubInstruction\n";
+    arithmetic(node, llvm::Instruction::Sub, llvm::Instruction::FSub, {INTEGER, FLOAT, CHARACTER, MEMORY, INSTRUCTION},
+               "integers, floats, characters or addresses");
 }
 
 void CodeGenerator::visit(AST::MultiplyInstruction& node) {
-    std::cout << "TODO: MultiplyInstruction\n";
+    arithmetic(node, llvm::Instruction::Mul, llvm::Instruction::FMul, {INTEGER, FLOAT, CHARACTER},
+               "integers, floats or characters");
 }
 
 void CodeGenerator::visit(AST::DivideInstruction& node) {
-    std::cout << "TODO: DivideInstruction\n";
+    const auto& operands = node.getChildren();
+    Value a = loadRegister(operands[0]);
+    Value b = loadRegister(operands[1]);
+    checkOperands(node, a, b, {INTEGER, FLOAT, CHARACTER}, "integers, floats or characters");
+
+    //Integer division by zero fails, the one overflowing quotient (minimum by -1) wraps
+    llvm::Value* isFloat = builder.CreateICmpEQ(a.first, builder.getInt32(FLOAT));
+    llvm::Value* isZero = builder.CreateICmpEQ(b.second, builder.getInt32(0));
+    check(builder.CreateOr(isFloat, builder.CreateNot(isZero)), "Division by zero");
+    llvm::Value* quotient = byType(isFloat, [&] {
+        return fromFloat(builder.CreateFDiv(asFloat(a.second), asFloat(b.second)));
+    }, [&] {
+        llvm::Value* isMinusOne = builder.CreateICmpEQ(b.second, builder.getInt32(-1));
+        llvm::Value* divisor = builder.CreateSelect(builder.CreateOr(isZero, isMinusOne), builder.getInt32(1), b.second);
+        return builder.CreateSelect(isMinusOne, builder.CreateNeg(a.second), builder.CreateSDiv(a.second, divisor));
+    });
+    storeRegister(operands[2], {a.first, quotient});
 }
 
 void CodeGenerator::visit(AST::OrInstruction& node) {
-    std::cout << "TODO: OrInstruction\n";
+    bitwise(node, llvm::Instruction::Or);
 }
 
 void CodeGenerator::visit(AST::AndInstruction& node) {
-    std::cout << "TODO: AndInstruction\n";
+    bitwise(node, llvm::Instruction::And);
+}
+
+void CodeGenerator::visit(AST::NotInstruction& node) {
+    const AST::ASTNode* operand = node.getChildren()[0];
+    Value value = loadRegister(operand);
+    check(builder.CreateICmpNE(value.first, builder.getInt32(UNDEFINED)), operand->getNodeValue() + " has no value");
+    //Booleans are negated, everything else has its bits flipped
+    llvm::Value* mask = builder.CreateSelect(builder.CreateICmpEQ(value.first, builder.getInt32(BOOLEAN)),
+                                             builder.getInt32(1), builder.getInt32(-1));
+    storeRegister(operand, {value.first, builder.CreateXor(value.second, mask)});
 }
 
 void CodeGenerator::visit(AST::ShiftInstruction& node) {
-    std::cout << "TODO: ShiftInstruction\n";
+    const auto& operands = node.getChildren();
+    Value value = loadRegister(operands[1]);
+    Value amount = loadRegister(operands[2]);
+    check(builder.CreateAnd(isType(value.first, {INTEGER, CHARACTER}), isType(amount.first, {INTEGER})),
+          "shift needs " + operands[1]->getNodeValue() + " to hold an integer or character and " +
+          operands[2]->getNodeValue() + " an integer");
+    //Shift amounts wrap at 32 bits, right shifts keep the sign
+    llvm::Value* bits = builder.CreateAnd(amount.second, builder.getInt32(31));
+    llvm::Value* result = operands[0]->getNodeValue() == "left" ? builder.CreateShl(value.second, bits)
+                                                                : builder.CreateAShr(value.second, bits);
+    storeRegister(operands[1], {value.first, result});
 }
 
 void CodeGenerator::visit(AST::CompareInstruction& node) {
-    std::cout << "TODO: CompareInstruction\n";
+    const auto& operands = node.getChildren();
+    Value a = loadRegister(operands[0]);
+    Value b = loadRegister(operands[1]);
+    checkOperands(node, a, b, {INTEGER, FLOAT, BOOLEAN, CHARACTER, MEMORY, INSTRUCTION}, "values");
+
+    //Floats compare as floats, everything else as signed integers - zero is set when the first operand is zero
+    llvm::Value* isFloat = builder.CreateICmpEQ(a.first, builder.getInt32(FLOAT));
+    const std::pair<llvm::CmpInst::Predicate, llvm::CmpInst::Predicate> predicates[NUM_FLAGS] = {
+        {llvm::CmpInst::FCMP_OGT, llvm::CmpInst::ICMP_SGT}, {llvm::CmpInst::FCMP_OLT, llvm::CmpInst::ICMP_SLT},
+        {llvm::CmpInst::FCMP_OEQ, llvm::CmpInst::ICMP_EQ}, {llvm::CmpInst::FCMP_OEQ, llvm::CmpInst::ICMP_EQ}
+    };
+    for (int i = 0; i < NUM_FLAGS; i++) {
+        llvm::Value* flag = byType(isFloat, [&] {
+            llvm::Value* other = i == ZERO ? llvm::ConstantFP::get(builder.getFloatTy(), 0.0) : asFloat(b.second);
+            return builder.CreateFCmp(predicates[i].first, asFloat(a.second), other);
+        }, [&] {
+            return builder.CreateICmp(predicates[i].second, a.second, i == ZERO ? builder.getInt32(0) : b.second);
+        });
+        builder.CreateStore(flag, m_flags[i]);
+    }
 }
 
 void CodeGenerator::visit(AST::JumpInstruction& node) {
-    std::cout << "TODO: JumpInstruction\n";
+    const auto& operands = node.getChildren();
+    const std::string& condition = operands[0]->getNodeValue();
+    if (condition == "unconditional") {
+        builder.CreateBr(jumpTarget(operands[1]));
+        return;
+    }
+
+    llvm::Value* taken;
+    auto flag = [this](Flag index) {
+        return builder.CreateLoad(builder.getInt1Ty(), m_flags[index]);
+    };
+    if (condition == "greater") taken = flag(GREATER);
+    else if (condition == "less") taken = flag(LESS);
+    else if (condition == "equal") taken = flag(EQUAL);
+    else if (condition == "zero") taken = flag(ZERO);
+    else if (condition == "unequal") taken = builder.CreateNot(flag(EQUAL));
+    else taken = builder.CreateNot(flag(ZERO));
+    builder.CreateCondBr(taken, jumpTarget(operands[1]), lineBlock(m_line + 1));
 }
 
 void CodeGenerator::visit(AST::CallInstruction& node) {
-    std::cout << "TODO: CallInstruction\n";
+    //The return address is the next line
+    push({builder.getInt32(INSTRUCTION), builder.getInt32(m_line + 1)});
+    builder.CreateBr(jumpTarget(node.getChildren()[0]));
 }
 
 void CodeGenerator::visit(AST::PushInstruction& node) {
-    std::cout << "TODO: PushInstruction\n";
+    push(loadRegister(node.getChildren()[0]));
 }
 
 void CodeGenerator::visit(AST::PopInstruction& node) {
-    std::cout << "TODO: PopInstruction\n";
+    storeRegister(node.getChildren()[0], pop());
 }
 
-void CodeGenerator::visit(AST::ReturnInstruction& node) {
-    std::cout << "TODO: ReturnInstruction\n";
+void CodeGenerator::visit(AST::ReturnInstruction&) {
+    Value address = pop();
+    check(isType(address.first, {INSTRUCTION}), "return expects an instruction address on top of the stack");
+    dispatch(address.second);
 }
 
-void CodeGenerator::visit(AST::StopInstruction& node) {
-    std::cout << "TODO: StopInstruction\n";
+void CodeGenerator::visit(AST::StopInstruction&) {
+    builder.CreateBr(lineBlock(static_cast<int>(m_lines.size()) - 1));
 }
 
 void CodeGenerator::visit(AST::InputInstruction& node) {
-    std::cout << "TODO: InputInstruction\n";
+    const auto& operands = node.getChildren();
+    ValueType type = typeOf(operands[0]->getNodeValue());
+    llvm::Value* buffer = builder.CreateConstInBoundsGEP2_32(m_inputBuffer->getAllocatedType(), m_inputBuffer, 0, 0);
+    llvm::Value* word = builder.CreateBitCast(buffer, m_int->getPointerTo());
+    //Integers and address indices are read as integers, booleans as a word (true, false, 1 or 0)
+    const char* format = type == FLOAT ? " %f" : type == CHARACTER ? " %c" : type == BOOLEAN ? " %15s" : " %d";
+    llvm::Value* read = builder.CreateCall(m_scanf, {stringConstant(format), type == CHARACTER || type == BOOLEAN ? buffer : word});
+    check(builder.CreateICmpEQ(read, builder.getInt32(1)), "Invalid " + operands[0]->getNodeValue() + " input");
+
+    llvm::Value* payload;
+    if (type == CHARACTER) {
+        payload = builder.CreateZExt(builder.CreateLoad(builder.getInt8Ty(), buffer), m_int);
+    }
+    else if (type == BOOLEAN) {
+        llvm::Value* first = builder.CreateLoad(builder.getInt8Ty(), buffer);
+        payload = builder.CreateZExt(builder.CreateOr(builder.CreateICmpEQ(first, builder.getInt8('t')),
+                                                      builder.CreateICmpEQ(first, builder.getInt8('1'))), m_int);
+    }
+    else {
+        //Floats are read straight into the payload bits
+        payload = builder.CreateLoad(m_int, word);
+    }
+    storeRegister(operands[1], {builder.getInt32(type), payload});
 }
 
 void CodeGenerator::visit(AST::OutputInstruction& node) {
-    std::cout << "TODO: OutputInstruction\n";
+    const AST::ASTNode* operand = node.getChildren()[0];
+    Value value = loadRegister(operand);
+    check(builder.CreateICmpNE(value.first, builder.getInt32(UNDEFINED)), operand->getNodeValue() + " has no value to output");
+    builder.CreateCall(m_output, {value.first, value.second});
 }
 
 void CodeGenerator::visit(AST::PrintInstruction& node) {
-    std::cout << "TODO: PrintInstruction\n";
+    const AST::ASTNode* operand = node.getChildren()[0];
+    if (operandType(operand) == ASTConstants::NEWLINE) {
+        builder.CreateCall(m_putchar, {builder.getInt32('\n')});
+        return;
+    }
+    //Strip the quotes, the text is printed verbatim
+    const std::string& text = operand->getNodeValue();
+    builder.CreateCall(m_printf, {stringConstant("%s"), stringConstant(text.substr(1, text.size() - 2))});
+}
+
+void CodeGenerator::visit(AST::LabelInstruction&) {
+    //Labels only name their line, which already has a block
+}
+
+void CodeGenerator::visit(AST::CommentInstruction&) {}
+
+//Operands are lowered by the instruction that owns them, which knows how each one is used
+void CodeGenerator::visit(AST::RegisterOperand&) {}
+
+void CodeGenerator::visit(AST::InstructionAddressOperand&) {}
+
+void CodeGenerator::visit(AST::MemoryAddressOperand&) {}
+
+void CodeGenerator::visit(AST::IntegerOperand&) {}
+
+void CodeGenerator::visit(AST::FloatOperand&) {}
+
+void CodeGenerator::visit(AST::BooleanOperand&) {}
+
+void CodeGenerator::visit(AST::CharacterOperand&) {}
+
+void CodeGenerator::visit(AST::StringOperand&) {}
+
+void CodeGenerator::visit(AST::NewlineOperand&) {}
+
+void CodeGenerator::visit(AST::TypeConditionOperand&) {}
+
+void CodeGenerator::visit(AST::ShiftConditionOperand&) {}
+
+void CodeGenerator::visit(AST::JumpConditionOperand&) {}
+
+void CodeGenerator::createModule(const std::string& name) {
+    module = std::make_unique<llvm::Module>(name, context);
+    if (m_targetMachine != nullptr) {
+        module->setTargetTriple(m_targetMachine->getTargetTriple().str());
+        module->setDataLayout(m_targetMachine->createDataLayout());
+    }
+    //Constants belong to the module they are emitted in
+    m_strings.clear();
+}
+
+void CodeGenerator::declareRuntime() {
+    llvm::Type* bytePointer = builder.getInt8PtrTy();
+    m_printf = module->getOrInsertFunction("printf", llvm::FunctionType::get(m_int, {bytePointer}, true));
+    m_scanf = module->getOrInsertFunction("scanf", llvm::FunctionType::get(m_int, {bytePointer}, true));
+    m_putchar = module->getOrInsertFunction("putchar", llvm::FunctionType::get(m_int, {m_int}, false));
+}
+
+void CodeGenerator::defineState(bool define) {
+    //Split programs share the state between modules - defined by the one holding main, declared by the others
+    auto linkage = m_split ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::InternalLinkage;
+    auto global = [&](llvm::Type* type, const char* name) {
+        return new llvm::GlobalVariable(*module, type, false, linkage, define ? llvm::Constant::getNullValue(type) : nullptr, name);
+    };
+    //Memory starts out without values
+    m_stack = global(llvm::ArrayType::get(m_valueType, STACK_SIZE), "stack");
+    m_stackPointer = global(m_int, "stack.pointer");
+    m_pages = global(llvm::ArrayType::get(m_valueType->getPointerTo(), NUM_PAGES), "memory");
+    if (m_split) {
+        //Registers are saved between regions, starting out without a value like the flags are cleared
+        m_savedRegisters = global(llvm::ArrayType::get(m_valueType, NUM_REGISTERS), "registers");
+        m_savedFlags = global(llvm::ArrayType::get(builder.getInt1Ty(), NUM_FLAGS), "flags");
+    }
+}
+
+void CodeGenerator::defineRuntime() {
+    //Declared with the generated types first, so the runtime's own types are mapped onto them when it is linked in
+    llvm::Type* cellPointer = m_valueType->getPointerTo();
+    auto declare = [&](llvm::Type* result, llvm::ArrayRef<llvm::Type*> parameters, const char* name) {
+        return llvm::Function::Create(llvm::FunctionType::get(result, parameters, false), llvm::GlobalValue::ExternalLinkage,
+                                      name, *module);
+    };
+    m_fail = declare(builder.getVoidTy(), {m_int, builder.getInt8PtrTy()}, "startasm.fail");
+    m_cell = declare(cellPointer, {cellPointer->getPointerTo(), m_int, m_int}, "startasm.cell");
+    m_output = declare(builder.getVoidTy(), {m_int, m_int}, "startasm.output");
+    //Without the bitcode the functions stay declared, to be linked from the native runtime object
+    if (linkRuntime()) {
+        //Every module has its own copy, free to be inlined and dropped
+        for (llvm::Function* function : {m_fail, m_cell, m_output}) {
+            function->setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+    m_fail->setDoesNotReturn();
+    m_fail->addFnAttr(llvm::Attribute::Cold);
+}
+
+bool CodeGenerator::linkRuntime() {
+    const llvm::MemoryBuffer* bitcode = runtimeBitcode();
+    if (bitcode == nullptr) {
+        return false;
+    }
+    llvm::Expected<std::unique_ptr<llvm::Module>> runtime = llvm::parseBitcodeFile(bitcode->getMemBufferRef(), context);
+    if (!runtime) {
+        llvm::report_fatal_error(llvm::Twine("Code generation failed. The runtime library could not be read: ") +
+                                 llvm::toString(runtime.takeError()));
+    }
+    (*runtime)->setTargetTriple(module->getTargetTriple());
+    (*runtime)->setDataLayout(module->getDataLayout());
+    for (llvm::Function& function : **runtime) {
+        //Compiled for a generic CPU, which would keep the inliner from putting it into code tuned for the host
+        function.removeFnAttr("target-cpu");
+        function.removeFnAttr("target-features");
+        function.removeFnAttr("tune-cpu");
+    }
+    if (llvm::Linker::linkModules(*module, std::move(*runtime))) {
+        llvm::report_fatal_error("Code generation failed. The runtime library could not be linked.");
+    }
+    m_fail = module->getFunction("startasm.fail");
+    m_cell = module->getFunction("startasm.cell");
+    m_output = module->getFunction("startasm.output");
+    for (llvm::Function* function : {m_fail, m_cell, m_output}) {
+        if (function == nullptr || function->isDeclaration()) {
+            llvm::report_fatal_error("Code generation failed. The runtime library is missing functions.");
+        }
+    }
+    return true;
+}
+
+void CodeGenerator::createLocals() {
+    //Registers and flags are locals, so they are promoted to SSA values
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        std::string name = "r" + std::to_string(i);
+        m_registers[i] = {builder.CreateAlloca(m_int, nullptr, name + ".type"), builder.CreateAlloca(m_int, nullptr, name + ".value")};
+    }
+    const char* flagNames[NUM_FLAGS] = {"greater", "less", "equal", "zero"};
+    for (int i = 0; i < NUM_FLAGS; i++) {
+        m_flags[i] = builder.CreateAlloca(builder.getInt1Ty(), nullptr, flagNames[i]);
+    }
+    m_inputBuffer = builder.CreateAlloca(llvm::ArrayType::get(builder.getInt8Ty(), 16), nullptr, "input");
+    if (m_split) {
+        //A function picks up the state left by the previous one
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            Value saved = loadValue(builder.CreateConstInBoundsGEP2_32(m_savedRegisters->getValueType(), m_savedRegisters, 0, i));
+            builder.CreateStore(saved.first, m_registers[i].first);
+            builder.CreateStore(saved.second, m_registers[i].second);
+        }
+        for (int i = 0; i < NUM_FLAGS; i++) {
+            llvm::Value* saved = builder.CreateConstInBoundsGEP2_32(m_savedFlags->getValueType(), m_savedFlags, 0, i);
+            builder.CreateStore(builder.CreateLoad(builder.getInt1Ty(), saved), m_flags[i]);
+        }
+        return;
+    }
+    //Registers start out without a value
+    for (const auto& reg : m_registers) {
+        builder.CreateStore(builder.getInt32(UNDEFINED), reg.first);
+        builder.CreateStore(builder.getInt32(0), reg.second);
+    }
+    for (auto* flag : m_flags) {
+        builder.CreateStore(builder.getFalse(), flag);
+    }
+}
+
+void CodeGenerator::saveLocals() {
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        const auto& reg = m_registers[i];
+        storeValue(builder.CreateConstInBoundsGEP2_32(m_savedRegisters->getValueType(), m_savedRegisters, 0, i),
+                   {builder.CreateLoad(m_int, reg.first), builder.CreateLoad(m_int, reg.second)});
+    }
+    for (int i = 0; i < NUM_FLAGS; i++) {
+        builder.CreateStore(builder.CreateLoad(builder.getInt1Ty(), m_flags[i]),
+                            builder.CreateConstInBoundsGEP2_32(m_savedFlags->getValueType(), m_savedFlags, 0, i));
+    }
+}
+
+CodeGenerator::Value CodeGenerator::loadRegister(const AST::ASTNode* node) {
+    int index = registerIndex(node);
+    const auto& reg = m_registers[index];
+    //The type of a register inferred to hold a single one is a constant, so the checks on it fold
+    bool known;
+    ValueType type = m_types->knownType(m_line, index, known);
+    llvm::Value* tag = known ? static_cast<llvm::Value*>(builder.getInt32(type)) : builder.CreateLoad(m_int, reg.first);
+    return {tag, builder.CreateLoad(m_int, reg.second)};
+}
+
+void CodeGenerator::storeRegister(const AST::ASTNode* node, Value value) {
+    const auto& reg = m_registers[registerIndex(node)];
+    builder.CreateStore(value.first, reg.first);
+    builder.CreateStore(value.second, reg.second);
+}
+
+CodeGenerator::Value CodeGenerator::loadValue(llvm::Value* pointer) {
+    return {builder.CreateLoad(m_int, builder.CreateStructGEP(m_valueType, pointer, 0)),
+            builder.CreateLoad(m_int, builder.CreateStructGEP(m_valueType, pointer, 1))};
+}
+
+void CodeGenerator::storeValue(llvm::Value* pointer, Value value) {
+    builder.CreateStore(value.first, builder.CreateStructGEP(m_valueType, pointer, 0));
+    builder.CreateStore(value.second, builder.CreateStructGEP(m_valueType, pointer, 1));
+}
+
+void CodeGenerator::push(Value value) {
+    llvm::Value* pointer = builder.CreateLoad(m_int, m_stackPointer);
+    check(builder.CreateICmpULT(pointer, builder.getInt32(STACK_SIZE)), "Stack overflow");
+    storeValue(builder.CreateInBoundsGEP(m_stack->getValueType(), m_stack, {builder.getInt32(0), pointer}), value);
+    builder.CreateStore(builder.CreateAdd(pointer, builder.getInt32(1)), m_stackPointer);
 }
 
-void CodeGenerator::visit(AST::LabelInstruction& node) {
-    std::cout << "TODO: LabelInstruction\n";
+CodeGenerator::Value CodeGenerator::pop() {
+    llvm::Value* pointer = builder.CreateLoad(m_int, m_stackPointer);
+    check(builder.CreateICmpNE(pointer, builder.getInt32(0)), "Stack is empty");
+    pointer = builder.CreateSub(pointer, builder.getInt32(1));
+    builder.CreateStore(pointer, m_stackPointer);
+    return loadValue(builder.CreateInBoundsGEP(m_stack->getValueType(), m_stack, {builder.getInt32(0), pointer}));
 }
 
-void CodeGenerator::visit(AST::CommentInstruction& node) {
-    std::cout << "TODO: CommentInstruction\n";
+llvm::Value* CodeGenerator::memoryCell(const AST::ASTNode* node) {
+    llvm::Value* address;
+    if (operandType(node) == ASTConstants::MEMORYADDRESS) {
+        address = builder.getInt32(addressIndex(node));
+    }
+    else {
+        Value value = loadRegister(node);
+        check(builder.CreateAnd(isType(value.first, {MEMORY}), builder.CreateICmpULT(value.second, builder.getInt32(MEMORY_SIZE))),
+              node->getNodeValue() + " does not hold a memory address from m<0> to m<999999999>");
+        address = value.second;
+    }
+    return builder.CreateCall(m_cell, {builder.CreateConstInBoundsGEP2_32(m_pages->getValueType(), m_pages, 0, 0),
+                                       builder.getInt32(m_line), address});
 }
 
-void CodeGenerator::visit(AST::RegisterOperand& node) {
-    std::cout << "TODO: RegisterOperand\n";
+llvm::BasicBlock* CodeGenerator::lineBlock(int line) {
+    //In a split program, lines outside the function are reached by saving the state and returning the line to continue at
+    if (m_split && m_lines[line] == nullptr) {
+        llvm::IRBuilderBase::InsertPointGuard guard(builder);
+        m_lines[line] = llvm::BasicBlock::Create(context, "to.i" + std::to_string(line), m_function);
+        builder.SetInsertPoint(m_lines[line]);
+        saveLocals();
+        builder.CreateRet(builder.getInt32(std::max(line, 1)));
+        m_regionExits.push_back(line);
+    }
+    return m_lines[line];
 }
 
-void CodeGenerator::visit(AST::InstructionAddressOperand& node) {
-    std::cout << "TODO: InstructionAddressOperand\n";
+llvm::BasicBlock* CodeGenerator::jumpTarget(const AST::ASTNode* node) {
+    if (operandType(node) == ASTConstants::INSTRUCTIONADDRESS) {
+        return lineBlock(addressIndex(node));
+    }
+    //Jumps through a register check the address in a block of their own, then dispatch on it
+    llvm::IRBuilderBase::InsertPointGuard guard(builder);
+    auto* block = llvm::BasicBlock::Create(context, "", m_function, m_regionEnd);
+    builder.SetInsertPoint(block);
+    Value value = loadRegister(node);
+    check(isType(value.first, {INSTRUCTION}), node->getNodeValue() + " does not hold an instruction address");
+    dispatch(value.second);
+    return block;
 }
 
-void CodeGenerator::visit(AST::MemoryAddressOperand& node) {
-    std::cout << "TODO: MemoryAddressOperand\n";
+void CodeGenerator::dispatch(llvm::Value* address) {
+    if (m_split) {
+        //Main continues at the address, which only has to be in the program
+        int exit = static_cast<int>(m_lines.size()) - 1;
+        check(builder.CreateICmpULE(address, builder.getInt32(exit)), "Jump to an instruction address outside the program");
+        saveLocals();
+        builder.CreateRet(builder.CreateSelect(builder.CreateICmpEQ(address, builder.getInt32(0)), builder.getInt32(1), address));
+        return;
+    }
+    if (m_dispatch == nullptr) {
+        m_dispatch = llvm::BasicBlock::Create(context, "dispatch", m_function);
+        llvm::IRBuilder<> dispatchBuilder(m_dispatch);
+        m_dispatchAddress = dispatchBuilder.CreatePHI(m_int, 0, "address");
+        m_dispatchLine = dispatchBuilder.CreatePHI(m_int, 0, "line");
+    }
+    m_dispatchAddress->addIncoming(address, builder.GetInsertBlock());
+    m_dispatchLine->addIncoming(builder.getInt32(m_line), builder.GetInsertBlock());
+    builder.CreateBr(m_dispatch);
 }
 
-void CodeGenerator::visit(AST::IntegerOperand& node) {
-    std::cout << "TODO: IntegerOperand\n";
+void CodeGenerator::check(llvm::Value* condition, const std::string& message) {
+    //Programs built without checks are trusted to never fail one
+    if (m_checks == BackendConstants::NO_CHECKS) {
+        return;
+    }
+    //Checks on inferred types fold to true, and are left out
+    auto* constant = llvm::dyn_cast<llvm::ConstantInt>(condition);
+    if (constant != nullptr && constant->isOne()) {
+        return;
+    }
+    //Every check shares one failure block, passing it the line and message, so a check only costs a branch
+    //Fast checks trap there instead, keeping neither the lines nor the messages
+    if (m_failure == nullptr) {
+        m_failure = llvm::BasicBlock::Create(context, "fail", m_function);
+        llvm::IRBuilder<> failureBuilder(m_failure);
+        if (m_checks == BackendConstants::FAST_CHECKS) {
+            failureBuilder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+        }
+        else {
+            m_failureLine = failureBuilder.CreatePHI(m_int, 0, "line");
+            m_failureMessage = failureBuilder.CreatePHI(builder.getInt8PtrTy(), 0, "message");
+            failureBuilder.CreateCall(m_fail, {m_failureLine, m_failureMessage});
+        }
+        failureBuilder.CreateUnreachable();
+    }
+    auto* next = llvm::BasicBlock::Create(context, "", m_function, m_regionEnd);
+    builder.CreateCondBr(condition, next, m_failure);
+    if (m_checks == BackendConstants::FULL_CHECKS) {
+        m_failureLine->addIncoming(builder.getInt32(m_line), builder.GetInsertBlock());
+        m_failureMessage->addIncoming(stringConstant(message), builder.GetInsertBlock());
+    }
+    builder.SetInsertPoint(next);
 }
 
-void CodeGenerator::visit(AST::FloatOperand& node) {
-    std::cout << "TODO: FloatOperand\n";
+llvm::Value* CodeGenerator::isType(llvm::Value* type, std::initializer_list<ValueType> types) {
+    //Tested as a bit set, types being small
+    std::uint32_t mask = 0;
+    for (ValueType candidate : types) {
+        mask |= 1u << candidate;
+    }
+    llvm::Value* bit = builder.CreateShl(builder.getInt32(1), type);
+    return builder.CreateICmpNE(builder.CreateAnd(bit, builder.getInt32(mask)), builder.getInt32(0));
 }
 
-void CodeGenerator::visit(AST::BooleanOperand& node) {
-    std::cout << "TODO: BooleanOperand\n";
+void CodeGenerator::checkOperands(const AST::InstructionNode& node, Value a, Value b,
+                                  std::initializer_list<ValueType> types, const std::string& description) {
+    const auto& operands = node.getChildren();
+    check(builder.CreateAnd(builder.CreateICmpEQ(a.first, b.first), isType(a.first, types)),
+          node.getNodeValue() + " needs " + operands[0]->getNodeValue() + " and " + operands[1]->getNodeValue() +
+          " to hold " + description + " of the same type");
 }
 
-void CodeGenerator::visit(AST::CharacterOperand& node) {
-    std::cout << "TODO: CharacterOperand\n";
+llvm::Value* CodeGenerator::byType(llvm::Value* isFloat, llvm::function_ref<llvm::Value*()> floatResult,
+                                   llvm::function_ref<llvm::Value*()> integerResult) {
+    if (auto* known = llvm::dyn_cast<llvm::ConstantInt>(isFloat)) {
+        return known->isOne() ? floatResult() : integerResult();
+    }
+    //Otherwise both are computed and the float one picked for floats
+    llvm::Value* result = floatResult();
+    return builder.CreateSelect(isFloat, result, integerResult());
+}
+
+llvm::Value* CodeGenerator::asFloat(llvm::Value* payload) {
+    return builder.CreateBitCast(payload, builder.getFloatTy());
+}
+
+llvm::Value* CodeGenerator::fromFloat(llvm::Value* value) {
+    return builder.CreateBitCast(value, m_int);
+}
+
+llvm::Constant* CodeGenerator::stringConstant(const std::string& text) {
+    //Each distinct string is emitted once
+    auto found = m_strings.find(text);
+    if (found != m_strings.end()) {
+        return found->second;
+    }
+    llvm::Constant* constant = builder.CreateGlobalStringPtr(text, ".str", 0, module.get());
+    m_strings.emplace(text, constant);
+    return constant;
+}
+
+void CodeGenerator::arithmetic(AST::InstructionNode& node, llvm::Instruction::BinaryOps integerOp,
+                               llvm::Instruction::BinaryOps floatOp, std::initializer_list<ValueType> types,
+                               const std::string& description) {
+    const auto& operands = node.getChildren();
+    Value a = loadRegister(operands[0]);
+    Value b = loadRegister(operands[1]);
+    checkOperands(node, a, b, types, description);
+    //Integer arithmetic wraps
+    llvm::Value* isFloat = builder.CreateICmpEQ(a.first, builder.getInt32(FLOAT));
+    llvm::Value* result = byType(isFloat, [&] {
+        return fromFloat(builder.CreateBinOp(floatOp, asFloat(a.second), asFloat(b.second)));
+    }, [&] {
+        return builder.CreateBinOp(integerOp, a.second, b.second);
+    });
+    storeRegister(operands[2], {a.first, result});
+}
+
+void CodeGenerator::bitwise(AST::InstructionNode& node, llvm::Instruction::BinaryOps op) {
+    //The result replaces the first operand
+    const auto& operands = node.getChildren();
+    Value a = loadRegister(operands[0]);
+    Value b = loadRegister(operands[1]);
+    checkOperands(node, a, b, {INTEGER, FLOAT, BOOLEAN, CHARACTER, MEMORY, INSTRUCTION}, "values");
+    storeRegister(operands[0], {a.first, builder.CreateBinOp(op, a.second, b.second)});
+}
+
+bool CodeGenerator::generateIR(AST::AbstractSyntaxTree* AST, const TypeInference& types, BackendConstants::Checks checks) {
+    m_checks = checks;
+    m_types = &types;
+    auto& root = static_cast<AST::RootNode&>(*AST->getRoot());
+    const auto& instructions = root.getChildren();
+    //Large programs are split into partitions generated in parallel. The layout only depends on the program, so the
+    //IR is the same whatever the number of threads - with one, the partitions are simply generated in turn
+    int numLines = static_cast<int>(instructions.size());
+    int count = std::min(static_cast<int>(MAX_PARTITIONS), numLines / PARTITION_LINES);
+    if (count > 1) {
+        std::vector<char> leaders = findLeaders(instructions, types.computesAddresses());
+        std::vector<int> starts = partitionStarts(leaders, count);
+        if (starts.size() > 2) {
+            return generatePartitions(instructions, leaders, starts);
+        }
+    }
+    //The root is visited directly - its accept visits the instructions in parallel, and IR is built in order
+    visit(root);
+    return !llvm::verifyModule(*module);
+}
+
+std::string CodeGenerator::optimize(int level, bool timePasses) {
+    //Per pass timings are collected through the pass instrumentation when requested
+    llvm::PassInstrumentationCallbacks instrumentation;
+    llvm::TimePassesHandler timings(timePasses);
+    timings.registerCallbacks(instrumentation);
+    runPipeline(*module, m_targetMachine.get(), level, &instrumentation);
+    if (!m_partitions.empty()) {
+        //Partitions are optimized in parallel, unless they are timed together
+        TaskScheduler::TaskGroup partitions;
+        for (auto& partition : m_partitions) {
+            CodeGenerator* generator = partition.get();
+            if (timePasses) {
+                runPipeline(*generator->module, generator->m_targetMachine.get(), level, &instrumentation);
+            }
+            else {
+                partitions.run([generator, level] {
+                    runPipeline(*generator->module, generator->m_targetMachine.get(), level, nullptr);
+                });
+            }
+        }
+        partitions.wait();
+        linkPartitions();
+    }
+
+    std::string report;
+    if (timePasses) {
+        llvm::raw_string_ostream stream(report);
+        timings.setOutStream(stream);
+        timings.print();
+        stream.flush();
+    }
+    return report;
+}
+
+bool CodeGenerator::execute(AST::AbstractSyntaxTree* AST, const TypeInference& types, int level,
+                            BackendConstants::Checks checks, int& exitCode, std::string& error) {
+    if (m_targetMachine == nullptr) {
+        error = "no LLVM target for " + llvm::sys::getDefaultTargetTriple();
+        return false;
+    }
+    auto jit = llvm::orc::LLJITBuilder().create();
+    if (!jit) {
+        error = llvm::toString(jit.takeError());
+        return false;
+    }
+    m_jit = std::move(*jit);
+    //Calls into the C library resolve to the functions already loaded in this process, region lookups to resolveRegion
+    auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(m_jit->getDataLayout().getGlobalPrefix());
+    if (!process) {
+        error = llvm::toString(process.takeError());
+        return false;
+    }
+    llvm::orc::JITDylib& library = m_jit->getMainJITDylib();
+    library.addGenerator(std::move(*process));
+    llvm::orc::SymbolMap resolver;
+    resolver[m_jit->mangleAndIntern("startasm.resolve")] =
+        llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(&CodeGenerator::resolveRegion), llvm::JITSymbolFlags::Exported);
+    if (llvm::Error defined = library.define(llvm::orc::absoluteSymbols(std::move(resolver)))) {
+        error = llvm::toString(std::move(defined));
+        return false;
+    }
+    //Without the bitcode, regions call the runtime functions in the native runtime object
+    if (runtimeBitcode() == nullptr) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> object = llvm::MemoryBuffer::getFile(Backend::runtimeObjectPath());
+        if (!object) {
+            error = "runtime library not found: " + Backend::runtimeObjectPath();
+            return false;
+        }
+        if (llvm::Error added = m_jit->addObjectFile(std::move(*object))) {
+            error = llvm::toString(std::move(added));
+            return false;
+        }
+    }
+
+    m_split = true;
+    m_optimizationLevel = level;
+    m_checks = checks;
+    m_types = &types;
+    m_instructions = &AST->getRoot()->getChildren();
+    int numLines = static_cast<int>(m_instructions->size());
+    m_leaders = findLeaders(*m_instructions, false);
+    m_lines.assign(numLines + 2, nullptr);
+
+    //The runtime module holds the state and main, which runs one region after the other until the program exits
+    //Regions are cached by the line they start at, and compiled by resolveRegion the first time that line is reached
+    defineState(true);
+    auto* regionType = llvm::FunctionType::get(m_int, false)->getPointerTo();
+    auto* tableType = llvm::ArrayType::get(regionType, numLines + 2);
+    auto* table = new llvm::GlobalVariable(*module, tableType, false, llvm::GlobalValue::InternalLinkage,
+                                           llvm::ConstantAggregateZero::get(tableType), "regions");
+    llvm::FunctionCallee resolve = module->getOrInsertFunction("startasm.resolve", llvm::FunctionType::get(regionType, {m_int}, false));
+    m_function = llvm::Function::Create(llvm::FunctionType::get(m_int, false), llvm::GlobalValue::ExternalLinkage,
+                                        "main", *module);
+    auto* entry = llvm::BasicBlock::Create(context, "entry", m_function);
+    auto* loop = llvm::BasicBlock::Create(context, "loop", m_function);
+    auto* lookup = llvm::BasicBlock::Create(context, "lookup", m_function);
+    auto* compile = llvm::BasicBlock::Create(context, "compile", m_function);
+    auto* run = llvm::BasicBlock::Create(context, "run", m_function);
+    auto* exit = llvm::BasicBlock::Create(context, "exit", m_function);
+
+    builder.SetInsertPoint(entry);
+    builder.CreateBr(loop);
+    builder.SetInsertPoint(loop);
+    llvm::PHINode* line = builder.CreatePHI(m_int, 2, "line");
+    line->addIncoming(builder.getInt32(1), entry);
+    builder.CreateCondBr(builder.CreateICmpEQ(line, builder.getInt32(numLines + 1)), exit, lookup);
+    builder.SetInsertPoint(lookup);
+    llvm::Value* slot = builder.CreateInBoundsGEP(tableType, table, {builder.getInt32(0), line});
+    llvm::Value* cached = builder.CreateLoad(regionType, slot);
+    builder.CreateCondBr(builder.CreateIsNull(cached), compile, run);
+    builder.SetInsertPoint(compile);
+    llvm::Value* compiled = builder.CreateCall(resolve, {line});
+    builder.CreateStore(compiled, slot);
+    builder.CreateBr(run);
+    builder.SetInsertPoint(run);
+    llvm::PHINode* region = builder.CreatePHI(regionType, 2, "region");
+    region->addIncoming(cached, lookup);
+    region->addIncoming(compiled, compile);
+    line->addIncoming(builder.CreateCall(llvm::FunctionType::get(m_int, false), region), run);
+    builder.CreateBr(loop);
+    builder.SetInsertPoint(exit);
+    builder.CreateRet(builder.getInt32(0));
+
+    if (llvm::verifyModule(*module)) {
+        error = "the generated runtime is invalid";
+        return false;
+    }
+    optimize(level, false);
+    if (llvm::Error added = m_jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), m_context))) {
+        error = llvm::toString(std::move(added));
+        return false;
+    }
+    auto main = m_jit->lookup("main");
+    if (!main) {
+        error = llvm::toString(main.takeError());
+        return false;
+    }
+    //Runtime errors exit the process from inside the program, after flushing its output
+    running = this;
+    exitCode = llvm::jitTargetAddressToFunction<int (*)()>(main->getAddress())();
+    running = nullptr;
+    return true;
+}
+
+void CodeGenerator::lowerRegion(int start) {
+    const auto& instructions = *m_instructions;
+    int numLines = static_cast<int>(instructions.size());
+    std::string name = "i" + std::to_string(start);
+    m_function = llvm::Function::Create(llvm::FunctionType::get(m_int, false), llvm::GlobalValue::ExternalLinkage,
+                                        name, *module);
+    auto* entry = llvm::BasicBlock::Create(context, "entry", m_function);
+    m_lines[start] = llvm::BasicBlock::Create(context, name, m_function);
+    if (start == 1) {
+        m_lines[0] = m_lines[1];
+    }
+    m_regionEnd = nullptr;
+    m_dispatch = nullptr;
+    m_failure = nullptr;
+    builder.SetInsertPoint(entry);
+    createLocals();
+    builder.CreateBr(m_lines[start]);
+
+    //The region runs up to the next leader - jumps back to its start loop within the function, others leave it
+    builder.SetInsertPoint(m_lines[start]);
+    int line = start;
+    for (; line <= numLines && (line == start || !m_leaders[line]); line++) {
+        m_line = line;
+        instructions[line - 1]->accept(*this);
+    }
+    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+        builder.CreateBr(lineBlock(line));
+    }
+
+    //Blocks only belong to this region's function
+    for (int exit : m_regionExits) {
+        m_lines[exit] = nullptr;
+    }
+    m_regionExits.clear();
+    m_lines[start] = nullptr;
+    m_lines[0] = nullptr;
 }
 
-void CodeGenerator::visit(AST::StringOperand& node) {
-    std::cout << "TODO: StringOperand\n";
+void* CodeGenerator::compileRegion(int start) {
+    //Every region is a module of its own, with its own copy of the helpers so they can be inlined
+    createModule("i" + std::to_string(start));
+    declareRuntime();
+    defineState(false);
+    defineRuntime();
+    lowerRegion(start);
+    if (llvm::verifyModule(*module, &llvm::errs())) {
+        llvm::report_fatal_error(llvm::Twine("Code generation failed. The IR generated for line ") + std::to_string(start) + " is invalid.");
+    }
+    optimize(m_optimizationLevel, false);
+    llvm::cantFail(m_jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), m_context)));
+    llvm::JITEvaluatedSymbol region = llvm::cantFail(m_jit->lookup("i" + std::to_string(start)));
+    return llvm::jitTargetAddressToPointer<void*>(region.getAddress());
 }
 
-void CodeGenerator::visit(AST::NewlineOperand& node) {
-    std::cout << "TODO: NewlineOperand\n";
+void* CodeGenerator::resolveRegion(int line) {
+    return running->compileRegion(line);
 }
 
-void CodeGenerator::visit(AST::TypeConditionOperand& node) {
-    std::cout << "TODO: TypeConditionOperand\n";
+std::string CodeGenerator::getIR() {
+    if (!m_partitions.empty()) {
+        linkPartitions();
+    }
+    std::string IR;
+    llvm::raw_string_ostream stream(IR);
+    module->print(stream, nullptr);
+    return stream.str();
 }
 
-void CodeGenerator::visit(AST::ShiftConditionOperand& node) {
-    std::cout << "TODO: ShiftConditionOperand\n";
+bool CodeGenerator::emit(BackendConstants::EmitFormat format, const std::string& path, std::string& error) {
+    if (!m_partitions.empty()) {
+        linkPartitions();
+    }
+    if (format != BackendConstants::EXE) {
+        return writeFile(format, path, error);
+    }
+    //Executables are linked from a temporary object, and the native runtime object if the module only declares the runtime
+    std::string runtime;
+    if (needsRuntimeObject(*module)) {
+        runtime = Backend::runtimeObjectPath();
+        if (!llvm::sys::fs::exists(runtime)) {
+            error = "runtime library not found: " + runtime;
+            return false;
+        }
+    }
+    llvm::SmallString<128> object;
+    if (std::error_code code = llvm::sys::fs::createTemporaryFile("startasm", "o", object)) {
+        error = "temporary object: " + code.message();
+        return false;
+    }
+    bool linked = writeFile(BackendConstants::OBJ, object.str().str(), error) &&
+                  linkExecutable(object.str().str(), runtime, path, error);
+    llvm::sys::fs::remove(object);
+    return linked;
 }
 
-void CodeGenerator::visit(AST::JumpConditionOperand& node) {
-    std::cout << "TODO: JumpConditionOperand\n";
+bool CodeGenerator::writeFile(BackendConstants::EmitFormat format, const std::string& path, std::string& error) {
+    bool text = format == BackendConstants::LL || format == BackendConstants::ASM;
+    if ((format == BackendConstants::ASM || format == BackendConstants::OBJ) && m_targetMachine == nullptr) {
+        error = "LLVM has no code generator for " + llvm::sys::getDefaultTargetTriple();
+        return false;
+    }
+    std::error_code code;
+    llvm::raw_fd_ostream stream(path, code, text ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+    if (code) {
+        error = path + ": " + code.message();
+        return false;
+    }
+    switch (format) {
+        case BackendConstants::LL:
+            module->print(stream, nullptr);
+            break;
+        case BackendConstants::BC:
+            llvm::WriteBitcodeToFile(*module, stream);
+            break;
+        default: {
+            //Machine code is generated through the legacy pass manager, which the code generator still runs on
+            llvm::legacy::PassManager passes;
+            auto type = format == BackendConstants::ASM ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+            if (m_targetMachine->addPassesToEmitFile(passes, stream, nullptr, type)) {
+                error = "the target can't emit this file type";
+                return false;
+            }
+            passes.run(*module);
+            break;
+        }
+    }
+    stream.close();
+    if (stream.has_error()) {
+        error = path + ": " + stream.error().message();
+        stream.clear_error();
+        return false;
+    }
+    return true;
 }
 
-void CodeGenerator::printIR() {
-    module->print(llvm::outs(), nullptr);
+//Backend module entry point, looked up by Backend::load
+extern "C" Backend* startasmCreateBackend() {
+    return new CodeGenerator();
 }
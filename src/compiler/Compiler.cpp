@@ -4,180 +4,431 @@
 #include "symbolres/SymbolResolver.h"
 #include "ast/AbstractSyntaxTree.h"
 #include "ast/ASTBuilder.h"
+#include "ast/JsonWriter.h"
+#include "ast/BinaryAST.h"
 #include "semantics/SemanticAnalyzer.h"
 #include "scopecheck/ScopeChecker.h"
-#include "codegen/CodeGenerator.h"
+#include "codegen/Backend.h"
+#include "pipeline/FrontendPipeline.h"
+#include "memory/MemoryTracker.h"
+#include "cache/CompileCache.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <iostream>
 #include <string>
-#include <omp.h>
-#include <future>
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace std;
+using namespace PassConstants;
 
-Compiler::Compiler(std::string& pathname, bool cmdSilent, bool cmdTimings, bool cmdIr) :
-    cmd_silent(cmdSilent),
-    cmd_timings(cmdTimings),
-    cmd_ir(cmdIr),
-    m_lexer(new Lexer()),
-    m_parser(new Parser()),
-    m_parseTree(new PT::ParseTree()),
-    m_symbolResolver(new SymbolResolver()),
-    m_AST(new AST::AbstractSyntaxTree()),
-    m_ASTBuilder(new ASTBuilder()),
-    m_semanticAnalyzer(new SemanticAnalyzer(m_codeLines)),
-    m_scopeChecker(new ScopeChecker(m_codeLines)),
-    //m_codeGenerator(new CodeGenerator()),
-    m_pathname(pathname) {}
-
-Compiler::~Compiler() {
-    delete m_lexer;
-    delete m_parser;
-    delete m_symbolResolver;
-    delete m_AST;
-    delete m_ASTBuilder;
-    delete m_semanticAnalyzer;
-    delete m_scopeChecker;
-    //delete m_codeGenerator;
+namespace {
+    //Write buffers to standard output in order, a single writev per IOV_MAX buffers
+    void writeAll(const std::string_view* buffers, std::size_t count) {
+        std::vector<iovec> vectors;
+        vectors.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            if (!buffers[i].empty()) {
+                vectors.push_back({const_cast<char*>(buffers[i].data()), buffers[i].size()});
+            }
+        }
+        std::size_t index = 0;
+        while (index < vectors.size()) {
+            int batch = static_cast<int>(std::min<std::size_t>(vectors.size() - index, IOV_MAX));
+            ssize_t written = writev(STDOUT_FILENO, vectors.data() + index, batch);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                //Nothing sensible can be done once the reader has gone (closed pipe)
+                return;
+            }
+            //Skip past what was written, resuming partial writes mid-buffer
+            while (written > 0) {
+                std::size_t length = vectors[index].iov_len;
+                if (static_cast<std::size_t>(written) >= length) {
+                    written -= static_cast<ssize_t>(length);
+                    index++;
+                }
+                else {
+                    vectors[index].iov_base = static_cast<char*>(vectors[index].iov_base) + written;
+                    vectors[index].iov_len -= static_cast<std::size_t>(written);
+                    written = 0;
+                }
+            }
+        }
+    }
 }
 
+Compiler::Compiler(std::string& pathname, const CompilerOptions& options) :
+    m_pathname(pathname),
+    m_options(options),
+    m_diagnostics(options.maxErrors) {}
+
+Compiler::~Compiler() = default;
+
 void Compiler::cmdPrint(const std::string& message) const {
-    if (!cmd_silent) {
+    if (!m_options.silent) {
         cout << message;
     }
 }
 
 void Compiler::cmdTimingPrint(const std::string& message) const {
-    if (!cmd_silent && cmd_timings) {
+    if (!m_options.silent && m_options.timings) {
+        cout << message;
+    }
+}
+
+void Compiler::cmdMemoryPrint(const std::string& message) const {
+    if (!m_options.silent && m_options.memstats) {
         cout << message;
     }
 }
 
 bool Compiler::compileCode() {
-    double start = omp_get_wtime();
-    //Lex code//
-    cmdTimingPrint("Compiler: Lexing code\n");
-    if (!m_lexer->lexFile(m_pathname, m_codeLines, m_codeTokens)) {
-        m_statusMessage = "Lexing failed. Either the path was invalid or the file could not be found.";
-        return false;
+    //Emitted files are written on every compile - the cache only holds results that are printed
+    if (m_options.emit != BackendConstants::NO_EMIT) {
+        m_source.reset();
+        return runPasses({EMITTED});
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    return run(IR);
+}
 
-    //Parse code//
-    cmdTimingPrint("Compiler: Parsing code\n");
-    start = omp_get_wtime();
-    if(!m_parser->parseCode(m_parseTree, m_codeLines, m_codeTokens, m_statusMessage)) {
+bool Compiler::outputAST() {
+    return run(m_options.binaryAST ? AST_BINARY : AST_JSON);
+}
+
+bool Compiler::loadBackend() {
+    std::string error;
+    m_backend = Backend::load(error);
+    if (m_backend == nullptr) {
+        Diagnostic diagnostic{DiagnosticConstants::CODEGEN, DiagnosticConstants::BACKEND_UNAVAILABLE};
+        diagnostic.args[0] = error;
+        m_diagnostics.report(std::move(diagnostic));
         return false;
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    return true;
+}
 
-    //Resolve symbolres//
-    cmdTimingPrint("Compiler: Resolving symbolres\n");
-    start = omp_get_wtime();
-    if(!m_symbolResolver->resolveSymbols(m_symbolTable, m_parseTree->getRoot(), m_statusMessage, m_codeLines)) {
-        return false;
+bool Compiler::runProgram() {
+    //Execution is never cached - the program reads input and has side effects
+    m_source.reset();
+    return runPasses({EXECUTED});
+}
+
+bool Compiler::run(Artifact target) {
+    if (m_options.cache) {
+        return runCached(target);
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    m_source.reset();
+    return runPasses({target});
+}
 
-    //Delete the lexer and build the AST concurrently//
-    cmdTimingPrint("Compiler: Building AST\n");
-    start = omp_get_wtime();
-    //Delete the lexer after PT creation is finished! It's no longer needed
-    auto lexerDeletionFuture = std::async(std::launch::async, [this] {
-        delete m_lexer;
-        m_lexer = nullptr;
-    });
-    m_ASTBuilder->buildAST(m_parseTree->getRoot(), m_AST);
-    lexerDeletionFuture.get();
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
-
-    //Check address scopes and analyze semantics while deleting the parse tree concurrently//
-    cmdTimingPrint("Compiler: Analyzing semantics and checking address scopes\n");
-    start = omp_get_wtime();
-    auto parserDeletionFuture = std::async(std::launch::async, [this] {
-        delete m_parser;
-        m_parser = nullptr;
+bool Compiler::runCached(Artifact target) {
+    auto start = chrono::steady_clock::now();
+    //The source is read up front to compute the key - its lines are only indexed once something needs them
+    std::string text;
+    if (!SourceBuffer::readFile(m_pathname, text)) {
+        //Let the lexer report the missing file
+        m_source.reset();
+        return runPasses({target});
+    }
+
+    //Line range queries share one cached binary AST, from which each requested range is written
+    Artifact stored = m_options.lineRange ? AST_BINARY : target;
+    //Only options changing the result are part of the key
+    std::string configuration = "target=" + to_string(stored) + " max-errors=" + to_string(m_options.maxErrors);
+    if (stored == IR) {
+        configuration += " O" + to_string(m_options.optimizationLevel) + " checks=" + to_string(m_options.checks);
+    }
+    std::vector<std::string> buildFiles = {"/proc/self/exe"};
+    if (stored == IR) {
+        buildFiles.push_back(Backend::modulePath());
+        buildFiles.push_back(Backend::runtimePath());
+        buildFiles.push_back(Backend::runtimeObjectPath());
+    }
+    CompileCache cache(m_options.cacheDirectory);
+    std::string key = CompileCache::key(text, configuration, buildFiles);
+
+    CacheEntry entry;
+    if (cache.load(key, text, entry)) {
+        //Diagnostics are formatted against the source lines, and compiling reports the number of lines
+        if (!entry.diagnostics.empty() || target == IR) {
+            m_source = SourceBuffer::fromString(std::move(text));
+        }
+        if (replayOutput(target, entry)) {
+            reportStep("Loading cached result", chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            return entry.success;
+        }
+    }
+
+    //The front end reuses the source read for the key
+    if (m_source == nullptr) {
+        m_source = SourceBuffer::fromString(std::move(text));
+    }
+    entry.success = runPasses({stored});
+    entry.output = m_output;
+    entry.diagnostics = m_diagnostics.collect();
+    cache.store(key, m_source->text(), entry);
+    if (entry.success && m_options.lineRange) {
+        printLines(m_output);
+    }
+    return entry.success;
+}
+
+bool Compiler::runPasses(const std::vector<Artifact>& targets) {
+    PassManager passManager;
+    registerPasses(passManager);
+    //Memory is measured once the intermediates a pass was last to consume have been freed
+    passManager.setSynchronousReleases(m_options.memstats);
+    passManager.setReportCallback([this](const Pass& pass, double seconds) {
+        reportStep(pass.description, seconds);
     });
-    auto checkAddressScopesFuture = std::async(&ScopeChecker::checkAddressScopes, m_scopeChecker, m_AST->getRoot(), std::ref(m_statusMessage), std::ref(m_codeLines));
-    auto analyzeSemanticsFuture = std::async(&SemanticAnalyzer::analyzeSemantics, m_semanticAnalyzer, m_AST->getRoot(), std::ref(m_statusMessage));
-    // Wait for all tasks to complete and retrieve function results//
-    bool checkAddressScopesResult = checkAddressScopesFuture.get();
-    bool analyzeSemanticsResult = analyzeSemanticsFuture.get();
-    parserDeletionFuture.get();
-    if(!checkAddressScopesResult || !analyzeSemanticsResult) {
-        return false;
+    return passManager.run(targets);
+}
+
+void Compiler::emitOutput(std::string_view output, bool print) {
+    emitOutput(&output, 1, print);
+}
+
+void Compiler::emitOutput(const std::string_view* outputs, std::size_t count, bool print) {
+    if (m_options.cache) {
+        for (std::size_t i = 0; i < count; i++) {
+            m_output += outputs[i];
+        }
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    if (print) {
+        printOutputs(outputs, count);
+    }
+}
 
-    //Generate code//
-    cmdTimingPrint("Compiler: Generating LLVM IR\n");
-    start = omp_get_wtime();
+void Compiler::printOutputs(const std::string_view* outputs, std::size_t count) const {
+    //Anything already printed through cout goes first
+    std::cout.flush();
+    writeAll(outputs, count);
+}
 
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+bool Compiler::replayOutput(Artifact target, CacheEntry& entry) {
+    if (entry.success && m_options.lineRange) {
+        //An unreadable binary AST is treated as a miss
+        if (!printLines(entry.output)) {
+            return false;
+        }
+    }
+    //The AST is always printed, the IR only when requested
+    else if (entry.success && (target != IR || (m_options.ir && !m_options.silent))) {
+        printOutputs(&entry.output, 1);
+    }
+    //Replay the diagnostics of the original compilation, which are formatted against the same source
+    for (Diagnostic& diagnostic : entry.diagnostics) {
+        m_diagnostics.report(std::move(diagnostic));
+    }
     return true;
 }
 
-bool Compiler::outputAST() {
-    double start = omp_get_wtime();
-    //Lex code//
-    cmdTimingPrint("Compiler: Lexing code\n");
-    if (!m_lexer->lexFile(m_pathname, m_codeLines, m_codeTokens)) {
-        m_statusMessage = "Lexing failed! Either the path was invalid or the file could not be found.";
+bool Compiler::printLines(std::string_view binaryAST) const {
+    std::string error;
+    //The binary AST was written by this compiler, so only its header is checked and reading stays independent of its size
+    std::unique_ptr<AST::BinaryAST> tree = AST::BinaryAST::fromBuffer(binaryAST.data(), binaryAST.size(), error, false);
+    if (tree == nullptr) {
         return false;
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    {
+        AST::JsonWriter writer([this](const std::string_view* outputs, std::size_t count) {
+            printOutputs(outputs, count);
+        });
+        writer.writeLines(*tree, m_options.firstLine, m_options.lastLine);
+    }
+    std::string_view newline = "\n";
+    printOutputs(&newline, 1);
+    return true;
+}
 
-    //Parse code//
-    cmdTimingPrint("Compiler: Parsing code\n");
-    start = omp_get_wtime();
-    if(!m_parser->parseCode(m_parseTree, m_codeLines, m_codeTokens, m_statusMessage)) {
-        return false;
+void Compiler::reportStep(const std::string& description, double seconds) const {
+    if (m_options.timings || m_options.memstats) {
+        cmdPrint("Compiler: " + description + "\n");
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
+    cmdTimingPrint("Time taken: " + to_string(seconds) + "\n");
+    //Memory is only sampled when requested, as reading the resident set size costs a file read
+    if (m_options.memstats) {
+        cmdMemoryPrint("Live heap: " + MemoryTracker::formatBytes(MemoryTracker::liveBytes()) +
+                       " (peak " + MemoryTracker::formatBytes(MemoryTracker::takeIntervalPeakBytes()) + ")\n");
+        cmdMemoryPrint("Resident memory: " + MemoryTracker::formatBytes(MemoryTracker::residentBytes()) +
+                       " (peak " + MemoryTracker::formatBytes(MemoryTracker::peakResidentBytes()) + ")\n");
+    }
+    if (m_options.timings || m_options.memstats) {
+        cmdPrint("\n");
+    }
+}
 
-    //Resolve symbolres//
-    cmdTimingPrint("Compiler: Resolving symbolres\n");
-    start = omp_get_wtime();
-    if(!m_symbolResolver->resolveSymbols(m_symbolTable, m_parseTree->getRoot(), m_statusMessage, m_codeLines)) {
-        return false;
+void Compiler::registerPasses(PassManager& passManager) {
+    //The pipelined front end replaces every pass up to and including validation
+    if (m_options.pipeline) {
+        passManager.addPass({"Running pipelined front end", {}, {SOURCE, ABSTRACT_SYNTAX_TREE, SCOPES_CHECKED, SEMANTICS_CHECKED}, [this] {
+            FrontendPipeline pipeline;
+            m_AST = std::make_unique<AST::AbstractSyntaxTree>();
+            return pipeline.run(m_pathname, m_source, m_AST.get(), m_diagnostics);
+        }});
+        registerBackendPasses(passManager);
+        return;
     }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
 
-    //Delete the lexer and build the AST concurrently//
-    cmdTimingPrint("Compiler: Building AST\n");
-    start = omp_get_wtime();
-    //Delete the lexer after PT creation is finished! It's no longer needed
-    auto lexerDeletionFuture = std::async(std::launch::async, [this] {
-        delete m_lexer;
-        m_lexer = nullptr;
+    //Lex code - the lexer only lives for the duration of the pass
+    passManager.addPass({"Lexing code", {}, {SOURCE, TOKENS}, [this] {
+        Lexer lexer;
+        if (!lexer.lexFile(m_pathname, m_source, m_codeTokens)) {
+            m_diagnostics.report({DiagnosticConstants::LEXER, DiagnosticConstants::FILE_NOT_FOUND});
+            return false;
+        }
+        return true;
+    }});
+
+    //Parse code
+    passManager.addPass({"Parsing code", {SOURCE, TOKENS}, {PARSE_TREE}, [this] {
+        Parser parser;
+        m_parseTree = std::make_unique<PT::ParseTree>();
+        return parser.parseCode(m_parseTree.get(), *m_source, m_codeTokens, m_diagnostics);
+    }});
+
+    //Resolve symbols - labels are rewritten in place inside the parse tree
+    passManager.addPass({"Resolving symbols", {SOURCE, PARSE_TREE}, {SYMBOL_TABLE}, [this] {
+        SymbolResolver symbolResolver;
+        return symbolResolver.resolveSymbols(m_symbolTable, m_parseTree->getRoot(), m_diagnostics, *m_source);
+    }});
+
+    //Build AST from the resolved parse tree
+    passManager.addPass({"Building AST", {PARSE_TREE, SYMBOL_TABLE}, {ABSTRACT_SYNTAX_TREE}, [this] {
+        ASTBuilder builder;
+        m_AST = std::make_unique<AST::AbstractSyntaxTree>();
+        builder.buildAST(m_parseTree->getRoot(), m_AST.get());
+        return true;
+    }});
+
+    //Scope checking and semantic analysis only read the AST and run concurrently
+    passManager.addPass({"Checking address scopes", {SOURCE, ABSTRACT_SYNTAX_TREE}, {SCOPES_CHECKED}, [this] {
+        ScopeChecker scopeChecker;
+        return scopeChecker.checkAddressScopes(m_AST->getRoot(), m_diagnostics, m_source);
+    }});
+    passManager.addPass({"Analyzing semantics", {SOURCE, ABSTRACT_SYNTAX_TREE}, {SEMANTICS_CHECKED}, [this] {
+        SemanticAnalyzer semanticAnalyzer;
+        return semanticAnalyzer.analyzeSemantics(m_AST->getRoot(), m_diagnostics, m_source);
+    }});
+
+    registerBackendPasses(passManager);
+}
+
+void Compiler::registerBackendPasses(PassManager& passManager) {
+    //Stream the AST as JSON straight to the output, without building a JSON document
+    passManager.addPass({"Serializing AST to JSON", {ABSTRACT_SYNTAX_TREE, SCOPES_CHECKED, SEMANTICS_CHECKED}, {AST_JSON}, [this] {
+        {
+            AST::JsonWriter writer([this](const std::string_view* outputs, std::size_t count) {
+                emitOutput(outputs, count, true);
+            });
+            if (m_options.lineRange) {
+                writer.writeLines(m_AST->getRoot(), m_options.firstLine, m_options.lastLine);
+            }
+            else {
+                writer.write(m_AST->getRoot());
+            }
+        }
+        emitOutput("\n", true);
+        return true;
+    }});
+
+    //Serialize AST into the binary layout, which readers walk in place
+    passManager.addPass({"Serializing AST to binary", {ABSTRACT_SYNTAX_TREE, SCOPES_CHECKED, SEMANTICS_CHECKED}, {AST_BINARY}, [this] {
+        //Binary ASTs serving line range queries from the cache are only stored
+        emitOutput(m_AST->toBinary(), !m_options.lineRange);
+        return true;
+    }});
+
+    //Infer the types registers hold, so code generation can drop the type checks that always pass
+    //Checks that can never pass are only warned about, as the program may never reach them
+    passManager.addPass({"Inferring register types", {SOURCE, ABSTRACT_SYNTAX_TREE, SCOPES_CHECKED, SEMANTICS_CHECKED}, {REGISTER_TYPES}, [this] {
+        m_types = std::make_unique<TypeInference>();
+        return m_types->inferTypes(m_AST->getRoot(), m_diagnostics, m_source);
+    }});
+
+    //Generate code - the LLVM backend is only loaded here, so runs that stop before code generation never load LLVM
+    passManager.addPass({"Generating LLVM IR", {ABSTRACT_SYNTAX_TREE, REGISTER_TYPES}, {MODULE}, [this] {
+        if (!loadBackend()) {
+            return false;
+        }
+        if (!m_backend->generateIR(m_AST.get(), *m_types, m_options.checks)) {
+            m_diagnostics.report({DiagnosticConstants::CODEGEN, DiagnosticConstants::INVALID_IR});
+            return false;
+        }
+        return true;
+    }});
+
+    //Optimize with the LLVM pipeline of the requested level (-O0 only runs the passes code generation needs)
+    passManager.addPass({"Optimizing LLVM IR", {MODULE}, {IR}, [this] {
+        std::string report = m_backend->optimize(m_options.optimizationLevel, m_options.timePasses);
+        if (m_options.timePasses) {
+            cmdPrint(report);
+        }
+        //Printing the module costs a full walk, so it is only done when the IR is printed or cached
+        if (m_options.ir || (m_options.cache && m_options.emit == BackendConstants::NO_EMIT)) {
+            emitOutput(m_backend->getIR(), m_options.ir && !m_options.silent);
+        }
+        return true;
+    }});
+
+    //Write the optimized module straight to the output file, without going through its textual form
+    passManager.addPass({"Emitting output", {MODULE, IR}, {EMITTED}, [this] {
+        std::string error;
+        if (!m_backend->emit(m_options.emit, m_options.outputPath, error)) {
+            Diagnostic diagnostic{DiagnosticConstants::CODEGEN, DiagnosticConstants::EMIT_FAILED};
+            diagnostic.args[0] = error;
+            m_diagnostics.report(std::move(diagnostic));
+            return false;
+        }
+        return true;
+    }});
+
+    //Run the program in process, with input and output on the standard streams
+    //Code is generated lazily as the program runs, so the AST is kept until it exits
+    passManager.addPass({"Running program", {ABSTRACT_SYNTAX_TREE, REGISTER_TYPES}, {EXECUTED}, [this] {
+        if (!loadBackend()) {
+            return false;
+        }
+        std::string error;
+        //Type warnings are shown before the program runs, as a failed runtime check exits without returning here
+        if (!m_options.silent && m_options.diagnosticsFormat == DiagnosticConstants::TEXT && m_diagnostics.hasWarnings()) {
+            std::cerr << getStatus() << std::endl;
+            m_warningsShown = true;
+        }
+        //Compiler output goes first, the program writes through the C library
+        std::cout.flush();
+        if (!m_backend->execute(m_AST.get(), *m_types, m_options.optimizationLevel, m_options.checks, m_exitCode, error)) {
+            Diagnostic diagnostic{DiagnosticConstants::CODEGEN, DiagnosticConstants::JIT_FAILED};
+            diagnostic.args[0] = error;
+            m_diagnostics.report(std::move(diagnostic));
+            return false;
+        }
+        return true;
+    }});
+
+    //Intermediates freed once no remaining pass needs them (the source is kept for diagnostics)
+    passManager.addRelease(MODULE, [this] {
+        m_backend.reset();
     });
-    m_ASTBuilder->buildAST(m_parseTree->getRoot(), m_AST);
-    lexerDeletionFuture.get();
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
-
-    //Check address scopes and analyze semantics while deleting the parse tree concurrently
-    cmdTimingPrint("Compiler: Analyzing semantics and checking address scopes\n");
-    start = omp_get_wtime();
-    auto parserDeletionFuture = std::async(std::launch::async, [this] {
-        delete m_parser;
-        m_parser = nullptr;
+    passManager.addRelease(TOKENS, [this] {
+        std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>().swap(m_codeTokens);
     });
-    auto checkAddressScopesFuture = std::async(&ScopeChecker::checkAddressScopes, m_scopeChecker, m_AST->getRoot(), std::ref(m_statusMessage), std::ref(m_codeLines));
-    auto analyzeSemanticsFuture = std::async(&SemanticAnalyzer::analyzeSemantics, m_semanticAnalyzer, m_AST->getRoot(), std::ref(m_statusMessage));
-    // Wait for all tasks to complete and retrieve function results
-    bool checkAddressScopesResult = checkAddressScopesFuture.get();
-    bool analyzeSemanticsResult = analyzeSemanticsFuture.get();
-    parserDeletionFuture.get();
-    if(!checkAddressScopesResult || !analyzeSemanticsResult) {
-        return false;
-    }
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime()-start) + "\n\n");
-
-    //Serialize and return AST as JSON
-    cmdTimingPrint("Compiler: Serializing AST to JSON\n");
-    start = omp_get_wtime();
-    auto jsonAST = m_AST->toJson();
-    std::cout << jsonAST.dump(4) << std::endl;
-    cmdTimingPrint("Time taken: " + to_string(omp_get_wtime() - start) + "\n\n");
-    return true;
-}
\ No newline at end of file
+    passManager.addRelease(PARSE_TREE, [this] {
+        m_parseTree.reset();
+    });
+    passManager.addRelease(SYMBOL_TABLE, [this] {
+        std::unordered_map<std::string, std::pair<std::string, int>>().swap(m_symbolTable);
+    });
+    passManager.addRelease(ABSTRACT_SYNTAX_TREE, [this] {
+        m_AST.reset();
+    });
+    passManager.addRelease(REGISTER_TYPES, [this] {
+        m_types.reset();
+    });
+}
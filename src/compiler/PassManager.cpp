@@ -0,0 +1,158 @@
+#include "compiler/PassManager.h"
+#include "parallel/TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+using namespace std;
+using namespace PassConstants;
+
+void PassManager::addPass(Pass pass) {
+    m_passes.push_back(std::move(pass));
+}
+
+void PassManager::addRelease(Artifact artifact, std::function<void()> release) {
+    m_releases[artifact] = std::move(release);
+}
+
+void PassManager::reportWave(const vector<size_t>& wave, const vector<double>& seconds) const {
+    if (m_reportCallback) {
+        for (size_t slot = 0; slot < wave.size(); slot++) {
+            m_reportCallback(m_passes[wave[slot]], seconds[slot]);
+        }
+    }
+}
+
+bool PassManager::markNeeded(Artifact artifact, vector<bool>& needed) const {
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        const auto& outputs = m_passes[i].outputs;
+        if (find(outputs.begin(), outputs.end(), artifact) != outputs.end()) {
+            if (!needed[i]) {
+                needed[i] = true;
+                for (Artifact input : m_passes[i].inputs) {
+                    if (!markNeeded(input, needed)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    }
+    //No pass produces the artifact
+    return false;
+}
+
+bool PassManager::run(const vector<Artifact>& targets) {
+    //Find every pass the targets depend on, skipping the rest
+    vector<bool> needed(m_passes.size(), false);
+    for (Artifact target : targets) {
+        if (!markNeeded(target, needed)) {
+            return false;
+        }
+    }
+
+    //Count the remaining consumers of every artifact so it can be released after its last one
+    int remainingConsumers[NUM_ARTIFACTS] = {};
+    bool isTarget[NUM_ARTIFACTS] = {};
+    bool available[NUM_ARTIFACTS] = {};
+    for (Artifact target : targets) {
+        isTarget[target] = true;
+    }
+    size_t numNeeded = 0;
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        if (needed[i]) {
+            numNeeded++;
+            for (Artifact input : m_passes[i].inputs) {
+                remainingConsumers[input]++;
+            }
+        }
+    }
+
+    vector<bool> finished(m_passes.size(), false);
+    //Releases run in the background while the next wave of passes executes
+    TaskScheduler::TaskGroup pendingReleases;
+    size_t numFinished = 0;
+    bool success = true;
+    //Every phase is linear in the program size, so the previous wave predicts the cost of the next one
+    //(the first wave also pays one-off setup costs, so it is a poor predictor)
+    double longestPass = 0;
+
+    while (numFinished < numNeeded) {
+        //Collect every pass whose inputs are all available
+        vector<size_t> wave;
+        for (size_t i = 0; i < m_passes.size(); i++) {
+            if (needed[i] && !finished[i] && all_of(m_passes[i].inputs.begin(), m_passes[i].inputs.end(), [&](Artifact input) { return available[input]; })) {
+                wave.push_back(i);
+            }
+        }
+        //A dependency cycle or an unproduced input leaves nothing to run
+        if (wave.empty()) {
+            success = false;
+            break;
+        }
+
+        //Run the wave concurrently if the cost model says it pays - the first pass runs on this thread
+        TaskScheduler& scheduler = TaskScheduler::instance();
+        bool concurrent = wave.size() > 1 && scheduler.worthParallel(longestPass * wave.size());
+        vector<double> seconds(wave.size(), 0.0);
+        vector<char> results(wave.size(), 0);
+        auto runPass = [&](size_t slot) {
+            auto start = chrono::steady_clock::now();
+            results[slot] = m_passes[wave[slot]].run() ? 1 : 0;
+            seconds[slot] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        };
+        TaskScheduler::TaskGroup passes;
+        for (size_t slot = 1; slot < wave.size(); slot++) {
+            if (concurrent) {
+                passes.run([&runPass, slot] { runPass(slot); });
+            }
+            else {
+                runPass(slot);
+            }
+        }
+        runPass(0);
+        passes.wait();
+        //Releases started during the previous wave must be done before starting new ones
+        pendingReleases.wait();
+
+        longestPass = 0;
+        for (size_t slot = 0; slot < wave.size(); slot++) {
+            finished[wave[slot]] = true;
+            numFinished++;
+            longestPass = max(longestPass, seconds[slot]);
+            if (!results[slot]) {
+                success = false;
+            }
+        }
+        if (!success) {
+            reportWave(wave, seconds);
+            break;
+        }
+
+        //Publish outputs and release inputs that no remaining pass consumes (in the background if that pays)
+        int backgroundReleases = -1;
+        for (size_t index : wave) {
+            for (Artifact output : m_passes[index].outputs) {
+                available[output] = true;
+            }
+            for (Artifact input : m_passes[index].inputs) {
+                if (--remainingConsumers[input] == 0 && !isTarget[input] && m_releases[input]) {
+                    if (backgroundReleases < 0) {
+                        backgroundReleases = !m_synchronousReleases && scheduler.worthParallel(longestPass) ? 1 : 0;
+                    }
+                    if (backgroundReleases) {
+                        pendingReleases.run(m_releases[input]);
+                    }
+                    else {
+                        m_releases[input]();
+                    }
+                }
+            }
+        }
+        reportWave(wave, seconds);
+    }
+
+    pendingReleases.wait();
+    return success;
+}
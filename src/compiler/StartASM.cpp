@@ -1,8 +1,12 @@
 #include "compiler/Compiler.h"
+#include "parallel/TaskScheduler.h"
+#include "memory/MemoryTracker.h"
+#include "lsp/LanguageServer.h"
 #include <iostream>
-#include <omp.h>
+#include <chrono>
 #include <string>
 #include <algorithm>
+#include <climits>
 
 //Include the Easter egg functions
 #include "misc/.Secrets.h"
@@ -14,6 +18,39 @@ bool cmdOptionExists(char** begin, char** end, const string& option) {
     return find(begin, end, option) != end;
 }
 
+//Function to get the value of a command-line option given as --option=value, nullptr if absent
+const char* getCmdOption(char** begin, char** end, const string& option) {
+    for (char** itr = begin; itr != end; itr++) {
+        if (string(*itr).rfind(option, 0) == 0) {
+            return *itr + option.length();
+        }
+    }
+    return nullptr;
+}
+
+//Function to get the value of an option given either as --option=value or --option value, nullptr if absent
+const char* getCmdValue(char** begin, char** end, const string& option) {
+    if (const char* value = getCmdOption(begin, end, option + "=")) {
+        return value;
+    }
+    char** itr = find(begin, end, option);
+    if (itr != end && itr + 1 != end) {
+        return *(itr + 1);
+    }
+    return nullptr;
+}
+
+//Wall clock time in seconds
+double wallTime() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Print the peak memory use of the whole run
+void printMemorySummary() {
+    cout << "Peak live heap: " << MemoryTracker::formatBytes(MemoryTracker::peakBytes()) << "\n";
+    cout << "Peak resident memory: " << MemoryTracker::formatBytes(MemoryTracker::peakResidentBytes()) << "\n";
+}
+
 //Function to check for valid .sasm file extension
 bool isValidSASMFile(const string& filename) {
     if (filename.length() >= 5) {
@@ -35,12 +72,31 @@ void displayHelp() {
     cout << "StartASM Compiler Usage:" << endl;
     cout << "  startasm compile <filepath.sasm> [options]" << endl;
     cout << "  startasm ast <filepath.sasm> [options]" << endl;
+    cout << "  startasm run <filepath.sasm> [options]  JIT compile and run the program, exiting with its exit code" << endl;
+    cout << "  startasm lsp [options]       Serve the Language Server Protocol over stdio" << endl;
     cout << "Options:" << endl;
     cout << "  --help        Display this help message and exit" << endl;
     cout << "  --timings     Print out timings for each compilation step" << endl;
+    cout << "  --memstats    Print out live heap and resident memory after each compilation step" << endl;
+    cout << "  --format=FORMAT  Print the AST as 'json' (default) or 'bin', a compact binary layout read in place (ast only)" << endl;
+    cout << "  --lines=A:B   Only print the instructions on code lines A to B (ast only, 'A:' for the rest of the file)" << endl;
+    cout << "  --page=N      Only print the Nth page of --page-size lines (ast only)" << endl;
+    cout << "  --page-size=N Lines per page for --page (defaults to 100)" << endl;
     cout << "  --ir        Print out generated LLVM IR (if compiling)" << endl;
+    cout << "  --emit=FORMAT Write the optimized module as 'll', 'bc', 'asm', 'obj' or a linked 'exe' (compile only)" << endl;
+    cout << "  -o FILE       File to emit to (defaults to the source name with the format's extension, -o alone emits an exe)" << endl;
+    cout << "  -O0, -O1, -O2, -O3  Optimize the generated IR with the LLVM pipeline of that level (defaults to -O0)" << endl;
+    cout << "  --checks=LEVEL  Runtime checks in the generated code: 'full' (default) reports the line and error, 'fast' only traps, 'none' trusts the program" << endl;
+    cout << "  --time-passes  Print the time taken by each LLVM optimization pass" << endl;
+    cout << "  --jobs=N      Use at most N threads (defaults to the CPUs available to the process)" << endl;
+    cout << "  --parallelism=MODE  'auto' (default) picks serial or parallel execution per phase, 'serial' or 'parallel' force it" << endl;
+    cout << "  --pipeline    Overlap lexing, parsing, AST building and validation on chunks of lines" << endl;
     cout << "  --silent      Suppress output (except syntax errors)" << endl;
     cout << "  --truesilent  Suppress all output, including syntax errors" << endl;
+    cout << "  --max-errors=N  Report only the first N errors by phase and line (0 for no limit, lsp defaults to 1000)" << endl;
+    cout << "  --diagnostics=FORMAT  Print diagnostics as 'text' (default) or 'json'" << endl;
+    cout << "  --cache       Reuse results of earlier compilations of unchanged files (stored in ~/.cache/startasm/compile)" << endl;
+    cout << "  --cache-dir=DIR  Use DIR as the compile cache (implies --cache)" << endl;
     cout << "Note that the use of --silent or --truesilent will override output flags such --timings." << endl;
 }
 
@@ -77,8 +133,9 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    //Requires at least 2 arguments: the command and the filepath
-    if (argc < 3) {
+    //Requires at least 2 arguments: the command and the filepath (the language server gets its documents from the editor)
+    bool languageServer = argc > 1 && string(argv[1]) == "lsp";
+    if (argc < 3 && !languageServer) {
         if (!cmdOptionExists(argv, argv + argc, "--truesilent")) {
             cerr << "Missing arguments." << endl;
             cerr << "For usage information: startasm --help" << endl;
@@ -87,7 +144,7 @@ int main(int argc, char* argv[]) {
     }
 
     string command(argv[1]);
-    if (command != "compile" && command!= "ast") {
+    if (command != "compile" && command!= "ast" && command != "run" && !languageServer) {
         if (!cmdOptionExists(argv, argv + argc, "--truesilent")) {
             cerr << "Unknown command: " << command << endl;
             cerr << "For usage information: startasm --help" << endl;
@@ -95,21 +152,238 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    string filepath(argv[2]);
-    if (!isValidSASMFile(filepath) && !cmdOptionExists(argv, argv + argc, "--truesilent")) {
+    string filepath(languageServer ? "" : argv[2]);
+    if (!languageServer && !isValidSASMFile(filepath) && !cmdOptionExists(argv, argv + argc, "--truesilent")) {
         cerr << "Error: The file must have a .sasm extension." << endl;
         return 1;
     }
 
     //Flags
     bool timings = cmdOptionExists(argv, argv + argc, "--timings");
+    bool memstats = cmdOptionExists(argv, argv + argc, "--memstats");
     bool ir = cmdOptionExists(argv, argv + argc, "--ir");
     bool silent = cmdOptionExists(argv, argv + argc, "--silent") || cmdOptionExists(argv, argv + argc, "--truesilent");
     bool truesilent = cmdOptionExists(argv, argv + argc, "--truesilent");
 
+    //Options
+    CompilerOptions options;
+    options.silent = silent;
+    options.timings = timings;
+    options.memstats = memstats;
+    options.ir = ir;
+    options.pipeline = cmdOptionExists(argv, argv + argc, "--pipeline");
+    options.timePasses = cmdOptionExists(argv, argv + argc, "--time-passes");
+    //The last -O flag wins, as with other compilers
+    for (int i = 2; i < argc; i++) {
+        string argument = argv[i];
+        if (argument.rfind("-O", 0) == 0) {
+            if (argument.size() != 3 || argument[2] < '0' || argument[2] > '3') {
+                if (!truesilent) {
+                    cerr << "Error: Unknown optimization level '" << argument << "', expected -O0, -O1, -O2 or -O3." << endl;
+                }
+                return 1;
+            }
+            options.optimizationLevel = argument[2] - '0';
+        }
+    }
+    if (const char* checks = getCmdOption(argv, argv + argc, "--checks=")) {
+        if (string(checks) == "fast") {
+            options.checks = BackendConstants::FAST_CHECKS;
+        }
+        else if (string(checks) == "none") {
+            options.checks = BackendConstants::NO_CHECKS;
+        }
+        else if (string(checks) != "full") {
+            if (!truesilent) {
+                cerr << "Error: --checks expects 'full', 'fast' or 'none'." << endl;
+            }
+            return 1;
+        }
+    }
+    //Emission - the output defaults to the source file name with the extension of the format
+    const char* emit = getCmdOption(argv, argv + argc, "--emit=");
+    char** output = find(argv, argv + argc, string("-o"));
+    if (emit != nullptr || output != argv + argc) {
+        static const pair<const char*, BackendConstants::EmitFormat> formats[] = {
+            {"ll", BackendConstants::LL}, {"bc", BackendConstants::BC}, {"asm", BackendConstants::ASM},
+            {"obj", BackendConstants::OBJ}, {"exe", BackendConstants::EXE}
+        };
+        static const char* extensions[] = {"", ".ll", ".bc", ".s", ".o", ""};
+        options.emit = BackendConstants::EXE;
+        if (emit != nullptr) {
+            auto format = find_if(begin(formats), end(formats), [emit](const auto& format) {
+                return string(format.first) == emit;
+            });
+            if (format == end(formats)) {
+                if (!truesilent) {
+                    cerr << "Error: --emit expects 'll', 'bc', 'asm', 'obj' or 'exe'." << endl;
+                }
+                return 1;
+            }
+            options.emit = format->second;
+        }
+        if (command != "compile") {
+            if (!truesilent) {
+                cerr << "Error: --emit and -o only apply to compile." << endl;
+            }
+            return 1;
+        }
+        if (output != argv + argc && (output + 1 == argv + argc || **(output + 1) == '\0')) {
+            if (!truesilent) {
+                cerr << "Error: -o expects a file." << endl;
+            }
+            return 1;
+        }
+        options.outputPath = output != argv + argc ? *(output + 1) :
+                             filepath.substr(0, filepath.length() - 5) + extensions[options.emit];
+    }
+    options.cache = cmdOptionExists(argv, argv + argc, "--cache");
+    if (const char* cacheDirectory = getCmdOption(argv, argv + argc, "--cache-dir=")) {
+        if (*cacheDirectory == '\0') {
+            if (!truesilent) {
+                cerr << "Error: --cache-dir expects a directory." << endl;
+            }
+            return 1;
+        }
+        options.cache = true;
+        options.cacheDirectory = cacheDirectory;
+    }
+    if (const char* maxErrors = getCmdOption(argv, argv + argc, "--max-errors=")) {
+        char* end = nullptr;
+        long value = strtol(maxErrors, &end, 10);
+        if (*maxErrors == '\0' || *end != '\0' || value < 0) {
+            if (!truesilent) {
+                cerr << "Error: --max-errors expects a non-negative number." << endl;
+            }
+            return 1;
+        }
+        options.maxErrors = static_cast<int>(value);
+    }
+    if (const char* format = getCmdOption(argv, argv + argc, "--diagnostics=")) {
+        if (string(format) == "json") {
+            options.diagnosticsFormat = DiagnosticConstants::JSON;
+        }
+        else if (string(format) != "text") {
+            if (!truesilent) {
+                cerr << "Error: --diagnostics expects 'text' or 'json'." << endl;
+            }
+            return 1;
+        }
+    }
+    if (const char* format = getCmdOption(argv, argv + argc, "--format=")) {
+        if (string(format) == "bin") {
+            options.binaryAST = true;
+        }
+        else if (string(format) != "json") {
+            if (!truesilent) {
+                cerr << "Error: --format expects 'json' or 'bin'." << endl;
+            }
+            return 1;
+        }
+    }
+    //Line range queries - the whole program is still validated, but only the requested instructions are serialized
+    const char* lines = getCmdOption(argv, argv + argc, "--lines=");
+    const char* page = getCmdOption(argv, argv + argc, "--page=");
+    if (lines != nullptr && page != nullptr) {
+        if (!truesilent) {
+            cerr << "Error: --lines and --page can't be combined." << endl;
+        }
+        return 1;
+    }
+    if (lines != nullptr) {
+        //A:B, or A: for every line from A
+        char* end = nullptr;
+        long first = strtol(lines, &end, 10);
+        long last = INT_MAX;
+        bool valid = end != lines && *end == ':' && first >= 1;
+        if (valid && *(end + 1) != '\0') {
+            const char* lastText = end + 1;
+            last = strtol(lastText, &end, 10);
+            valid = *end == '\0' && last >= first && last <= INT_MAX;
+        }
+        if (!valid || first > INT_MAX) {
+            if (!truesilent) {
+                cerr << "Error: --lines expects A:B with 1 <= A <= B, or A:." << endl;
+            }
+            return 1;
+        }
+        options.lineRange = true;
+        options.firstLine = static_cast<int>(first);
+        options.lastLine = static_cast<int>(last);
+    }
+    if (page != nullptr) {
+        long pageSize = 100;
+        if (const char* size = getCmdOption(argv, argv + argc, "--page-size=")) {
+            char* end = nullptr;
+            pageSize = strtol(size, &end, 10);
+            if (*size == '\0' || *end != '\0' || pageSize < 1 || pageSize > INT_MAX) {
+                if (!truesilent) {
+                    cerr << "Error: --page-size expects a positive number." << endl;
+                }
+                return 1;
+            }
+        }
+        char* end = nullptr;
+        long number = strtol(page, &end, 10);
+        if (*page == '\0' || *end != '\0' || number < 1 || number - 1 >= INT_MAX / pageSize) {
+            if (!truesilent) {
+                cerr << "Error: --page expects a positive number." << endl;
+            }
+            return 1;
+        }
+        options.lineRange = true;
+        options.firstLine = static_cast<int>((number - 1) * pageSize + 1);
+        options.lastLine = static_cast<int>(min<long>(number * pageSize, INT_MAX));
+    }
+    if (options.lineRange && options.binaryAST) {
+        if (!truesilent) {
+            cerr << "Error: --lines and --page only apply to JSON output, binary ASTs can be read in place." << endl;
+        }
+        return 1;
+    }
+    if (cmdOptionExists(argv, argv + argc, "--jobs") || getCmdOption(argv, argv + argc, "--jobs=")) {
+        const char* jobs = getCmdValue(argv, argv + argc, "--jobs");
+        char* end = nullptr;
+        long value = jobs != nullptr ? strtol(jobs, &end, 10) : 0;
+        if (jobs == nullptr || *jobs == '\0' || *end != '\0' || value < 1) {
+            if (!truesilent) {
+                cerr << "Error: --jobs expects a positive number." << endl;
+            }
+            return 1;
+        }
+        TaskScheduler::setJobs(static_cast<int>(value));
+    }
+    if (const char* parallelism = getCmdOption(argv, argv + argc, "--parallelism=")) {
+        if (string(parallelism) == "serial") {
+            TaskScheduler::setParallelism(SchedulerConstants::SERIAL);
+        }
+        else if (string(parallelism) == "parallel") {
+            TaskScheduler::setParallelism(SchedulerConstants::PARALLEL);
+        }
+        else if (string(parallelism) != "auto") {
+            if (!truesilent) {
+                cerr << "Error: --parallelism expects 'auto', 'serial' or 'parallel'." << endl;
+            }
+            return 1;
+        }
+    }
+    bool jsonDiagnostics = options.diagnosticsFormat == DiagnosticConstants::JSON;
+
+    if (languageServer) {
+        //Publish a bounded number of diagnostics per document unless told otherwise
+        bool maxErrors = getCmdOption(argv, argv + argc, "--max-errors=") != nullptr;
+        LanguageServer server(maxErrors ? options.maxErrors : LspConstants::MAX_DIAGNOSTICS);
+        return server.run();
+    }
+
+    //Count heap allocations from here on, before any compiler data structure exists
+    if (memstats) {
+        MemoryTracker::enable();
+    }
+
     //Adjust the compiler instantiation to pass the truesilent flag
-    Compiler StartASMCompiler(filepath, silent, timings, ir);
-    double start = omp_get_wtime();
+    Compiler StartASMCompiler(filepath, options);
+    double start = wallTime();
     if (command == "compile") {
         if (!StartASMCompiler.compileCode()) {
             if (!truesilent) {
@@ -118,17 +392,44 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         else {
-            double end = omp_get_wtime();
+            //Machine readable diagnostics are always printed, even when empty, warnings whenever there are any
+            if ((jsonDiagnostics && !truesilent) || (StartASMCompiler.hasWarnings() && !silent)) {
+                cerr << StartASMCompiler.getStatus() << endl;
+            }
+            double end = wallTime();
 
             if (timings && !silent) {
                 cout << "Total time taken: " << (end - start) << " seconds\n";
             }
+            if (memstats && !silent) {
+                printMemorySummary();
+            }
 
             if (!silent) {
                 cout << StartASMCompiler.getNumLines() << " lines compiled.\n";
             }
         }
     }
+    else if (command == "run") {
+        if (!StartASMCompiler.runProgram()) {
+            if (!truesilent) {
+                cerr << StartASMCompiler.getStatus() << endl;
+            }
+            return 1;
+        }
+        if (jsonDiagnostics && !truesilent) {
+            cerr << StartASMCompiler.getStatus() << endl;
+        }
+        double end = wallTime();
+
+        if (timings && !silent) {
+            cout << "Total time taken: " << (end - start) << " seconds\n";
+        }
+        if (memstats && !silent) {
+            printMemorySummary();
+        }
+        return StartASMCompiler.getExitCode();
+    }
     else if (command == "ast") {
         if (!StartASMCompiler.outputAST()) {
             if (!truesilent) {
@@ -137,11 +438,17 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         else {
-            double end = omp_get_wtime();
+            if (jsonDiagnostics && !truesilent) {
+                cerr << StartASMCompiler.getStatus() << endl;
+            }
+            double end = wallTime();
 
             if (timings && !silent) {
                 cout << "Total time taken: " << (end - start) << " seconds\n";
             }
+            if (memstats && !silent) {
+                printMemorySummary();
+            }
         }
     }
     return 0;
@@ -0,0 +1,412 @@
+#include "diagnostics/Diagnostics.h"
+#include "ast/AbstractSyntaxTree.h"
+#include "runtime/Runtime.h"
+#include "lib/json.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace DiagnosticConstants;
+
+namespace {
+    //Source of unique engine ids (0 is reserved for "no engine")
+    std::atomic<std::uint64_t> nextEngineId{1};
+
+    //Thread-local cache of the buffer this thread last used, tagged with the owning engine id
+    struct BufferCache {
+        std::uint64_t engineId = 0;
+        void* buffer = nullptr;
+    };
+    thread_local BufferCache localCache;
+
+    //Readable description of an expected operand type
+    const char* operandDescription(ASTConstants::OperandType type) {
+        switch (type) {
+            case ASTConstants::REGISTER:
+                return "register r0-r9";
+            case ASTConstants::INSTRUCTIONADDRESS:
+                return "instruction address i[...]";
+            case ASTConstants::MEMORYADDRESS:
+                return "memory address m<...>";
+            case ASTConstants::INTEGER:
+                return "integer";
+            case ASTConstants::FLOAT:
+                return "float";
+            case ASTConstants::BOOLEAN:
+                return "boolean";
+            case ASTConstants::CHARACTER:
+                return "character";
+            case ASTConstants::STRING:
+                return "comment string";
+            case ASTConstants::NEWLINE:
+                return "newline";
+            case ASTConstants::TYPECONDITION:
+                return "type condition: integer/float/boolean/character/memory/instruction";
+            case ASTConstants::SHIFTCONDITION:
+                return "shift condition: left/right";
+            case ASTConstants::JUMPCONDITION:
+                return "jump condition: unconditional/greater/less/equal/zero/unequal/nonzero";
+            default:
+                return "undefined";
+        }
+    }
+
+    //Readable list of a bit set of runtime types (type inference)
+    string typeDescription(unsigned types) {
+        static const char* const names[] = {"no value", "an integer", "a float", "a boolean", "a character",
+                                            "a memory address", "an instruction address"};
+        vector<const char*> held;
+        for (int type = RuntimeConstants::UNDEFINED; type <= RuntimeConstants::INSTRUCTION; type++) {
+            if ((types & (1u << type)) != 0) {
+                held.push_back(names[type]);
+            }
+        }
+        string text;
+        for (size_t i = 0; i < held.size(); i++) {
+            text += i == 0 ? "" : i + 1 == held.size() ? " or " : ", ";
+            text += held[i];
+        }
+        return text;
+    }
+
+    const char* phaseName(Phase phase) {
+        switch (phase) {
+            case LEXER: return "lexer";
+            case PARSER: return "parser";
+            case SYMBOLS: return "symbols";
+            case SCOPE: return "scope";
+            case SEMANTICS: return "semantics";
+            case TYPES: return "types";
+            case CODEGEN: return "codegen";
+            default: return "unknown";
+        }
+    }
+
+    const char* codeName(Code code) {
+        switch (code) {
+            case FILE_NOT_FOUND: return "file-not-found";
+            case UNKNOWN_INSTRUCTION: return "unknown-instruction";
+            case MISSING_INSTRUCTION_PARSER: return "missing-instruction-parser";
+            case MISSING_INSTRUCTION_INFO: return "missing-instruction-info";
+            case EXCESS_TOKENS: return "excess-tokens";
+            case MISSING_CONJUNCTION: return "missing-conjunction";
+            case UNKNOWN_CONJUNCTION: return "unknown-conjunction";
+            case MISSING_CONDITION: return "missing-condition";
+            case UNKNOWN_CONDITION: return "unknown-condition";
+            case MISSING_OPERAND: return "missing-operand";
+            case UNKNOWN_OPERAND: return "unknown-operand";
+            case MISSING_DESCRIPTOR: return "missing-descriptor";
+            case UNKNOWN_DESCRIPTOR: return "unknown-descriptor";
+            case DUPLICATE_LABEL: return "duplicate-label";
+            case UNDEFINED_LABEL: return "undefined-label";
+            case REGISTER_OUT_OF_RANGE: return "register-out-of-range";
+            case MEMORY_OUT_OF_RANGE: return "memory-out-of-range";
+            case INSTRUCTION_OUT_OF_PROGRAM: return "instruction-out-of-program";
+            case INSTRUCTION_OUT_OF_RANGE: return "instruction-out-of-range";
+            case UNRECOGNIZED_OPERAND: return "unrecognized-operand";
+            case UNEXPECTED_OPERAND: return "unexpected-operand";
+            case UNEXPECTED_TYPE: return "unexpected-type";
+            case MISMATCHED_TYPES: return "mismatched-types";
+            case BACKEND_UNAVAILABLE: return "backend-unavailable";
+            case INVALID_IR: return "invalid-ir";
+            case EMIT_FAILED: return "emit-failed";
+            case JIT_FAILED: return "jit-failed";
+            default: return "unknown";
+        }
+    }
+
+    //Line header printed once before the messages of a line
+    void appendHeader(string& output, const Diagnostic& diagnostic, const SourceBuffer* source) {
+        switch (diagnostic.phase) {
+            case PARSER:
+                output += "\nInvalid syntax at line ";
+                break;
+            case SYMBOLS:
+                output += "\nLabel error at line ";
+                break;
+            case SCOPE:
+                output += "\nScope error at line ";
+                break;
+            case TYPES:
+                output += "\nType warning at line ";
+                break;
+            default:
+                output += "Invalid syntax at line ";
+                break;
+        }
+        output += to_string(diagnostic.line);
+        output += ": ";
+        if (source != nullptr && diagnostic.line > 0 && diagnostic.line <= source->numLines()) {
+            output += source->line(diagnostic.line - 1);
+        }
+        output += '\n';
+    }
+}
+
+DiagnosticEngine::DiagnosticEngine(int maxErrors) :
+    m_id(nextEngineId.fetch_add(1, std::memory_order_relaxed)),
+    m_maxErrors(maxErrors > 0 ? maxErrors : 0) {}
+
+DiagnosticEngine::~DiagnosticEngine() {
+    Buffer* buffer = m_buffers.load(std::memory_order_acquire);
+    while (buffer != nullptr) {
+        Buffer* next = buffer->next;
+        delete buffer;
+        buffer = next;
+    }
+}
+
+DiagnosticEngine::Buffer* DiagnosticEngine::localBuffer() {
+    //Fast path - this thread already owns a buffer in this engine
+    if (localCache.engineId == m_id) {
+        return static_cast<Buffer*>(localCache.buffer);
+    }
+    //Slow path - create a buffer and push it onto the lock-free list
+    auto* buffer = new Buffer();
+    buffer->next = m_buffers.load(std::memory_order_relaxed);
+    while (!m_buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed)) {}
+    localCache.engineId = m_id;
+    localCache.buffer = buffer;
+    return buffer;
+}
+
+bool DiagnosticEngine::report(Diagnostic diagnostic) {
+    //Warnings are kept outside the error cap
+    if (isWarning(diagnostic)) {
+        m_warnings.fetch_add(1, std::memory_order_relaxed);
+        m_phaseCounts[diagnostic.phase].fetch_add(1, std::memory_order_relaxed);
+        localBuffer()->diagnostics.push_back(std::move(diagnostic));
+        return true;
+    }
+    m_phaseCounts[diagnostic.phase].fetch_add(1, std::memory_order_relaxed);
+    if (m_maxErrors > 0) {
+        //Errors sorting after the first maxErrors can never be shown, those before them take their place
+        int64_t key = orderKey(diagnostic.phase, diagnostic.line);
+        if (key >= m_cutoff.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        lock_guard<mutex> lock(m_capMutex);
+        if (key >= m_cutoff.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        m_firstErrors.push(key);
+        if (static_cast<int>(m_firstErrors.size()) > m_maxErrors) {
+            m_firstErrors.pop();
+        }
+        if (static_cast<int>(m_firstErrors.size()) == m_maxErrors) {
+            m_cutoff.store(m_firstErrors.top(), std::memory_order_relaxed);
+        }
+    }
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    localBuffer()->diagnostics.push_back(std::move(diagnostic));
+    return true;
+}
+
+vector<Diagnostic> DiagnosticEngine::collect() const {
+    vector<Diagnostic> diagnostics;
+    diagnostics.reserve(m_count.load(std::memory_order_relaxed) + m_warnings.load(std::memory_order_relaxed));
+    for (Buffer* buffer = m_buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+        diagnostics.insert(diagnostics.end(), buffer->diagnostics.begin(), buffer->diagnostics.end());
+    }
+    //Diagnostics of a single line are always reported by one thread, so a stable sort keeps their order
+    stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        if (a.phase != b.phase) {
+            return a.phase < b.phase;
+        }
+        return a.line < b.line;
+    });
+    //Errors replaced by ones sorting before them are cut, so the kept errors never depend on thread timing
+    if (m_maxErrors > 0) {
+        size_t kept = 0;
+        int errors = 0;
+        for (size_t i = 0; i < diagnostics.size(); i++) {
+            if (isWarning(diagnostics[i]) || errors++ < m_maxErrors) {
+                if (kept != i) {
+                    diagnostics[kept] = std::move(diagnostics[i]);
+                }
+                kept++;
+            }
+        }
+        diagnostics.resize(kept);
+    }
+    return diagnostics;
+}
+
+string DiagnosticEngine::format(Format format, const SourceBuffer* source, bool warnings) const {
+    vector<Diagnostic> diagnostics = collect();
+    if (!warnings) {
+        diagnostics.erase(remove_if(diagnostics.begin(), diagnostics.end(), isWarning), diagnostics.end());
+    }
+    if (format == JSON) {
+        return formatJson(diagnostics, source);
+    }
+    return formatText(diagnostics, source);
+}
+
+const char* DiagnosticEngine::identifier(Code code) {
+    return codeName(code);
+}
+
+string DiagnosticEngine::message(const Diagnostic& diagnostic) {
+    const string& a0 = diagnostic.args[0];
+    const string& a1 = diagnostic.args[1];
+    switch (diagnostic.code) {
+        case FILE_NOT_FOUND:
+            return "Lexing failed. Either the path was invalid or the file could not be found.";
+        case UNKNOWN_INSTRUCTION:
+            return "Unknown instruction '" + a0 + "'";
+        case MISSING_INSTRUCTION_PARSER:
+            return "Compiler error for '" + a0 + "'. Could not find instruction parsing method.";
+        case MISSING_INSTRUCTION_INFO:
+            return "Compiler error for '" + a0 + "'. Could not find instruction information.";
+        case EXCESS_TOKENS:
+            return "Excess tokens at and past '" + a0 + "' found.";
+        case MISSING_CONJUNCTION:
+            return "Missing conjunction. Expected '" + a0 + "'";
+        case UNKNOWN_CONJUNCTION:
+            return "Unknown conjunction '" + a0 + "'. Expected '" + a1 + "'";
+        case MISSING_CONDITION:
+            return "Missing condition. Expected '" + a0 + "'";
+        case UNKNOWN_CONDITION:
+            return "Unknown condition '" + a0 + "'. Expected '" + a1 + "'";
+        case MISSING_OPERAND:
+            return "Missing operand after '" + a0 + "'";
+        case UNKNOWN_OPERAND:
+            return "Unknown operand '" + a0 + "' after '" + a1 + "'";
+        case MISSING_DESCRIPTOR:
+            return "Missing descriptor after '" + a0 + "'";
+        case UNKNOWN_DESCRIPTOR:
+            return "Unknown descriptor '" + a0 + "' after '" + a1 + "'";
+        case DUPLICATE_LABEL:
+            return "Duplicate label " + a0 + " already declared at line " + to_string(diagnostic.number);
+        case UNDEFINED_LABEL:
+            return "Undefined label " + a0;
+        case REGISTER_OUT_OF_RANGE:
+            return "Register '" + a0 + "' is out of range. Max register is r9";
+        case MEMORY_OUT_OF_RANGE:
+            return "Memory address '" + a0 + "' is out of range. Max address is m<999999999>";
+        case INSTRUCTION_OUT_OF_PROGRAM:
+            return "Instruction address '" + a0 + "' is out of range. Expected i[0]-i[" + to_string(diagnostic.number) + "]";
+        case INSTRUCTION_OUT_OF_RANGE:
+            return "Instruction address '" + a0 + "' is out of range. Max address is i[999999999]";
+        case UNRECOGNIZED_OPERAND: {
+            string text = "Unrecognized operand '" + a0 + "'. Expected ";
+            //Add all possible expected operands
+            bool first = true;
+            for (int type = 0; type < ASTConstants::EMPTY; type++) {
+                if ((diagnostic.expected & (1u << type)) != 0) {
+                    if (!first) {
+                        text += " or ";
+                    }
+                    text += operandDescription(static_cast<ASTConstants::OperandType>(type));
+                    first = false;
+                }
+            }
+            return text;
+        }
+        case UNEXPECTED_OPERAND:
+            return "Unexpected extra operand '" + a0 + "'";
+        case UNEXPECTED_TYPE:
+            if (diagnostic.number == 1 << RuntimeConstants::UNDEFINED) {
+                return "Always fails at runtime, " + a0 + " has no value here";
+            }
+            return "Always fails at runtime, " + a0 + " holds " + typeDescription(diagnostic.number) + " here, never " +
+                   typeDescription(diagnostic.expected);
+        case MISMATCHED_TYPES:
+            return "Always fails at runtime, " + a0 + " (" + typeDescription(diagnostic.number & 0xFF) + ") and " + a1 +
+                   " (" + typeDescription(diagnostic.number >> 8) + ") never hold the same type here";
+        case BACKEND_UNAVAILABLE:
+            return "Code generation failed. The LLVM backend could not be loaded: " + a0;
+        case INVALID_IR:
+            return "Code generation failed. The generated IR is invalid.";
+        case EMIT_FAILED:
+            return "Code generation failed. The output could not be written: " + a0;
+        case JIT_FAILED:
+            return "Execution failed. The program could not be JIT compiled: " + a0;
+        default:
+            return "Unknown error";
+    }
+}
+
+void DiagnosticEngine::setTokenSpan(Diagnostic& diagnostic, std::string_view line, int tokenIndex) {
+    size_t position = 0;
+    for (int token = 0; position < line.size(); token++) {
+        //Skip leading whitespace
+        while (position < line.size() && isspace(static_cast<unsigned char>(line[position]))) {
+            position++;
+        }
+        size_t end = position;
+        while (end < line.size() && !isspace(static_cast<unsigned char>(line[end]))) {
+            end++;
+        }
+        if (token == tokenIndex && end > position) {
+            diagnostic.column = static_cast<int>(position);
+            diagnostic.length = static_cast<int>(end - position);
+            return;
+        }
+        position = end;
+    }
+}
+
+void DiagnosticEngine::setTextSpan(Diagnostic& diagnostic, std::string_view line, std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+    //Operands always follow the instruction keyword, so skip it to avoid matching e.g. 'r' in "or"
+    size_t start = line.find_first_not_of(" \t\r\f\v");
+    start = start == string_view::npos ? 0 : line.find_first_of(" \t\r\f\v", start);
+    size_t position = line.find(text, start == string_view::npos ? 0 : start);
+    if (position != string_view::npos) {
+        diagnostic.column = static_cast<int>(position);
+        diagnostic.length = static_cast<int>(text.size());
+    }
+}
+
+string DiagnosticEngine::formatText(const vector<Diagnostic>& diagnostics, const SourceBuffer* source) const {
+    string output;
+    for (size_t i = 0; i < diagnostics.size(); i++) {
+        const Diagnostic& diagnostic = diagnostics[i];
+        if (diagnostic.line == NO_LINE) {
+            output += message(diagnostic);
+            continue;
+        }
+        //Semantic errors group every operand of a line under a single header
+        if (diagnostic.phase == SEMANTICS) {
+            if (i == 0 || diagnostics[i-1].phase != SEMANTICS || diagnostics[i-1].line != diagnostic.line) {
+                appendHeader(output, diagnostic, source);
+            }
+            output += message(diagnostic);
+            output += "\n\n";
+        }
+        else {
+            appendHeader(output, diagnostic, source);
+            output += message(diagnostic);
+            output += '\n';
+        }
+    }
+    if (full()) {
+        output += "\nToo many errors, stopped after " + to_string(m_maxErrors) + " (--max-errors)\n";
+    }
+    return output;
+}
+
+string DiagnosticEngine::formatJson(const vector<Diagnostic>& diagnostics, const SourceBuffer* source) const {
+    nlohmann::json jsonDiagnostics = nlohmann::json::array();
+    for (const auto& diagnostic : diagnostics) {
+        nlohmann::json jsonDiagnostic;
+        jsonDiagnostic["phase"] = phaseName(diagnostic.phase);
+        jsonDiagnostic["code"] = codeName(diagnostic.code);
+        jsonDiagnostic["severity"] = isWarning(diagnostic) ? "warning" : "error";
+        jsonDiagnostic["line"] = diagnostic.line;
+        jsonDiagnostic["column"] = diagnostic.column;
+        jsonDiagnostic["length"] = diagnostic.length;
+        jsonDiagnostic["message"] = message(diagnostic);
+        if (source != nullptr && diagnostic.line > 0 && diagnostic.line <= source->numLines()) {
+            jsonDiagnostic["source"] = string(source->line(diagnostic.line - 1));
+        }
+        jsonDiagnostics.push_back(std::move(jsonDiagnostic));
+    }
+    return jsonDiagnostics.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
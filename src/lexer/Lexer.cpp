@@ -1,143 +1,172 @@
 #include "lexer/Lexer.h"
+#include "parallel/TaskScheduler.h"
 
-#include <fstream>
-#include <regex>
 #include <string>
-#include <functional>
+#include <string_view>
+#include <algorithm>
 #include <utility>
-#include <sstream>
 
 using namespace std;
 using namespace LexerConstants;
 
-//Constructor
-Lexer::Lexer() : m_stringTemplate("^\".*\"$") {
-    //Reserve space for the token dictionary
-    m_tokenDictionary.reserve(39); //Total number of tokens being added
-
-    //Add instructions to dictionary
-    m_tokenDictionary["move"] = INSTRUCTION;
-    m_tokenDictionary["load"] = INSTRUCTION;
-    m_tokenDictionary["store"] = INSTRUCTION;
-    m_tokenDictionary["create"] = INSTRUCTION;
-    m_tokenDictionary["cast"] = INSTRUCTION;
-    m_tokenDictionary["add"] = INSTRUCTION;
-    m_tokenDictionary["sub"] = INSTRUCTION;
-    m_tokenDictionary["multiply"] = INSTRUCTION;
-    m_tokenDictionary["divide"] = INSTRUCTION;
-    m_tokenDictionary["or"] = INSTRUCTION;
-    m_tokenDictionary["and"] = INSTRUCTION;
-    m_tokenDictionary["not"] = INSTRUCTION;
-    m_tokenDictionary["shift"] = INSTRUCTION;
-    m_tokenDictionary["compare"] = INSTRUCTION;
-    m_tokenDictionary["jump"] = INSTRUCTION;
-    m_tokenDictionary["call"] = INSTRUCTION;
-    m_tokenDictionary["push"] = INSTRUCTION;
-    m_tokenDictionary["pop"] = INSTRUCTION;
-    m_tokenDictionary["return"] = INSTRUCTION;
-    m_tokenDictionary["stop"] = INSTRUCTION;
-    m_tokenDictionary["input"] = INSTRUCTION;
-    m_tokenDictionary["output"] = INSTRUCTION;
-    m_tokenDictionary["print"] = INSTRUCTION;
-    m_tokenDictionary["label"] = INSTRUCTION;
-
-    //Add conjunctions to dictionary
-    m_tokenDictionary["from"] = CONJUNCTION;
-    m_tokenDictionary["with"] = CONJUNCTION;
-    m_tokenDictionary["self"] = CONJUNCTION;
-    m_tokenDictionary["to"] = CONJUNCTION;
-    m_tokenDictionary["by"] = CONJUNCTION;
-    m_tokenDictionary["if"] = CONJUNCTION;
-
-    //Add conditions to dictionary
-    m_tokenDictionary["left"] = SHIFTCONDITION;
-    m_tokenDictionary["right"] = SHIFTCONDITION;
-    m_tokenDictionary["greater"] = JUMPCONDITION;
-    m_tokenDictionary["less"] = JUMPCONDITION;
-    m_tokenDictionary["equal"] = JUMPCONDITION;
-    m_tokenDictionary["unequal"] = JUMPCONDITION;
-    m_tokenDictionary["zero"] = JUMPCONDITION;
-    m_tokenDictionary["nonzero"] = JUMPCONDITION;
-    m_tokenDictionary["unconditional"] = JUMPCONDITION;
-    m_tokenDictionary["integer"] = TYPECONDITION;
-    m_tokenDictionary["float"] = TYPECONDITION;
-    m_tokenDictionary["boolean"] = TYPECONDITION;
-    m_tokenDictionary["character"] = TYPECONDITION;
-    m_tokenDictionary["memory"] = TYPECONDITION;
-    m_tokenDictionary["instruction"] = TYPECONDITION;
-
-    //Reserve space for the operand dictionary
-    m_operandDictionary.reserve(8); //Total number of regex templates being added
-
-    //Add operand regex templates to vector
-    m_operandDictionary.emplace_back(regex("r[0-9]+"), REGISTER);
-    m_operandDictionary.emplace_back(regex("m<[0-9]+>"), MEMORYADDRESS);
-    m_operandDictionary.emplace_back(regex("i\\[[0-9]+\\]"), INSTRUCTIONADDRESS);
-    m_operandDictionary.emplace_back(regex("-?[1-9][0-9]{0,9}|0"), INTEGER);
-    m_operandDictionary.emplace_back(regex("-?\\d+\\.\\d+"), FLOAT);
-    m_operandDictionary.emplace_back(regex("true|false|1|0"), BOOLEAN);
-    m_operandDictionary.emplace_back(regex("."), CHARACTER);
-    m_operandDictionary.emplace_back(regex("'([^']+)'"), LABEL);
-}
+namespace {
+    //Keyword table (instructions, conjunctions and conditions), sorted for binary search
+    //NOTE - comment and print are not listed, as their operand is the rest of the line and they are handled separately
+    constexpr pair<string_view, TokenType> KEYWORDS[] = {
+        {"add", INSTRUCTION}, {"and", INSTRUCTION}, {"boolean", TYPECONDITION}, {"by", CONJUNCTION},
+        {"call", INSTRUCTION}, {"cast", INSTRUCTION}, {"character", TYPECONDITION}, {"compare", INSTRUCTION},
+        {"create", INSTRUCTION}, {"divide", INSTRUCTION}, {"equal", JUMPCONDITION}, {"float", TYPECONDITION},
+        {"from", CONJUNCTION}, {"greater", JUMPCONDITION}, {"if", CONJUNCTION}, {"input", INSTRUCTION},
+        {"instruction", TYPECONDITION}, {"integer", TYPECONDITION}, {"jump", INSTRUCTION}, {"label", INSTRUCTION},
+        {"left", SHIFTCONDITION}, {"less", JUMPCONDITION}, {"load", INSTRUCTION}, {"memory", TYPECONDITION},
+        {"move", INSTRUCTION}, {"multiply", INSTRUCTION}, {"nonzero", JUMPCONDITION}, {"not", INSTRUCTION},
+        {"or", INSTRUCTION}, {"output", INSTRUCTION}, {"pop", INSTRUCTION}, {"push", INSTRUCTION},
+        {"return", INSTRUCTION}, {"right", SHIFTCONDITION}, {"self", CONJUNCTION}, {"shift", INSTRUCTION},
+        {"stop", INSTRUCTION}, {"store", INSTRUCTION}, {"sub", INSTRUCTION}, {"to", CONJUNCTION},
+        {"unconditional", JUMPCONDITION}, {"unequal", JUMPCONDITION}, {"with", CONJUNCTION}, {"zero", JUMPCONDITION},
+    };
+
+    constexpr bool keywordsSorted() {
+        for (size_t i = 1; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); i++) {
+            if (!(KEYWORDS[i - 1].first < KEYWORDS[i].first)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(keywordsSorted(), "Lexer keyword table must stay sorted");
 
+    //Whitespace as separated by stream extraction in the C locale
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
 
-//Main lexer method
-bool Lexer::lexFile(const std::string& filename, std::vector<std::string>& codeLines, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>& tokenizedCode) {
-    //Read the file
-    if (!readFile(filename, codeLines)) {
-        return false;
+    //True for a non-empty run of decimal digits
+    bool isDigits(string_view text) {
+        return !text.empty() && all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
     }
-    //Tokenize the file
-    tokenizeFile(codeLines, tokenizedCode);
-    return true;
-}
 
-bool Lexer::readFile(const string& filename, vector<string>& codeLines) {
-    // Create a file stream and open the file
-    ifstream file(filename);
-    // If file is not open, return false
-    if (!file.is_open()) {
-        return false;
+    //Operand matchers, each accepting exactly the whole token (equivalent to the former regex templates)
+    //r[0-9]+
+    bool isRegister(string_view token) {
+        return token.size() > 1 && token[0] == 'r' && isDigits(token.substr(1));
+    }
+    //m<[0-9]+>
+    bool isMemoryAddress(string_view token) {
+        return token.size() > 3 && token[0] == 'm' && token[1] == '<' && token.back() == '>' && isDigits(token.substr(2, token.size() - 3));
     }
-    // Temporary string to hold the line
-    string line;
-    // Loop through every line in the file
-    while (getline(file, line)) {
-        // Check if the line is not just whitespace
-        if (line.find_first_not_of(" \t\n\r\f\v") != string::npos) {
-            // Push back the line into the vector
-            codeLines.push_back(line);
+    //i\[[0-9]+\]
+    bool isInstructionAddress(string_view token) {
+        return token.size() > 3 && token[0] == 'i' && token[1] == '[' && token.back() == ']' && isDigits(token.substr(2, token.size() - 3));
+    }
+    //-?[1-9][0-9]{0,9}|0
+    bool isInteger(string_view token) {
+        if (token == "0") {
+            return true;
+        }
+        if (!token.empty() && token[0] == '-') {
+            token.remove_prefix(1);
+        }
+        return token.size() <= 10 && isDigits(token) && token[0] != '0';
+    }
+    //-?\d+\.\d+
+    bool isFloat(string_view token) {
+        if (!token.empty() && token[0] == '-') {
+            token.remove_prefix(1);
         }
+        size_t point = token.find('.');
+        return point != string_view::npos && isDigits(token.substr(0, point)) && isDigits(token.substr(point + 1));
+    }
+    //true|false|1|0
+    bool isBoolean(string_view token) {
+        return token == "true" || token == "false" || token == "1" || token == "0";
+    }
+    //Any single character
+    bool isCharacter(string_view token) {
+        return token.size() == 1 && token[0] != '\n' && token[0] != '\r';
     }
-    // Close the file
-    file.close();
-    // Return true
+    //'([^']+)'
+    bool isLabel(string_view token) {
+        return token.size() > 2 && token.front() == '\'' && token.back() == '\'' && token.substr(1, token.size() - 2).find('\'') == string_view::npos;
+    }
+    //^".*"$
+    bool isString(string_view text) {
+        return text.size() > 1 && text.front() == '"' && text.back() == '"' && text.find_first_of("\r\n") == string_view::npos;
+    }
+
+    //Operand matchers in priority order - the first match decides the token type
+    constexpr pair<bool (*)(string_view), TokenType> OPERANDS[] = {
+        {isRegister, REGISTER},
+        {isMemoryAddress, MEMORYADDRESS},
+        {isInstructionAddress, INSTRUCTIONADDRESS},
+        {isInteger, INTEGER},
+        {isFloat, FLOAT},
+        {isBoolean, BOOLEAN},
+        {isCharacter, CHARACTER},
+        {isLabel, LABEL},
+    };
+}
+
+
+//Main lexer method
+bool Lexer::lexFile(const std::string& filename, std::shared_ptr<const SourceBuffer>& source, std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>& tokenizedCode) {
+    //Read the file into a shared source buffer, unless it was already loaded (for a cache lookup)
+    if (source == nullptr) {
+        source = SourceBuffer::fromFile(filename);
+    }
+    if (source == nullptr) {
+        return false;
+    }
+    //Tokenize the file
+    tokenizeFile(*source, tokenizedCode);
     return true;
 }
 
 //Tokenize file method
-void Lexer::tokenizeFile(vector<string>& codeLines, vector<vector<pair<string, TokenType>>>& tokenizedCode) {
-    //Preallocate depending on the number of lines to allow sequential write
-    std::vector<std::vector<std::pair<string, LexerConstants::TokenType>>> tempTokens(codeLines.size());
+void Lexer::tokenizeFile(const SourceBuffer& source, vector<vector<pair<string, TokenType>>>& tokenizedCode) {
+    //Preallocate depending on the number of lines to allow each thread to write its own slot
+    int numLines = source.numLines();
+    tokenizedCode.resize(numLines);
 
     // Parallelize lexing of each line
-    #pragma omp parallel for schedule(auto) default(none) shared(codeLines, tempTokens)
-    for (long unsigned int i = 0; i < codeLines.size(); i++) {
-        // Each thread works on its own part of the vector
-        tempTokens[i] = tokenizeLine(codeLines[i]);
+    TaskScheduler::instance().parallelFor(0, numLines, [&](int begin, int end) {
+        // Each task works on its own part of the vector
+        for (int i = begin; i < end; i++) {
+            tokenizedCode[i] = tokenizeLine(source.line(i));
+        }
+    });
+}
+
+//Tokenize chunk method
+void Lexer::tokenizeLines(const SourceBuffer& source, int begin, int end, vector<vector<pair<string, TokenType>>>& tokenizedCode) {
+    //Chunks are already processed concurrently by the pipeline, so lines are tokenized sequentially
+    tokenizedCode.resize(end - begin);
+    for (int i = begin; i < end; i++) {
+        tokenizedCode[i - begin] = tokenizeLine(source.line(i));
     }
+}
 
-    // Flatten the results into m_codeTokens
-    for (const auto& lineTokens : tempTokens) {
-        tokenizedCode.push_back(lineTokens);
+//Token classification helper function
+TokenType Lexer::classifyToken(string_view token) {
+    //Attempt to find the token in the keyword table (instructions, conjunctions, descriptors, conditions)
+    auto itr = lower_bound(begin(KEYWORDS), end(KEYWORDS), token, [](const pair<string_view, TokenType>& entry, string_view value) {
+        return entry.first < value;
+    });
+    if (itr != end(KEYWORDS) && itr->first == token) {
+        return itr->second;
+    }
+    //If not, check if it is an operand, trying every matcher in order
+    for (auto& operand : OPERANDS) {
+        if (operand.first(token)) {
+            return operand.second;
+        }
     }
+    //If not either, it is unknown
+    return UNKNOWN;
 }
 
 //Tokenize line helper function
-vector<pair<string, TokenType>> Lexer::tokenizeLine(string& line) {
-    //Create a string stream for the line, a temporary token string, and the return vector
-    stringstream ss(line);
-    string token;
+vector<pair<string, TokenType>> Lexer::tokenizeLine(string_view line) {
     vector<pair<string, TokenType>> tokenizedLine;
 
     //Zero case, return instantly
@@ -146,23 +175,34 @@ vector<pair<string, TokenType>> Lexer::tokenizeLine(string& line) {
         return tokenizedLine;
     }
 
-    //Loop through every token
-    while (ss >> token) {
+    //Loop through every whitespace separated token
+    size_t position = 0;
+    while (true) {
+        while (position < line.size() && isSpace(line[position])) {
+            position++;
+        }
+        if (position == line.size()) {
+            break;
+        }
+        size_t tokenEnd = position;
+        while (tokenEnd < line.size() && !isSpace(line[tokenEnd])) {
+            tokenEnd++;
+        }
+        string_view token = line.substr(position, tokenEnd - position);
+        position = tokenEnd;
+
         //Special case for comments and prints. These are the only instructions not separating operands by whitespace alone
         if (token == "comment" || token == "print") {
             //Push back string as an instruction
             tokenizedLine.emplace_back(token, INSTRUCTION);
-            //Temporary string to hold the comment and a regex template to check for validity
-            string operandString;
-            //Get rest of the line
-            getline(ss, operandString);
-            operandString.erase(0, 1);
+            //The operand is the rest of the line, past the single separating character
+            string_view operandString = line.substr(min(position + 1, line.size()));
             //First we need to determine if the next token is a newline - special case
             if (operandString == "newline") {
                 tokenizedLine.emplace_back(operandString, NEWLINE);
             }
-            //If matching regex template, denote string as "string"
-            else if (regex_match(operandString, m_stringTemplate)) {
+            //If quoted, denote string as "string"
+            else if (isString(operandString)) {
                 tokenizedLine.emplace_back(operandString, STRING);
             }
             //Denote string unknown otherwise
@@ -172,32 +212,8 @@ vector<pair<string, TokenType>> Lexer::tokenizeLine(string& line) {
             //Return vector instantly
             return tokenizedLine;
         }
-        //Case for not comments and strings (everything else)
-        else {
-            //Attempt to find the token in the dictionary
-            auto itr = m_tokenDictionary.find(token);
-            //If found in the token dictionary (instructions, conjunctions, descriptors, conditions) push it back
-            if (itr != m_tokenDictionary.end()) {
-                tokenizedLine.emplace_back(token, itr->second);
-            }
-            //If not, check if it is an operand using regex
-            else {
-                int i;
-                //Loop through vector of operand regex templates, checking every one
-                for (i=0; i<m_operandDictionary.size(); i++) {
-                    if (regex_match(token, m_operandDictionary[i].first)) {
-                        //If matching, push with corresponding operand type
-                        tokenizedLine.emplace_back(token, m_operandDictionary[i].second);
-                        break;
-                    }
-                }
-                if (i == m_operandDictionary.size()) {
-                    //If not either, push as unknown
-                    tokenizedLine.emplace_back(token, UNKNOWN);
-                }
-            }
-        }
+        tokenizedLine.emplace_back(token, classifyToken(token));
     }
-    
+
     return tokenizedLine;
-}
\ No newline at end of file
+}
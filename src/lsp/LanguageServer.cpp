@@ -0,0 +1,519 @@
+#include "lsp/LanguageServer.h"
+#include "lexer/Lexer.h"
+
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+    //Whitespace separating tokens, as in the lexer
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    //Token of a line with its byte span
+    struct Token {
+        string text;
+        LexerConstants::TokenType type;
+        size_t begin;
+        size_t end;
+    };
+
+    //Tokenize a line with the lexer and locate every token in it
+    vector<Token> tokenize(string_view line) {
+        vector<Token> tokens;
+        size_t position = 0;
+        bool restOfLine = false;
+        for (auto& token : Lexer::tokenizeLine(line)) {
+            if (token.second == LexerConstants::BLANK) {
+                break;
+            }
+            size_t begin;
+            size_t end;
+            //The operand of comment and print is the rest of the line, past the single separating character
+            if (restOfLine) {
+                begin = min(position + 1, line.size());
+                end = line.size();
+            }
+            else {
+                while (position < line.size() && isSpace(line[position])) {
+                    position++;
+                }
+                begin = position;
+                end = begin + token.first.size();
+            }
+            position = end;
+            restOfLine = token.second == LexerConstants::INSTRUCTION && (token.first == "comment" || token.first == "print");
+            tokens.push_back({std::move(token.first), token.second, begin, end});
+        }
+        return tokens;
+    }
+
+    //Token touching a byte column (a cursor right after a token still selects it)
+    const Token* tokenAt(const vector<Token>& tokens, size_t column) {
+        for (const Token& token : tokens) {
+            if (column >= token.begin && column <= token.end) {
+                return &token;
+            }
+        }
+        return nullptr;
+    }
+
+    const char* tokenDescription(LexerConstants::TokenType type) {
+        switch (type) {
+            case LexerConstants::INSTRUCTION: return "instruction";
+            case LexerConstants::CONJUNCTION: return "conjunction";
+            case LexerConstants::JUMPCONDITION: return "jump condition";
+            case LexerConstants::TYPECONDITION: return "type condition";
+            case LexerConstants::SHIFTCONDITION: return "shift condition";
+            case LexerConstants::REGISTER: return "register";
+            case LexerConstants::INSTRUCTIONADDRESS: return "instruction address";
+            case LexerConstants::MEMORYADDRESS: return "memory address";
+            case LexerConstants::INTEGER: return "integer";
+            case LexerConstants::FLOAT: return "float";
+            case LexerConstants::BOOLEAN: return "boolean";
+            case LexerConstants::CHARACTER: return "character";
+            case LexerConstants::LABEL: return "label";
+            case LexerConstants::STRING: return "string";
+            case LexerConstants::NEWLINE: return "newline";
+            default: return "unknown token";
+        }
+    }
+
+    //1-based code line an i[N] operand refers to, 0 if it is past any program
+    int addressLine(const string& address) {
+        long long index = 0;
+        for (size_t k = 2; k + 1 < address.size(); k++) {
+            index = index * 10 + (address[k] - '0');
+            if (index > INT32_MAX) {
+                return 0;
+            }
+        }
+        return static_cast<int>(index);
+    }
+
+    //Split replacement text into lines the way documents are split
+    vector<string> splitLines(string_view text) {
+        vector<string> lines;
+        size_t start = 0;
+        while (true) {
+            size_t end = text.find('\n', start);
+            if (end == string_view::npos) {
+                lines.emplace_back(text.substr(start));
+                return lines;
+            }
+            lines.emplace_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+}
+
+LanguageServer::LanguageServer(int maxErrors) : m_maxErrors(maxErrors > 0 ? maxErrors : 0) {}
+
+int LanguageServer::run() {
+    string content;
+    while (!m_exit && readMessage(content)) {
+        json message = json::parse(content, nullptr, false);
+        if (message.is_discarded() || !message.is_object()) {
+            respondError(nullptr, LspConstants::PARSE_ERROR, "Invalid JSON-RPC message");
+            continue;
+        }
+        handle(message);
+        //Publish only once the editor has stopped sending, so a burst of keystrokes is analyzed but published once
+        if (!inputPending()) {
+            for (auto& entry : m_documents) {
+                if (entry.second.dirty) {
+                    publishDiagnostics(entry.first, entry.second);
+                }
+            }
+        }
+    }
+    //Exiting without a shutdown request (or losing the editor) is an error
+    return m_exit && m_shutdown ? 0 : 1;
+}
+
+bool LanguageServer::readMessage(string& content) {
+    while (true) {
+        //Headers end with an empty line, Content-Length is the only one that matters
+        size_t headerEnd = m_input.find("\r\n\r\n", m_inputPosition);
+        if (headerEnd != string::npos) {
+            long long length = -1;
+            size_t position = m_inputPosition;
+            while (position < headerEnd) {
+                size_t lineEnd = m_input.find("\r\n", position);
+                string header = m_input.substr(position, lineEnd - position);
+                string name = header.substr(0, header.find(':'));
+                transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+                if (name == "content-length" && header.size() > name.size()) {
+                    length = strtoll(header.c_str() + name.size() + 1, nullptr, 10);
+                }
+                position = lineEnd + 2;
+            }
+            if (length < 0) {
+                //Skip a message without a length, there is no way to know where it ends
+                m_inputPosition = headerEnd + 4;
+                continue;
+            }
+            size_t bodyStart = headerEnd + 4;
+            if (m_input.size() - bodyStart >= static_cast<size_t>(length)) {
+                content.assign(m_input, bodyStart, length);
+                m_inputPosition = bodyStart + length;
+                //Drop consumed input once it makes up most of the buffer
+                if (m_inputPosition > m_input.size() / 2) {
+                    m_input.erase(0, m_inputPosition);
+                    m_inputPosition = 0;
+                }
+                return true;
+            }
+        }
+        char buffer[LspConstants::READ_SIZE];
+        ssize_t count = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        m_input.append(buffer, count);
+    }
+}
+
+bool LanguageServer::inputPending() const {
+    if (m_inputPosition < m_input.size()) {
+        return true;
+    }
+    pollfd input{STDIN_FILENO, POLLIN, 0};
+    return poll(&input, 1, 0) > 0;
+}
+
+void LanguageServer::send(const json& message) const {
+    string body = message.dump(-1, ' ', false, json::error_handler_t::replace);
+    cout << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    cout.flush();
+}
+
+void LanguageServer::respond(const json& id, json result) const {
+    send({{"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+}
+
+void LanguageServer::respondError(const json& id, int code, const string& message) const {
+    send({{"jsonrpc", "2.0"}, {"id", id}, {"error", {{"code", code}, {"message", message}}}});
+}
+
+void LanguageServer::handle(const json& message) {
+    string method = message.value("method", "");
+    bool request = message.contains("id");
+    json id = request ? message["id"] : json(nullptr);
+    json params = message.value("params", json::object());
+    try {
+        if (method == "exit") {
+            m_exit = true;
+        }
+        else if (m_shutdown && request) {
+            respondError(id, LspConstants::INVALID_REQUEST, "Server is shutting down");
+        }
+        else if (method == "initialize") {
+            respond(id, initialize(params));
+        }
+        else if (method == "shutdown") {
+            m_shutdown = true;
+            respond(id, nullptr);
+        }
+        else if (method == "textDocument/didOpen") {
+            didOpen(params);
+        }
+        else if (method == "textDocument/didChange") {
+            didChange(params);
+        }
+        else if (method == "textDocument/didClose") {
+            didClose(params);
+        }
+        else if (method == "textDocument/definition") {
+            respond(id, definition(params));
+        }
+        else if (method == "textDocument/references") {
+            respond(id, references(params));
+        }
+        else if (method == "textDocument/hover") {
+            respond(id, hover(params));
+        }
+        else if (request) {
+            respondError(id, LspConstants::METHOD_NOT_FOUND, "Unsupported method " + method);
+        }
+        //Other notifications (initialized, didSave, $/cancelRequest...) need no action
+    }
+    catch (const json::exception& exception) {
+        if (request) {
+            respondError(id, LspConstants::INVALID_PARAMS, exception.what());
+        }
+    }
+}
+
+json LanguageServer::initialize(const json& params) {
+    //Byte columns avoid converting every position, so use them whenever the client accepts them
+    json encodings = params.value("capabilities", json::object()).value("general", json::object()).value("positionEncodings", json::array());
+    m_utf8 = find(encodings.begin(), encodings.end(), "utf-8") != encodings.end();
+    return {
+        {"capabilities", {
+            {"positionEncoding", m_utf8 ? "utf-8" : "utf-16"},
+            //Incremental synchronization - only the edited ranges are sent
+            {"textDocumentSync", {{"openClose", true}, {"change", 2}}},
+            {"definitionProvider", true},
+            {"referencesProvider", true},
+            {"hoverProvider", true}
+        }},
+        {"serverInfo", {{"name", "startasm"}}}
+    };
+}
+
+void LanguageServer::didOpen(const json& params) {
+    const json& item = params.at("textDocument");
+    Document& document = m_documents[item.at("uri").get<string>()];
+    document.session = std::make_unique<CompilationSession>(m_maxErrors);
+    document.session->open(item.at("text").get<string>());
+    document.version = item.value("version", 0);
+    document.dirty = true;
+}
+
+void LanguageServer::didChange(const json& params) {
+    const json& item = params.at("textDocument");
+    auto itr = m_documents.find(item.at("uri").get<string>());
+    if (itr == m_documents.end()) {
+        return;
+    }
+    Document& document = itr->second;
+    CompilationSession& session = *document.session;
+    for (const json& change : params.at("contentChanges")) {
+        const string& text = change.at("text").get_ref<const string&>();
+        if (!change.contains("range")) {
+            session.open(text);
+            continue;
+        }
+        //Turn the character range into whole lines - the edited lines keep their text outside of the range
+        const json& start = change["range"].at("start");
+        const json& end = change["range"].at("end");
+        int lastLine = session.numLines() - 1;
+        int startLine = start.at("line").get<int>();
+        int endLine = end.at("line").get<int>();
+        size_t startByte = startLine > lastLine ? session.line(lastLine).size() : toByte(session.line(max(startLine, 0)), start.at("character").get<int>());
+        size_t endByte = endLine > lastLine ? session.line(lastLine).size() : toByte(session.line(max(endLine, 0)), end.at("character").get<int>());
+        startLine = clamp(startLine, 0, lastLine);
+        endLine = clamp(endLine, startLine, lastLine);
+        string replacement(session.line(startLine).substr(0, startByte));
+        replacement += text;
+        replacement += session.line(endLine).substr(min(endByte, session.line(endLine).size()));
+        session.edit(startLine, endLine + 1, splitLines(replacement));
+    }
+    document.version = item.value("version", document.version);
+    document.dirty = true;
+}
+
+void LanguageServer::didClose(const json& params) {
+    string uri = params.at("textDocument").at("uri").get<string>();
+    m_documents.erase(uri);
+    //Clear whatever was published for the document
+    send({{"jsonrpc", "2.0"}, {"method", "textDocument/publishDiagnostics"}, {"params", {{"uri", uri}, {"diagnostics", json::array()}}}});
+}
+
+json LanguageServer::definition(const json& params) const {
+    const Document* document = findDocument(params);
+    if (document == nullptr) {
+        return nullptr;
+    }
+    const CompilationSession& session = *document->session;
+    int line = params.at("position").at("line").get<int>();
+    if (line < 0 || line >= session.numLines()) {
+        return nullptr;
+    }
+    vector<Token> tokens = tokenize(session.line(line));
+    const Token* token = tokenAt(tokens, toByte(session.line(line), params["position"].at("character").get<int>()));
+    if (token == nullptr) {
+        return nullptr;
+    }
+    const string& uri = params["textDocument"]["uri"].get_ref<const string&>();
+    //Labels go to the declaration their uses bind to
+    if (token->type == LexerConstants::LABEL) {
+        vector<int> declarations = session.labelDeclarations(token->text);
+        if (declarations.empty()) {
+            return nullptr;
+        }
+        int target = declarations.front();
+        for (const Token& declared : tokenize(session.line(target))) {
+            if (declared.type == LexerConstants::LABEL && declared.text == token->text) {
+                return {{"uri", uri}, {"range", range(session, target, declared.begin, declared.end)}};
+            }
+        }
+        return {{"uri", uri}, {"range", range(session, target, 0, 0)}};
+    }
+    //Instruction addresses go to the code line they name
+    if (token->type == LexerConstants::INSTRUCTIONADDRESS) {
+        int codeLine = addressLine(token->text);
+        if (codeLine < 1 || codeLine > session.numCodeLines()) {
+            return nullptr;
+        }
+        int target = session.fileLine(codeLine - 1);
+        return {{"uri", uri}, {"range", range(session, target, 0, session.line(target).size())}};
+    }
+    return nullptr;
+}
+
+json LanguageServer::references(const json& params) const {
+    const Document* document = findDocument(params);
+    if (document == nullptr) {
+        return nullptr;
+    }
+    const CompilationSession& session = *document->session;
+    int line = params.at("position").at("line").get<int>();
+    if (line < 0 || line >= session.numLines()) {
+        return nullptr;
+    }
+    vector<Token> tokens = tokenize(session.line(line));
+    const Token* token = tokenAt(tokens, toByte(session.line(line), params["position"].at("character").get<int>()));
+    if (token == nullptr || token->type != LexerConstants::LABEL) {
+        return nullptr;
+    }
+    //Only the lines declaring or using the label are looked at
+    vector<int> lines = session.labelUses(token->text);
+    if (params.value("context", json::object()).value("includeDeclaration", true)) {
+        vector<int> declarations = session.labelDeclarations(token->text);
+        lines.insert(lines.end(), declarations.begin(), declarations.end());
+        sort(lines.begin(), lines.end());
+        lines.erase(unique(lines.begin(), lines.end()), lines.end());
+    }
+    const string& uri = params["textDocument"]["uri"].get_ref<const string&>();
+    json locations = json::array();
+    for (int target : lines) {
+        for (const Token& reference : tokenize(session.line(target))) {
+            if (reference.type == LexerConstants::LABEL && reference.text == token->text) {
+                locations.push_back({{"uri", uri}, {"range", range(session, target, reference.begin, reference.end)}});
+            }
+        }
+    }
+    return locations;
+}
+
+json LanguageServer::hover(const json& params) const {
+    const Document* document = findDocument(params);
+    if (document == nullptr) {
+        return nullptr;
+    }
+    const CompilationSession& session = *document->session;
+    int line = params.at("position").at("line").get<int>();
+    if (line < 0 || line >= session.numLines()) {
+        return nullptr;
+    }
+    vector<Token> tokens = tokenize(session.line(line));
+    const Token* token = tokenAt(tokens, toByte(session.line(line), params["position"].at("character").get<int>()));
+    if (token == nullptr) {
+        return nullptr;
+    }
+    //Operand type as classified by the lexer, plus what labels and addresses refer to
+    string contents = "**" + string(tokenDescription(token->type)) + "** `" + token->text + "`";
+    if (token->type == LexerConstants::REGISTER && token->text.size() != 2) {
+        contents += "\n\nOut of range, registers are r0-r9";
+    }
+    else if (token->type == LexerConstants::LABEL) {
+        vector<int> declarations = session.labelDeclarations(token->text);
+        if (declarations.empty()) {
+            contents += "\n\nUndefined label";
+        }
+        else {
+            contents += "\n\nDeclared at instruction i[" + to_string(session.codeLine(declarations.front()) + 1) + "]";
+        }
+    }
+    else if (token->type == LexerConstants::INSTRUCTIONADDRESS) {
+        int codeLine = addressLine(token->text);
+        if (codeLine >= 1 && codeLine <= session.numCodeLines()) {
+            contents += "\n\n```\n" + string(session.line(session.fileLine(codeLine - 1))) + "\n```";
+        }
+        else {
+            contents += "\n\nPast the end of the program (" + to_string(session.numCodeLines()) + " instructions)";
+        }
+    }
+    return {
+        {"contents", {{"kind", "markdown"}, {"value", contents}}},
+        {"range", range(session, line, token->begin, token->end)}
+    };
+}
+
+void LanguageServer::publishDiagnostics(const string& uri, Document& document) const {
+    const CompilationSession& session = *document.session;
+    json diagnostics = json::array();
+    for (const Diagnostic& diagnostic : session.diagnostics()) {
+        //Diagnostics are numbered in code lines, which skip blank lines
+        int line = diagnostic.line > 0 && diagnostic.line <= session.numCodeLines() ? session.fileLine(diagnostic.line - 1) : 0;
+        size_t begin = 0;
+        size_t end = session.line(line).size();
+        if (diagnostic.column != DiagnosticConstants::NO_COLUMN) {
+            begin = diagnostic.column;
+            end = begin + diagnostic.length;
+        }
+        diagnostics.push_back({
+            {"range", range(session, line, begin, end)},
+            {"severity", 1},
+            {"source", "startasm"},
+            {"code", DiagnosticEngine::identifier(diagnostic.code)},
+            {"message", DiagnosticEngine::message(diagnostic)}
+        });
+    }
+    send({{"jsonrpc", "2.0"}, {"method", "textDocument/publishDiagnostics"}, {"params", {
+        {"uri", uri}, {"version", document.version}, {"diagnostics", std::move(diagnostics)}
+    }}});
+    document.dirty = false;
+}
+
+const LanguageServer::Document* LanguageServer::findDocument(const json& params) const {
+    auto itr = m_documents.find(params.at("textDocument").at("uri").get<string>());
+    return itr != m_documents.end() ? &itr->second : nullptr;
+}
+
+size_t LanguageServer::toByte(string_view line, int character) const {
+    if (character <= 0) {
+        return 0;
+    }
+    if (m_utf8) {
+        return min(static_cast<size_t>(character), line.size());
+    }
+    //Walk UTF-8 sequences, code points past the basic plane take two UTF-16 units
+    size_t byte = 0;
+    int units = 0;
+    while (byte < line.size() && units < character) {
+        auto lead = static_cast<unsigned char>(line[byte]);
+        size_t length = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        byte = min(byte + length, line.size());
+        units += length == 4 ? 2 : 1;
+    }
+    return byte;
+}
+
+int LanguageServer::toCharacter(string_view line, size_t byte) const {
+    byte = min(byte, line.size());
+    if (m_utf8) {
+        return static_cast<int>(byte);
+    }
+    int units = 0;
+    for (size_t i = 0; i < byte; i++) {
+        auto c = static_cast<unsigned char>(line[i]);
+        //Count lead bytes only, with one more unit for four byte sequences
+        if ((c & 0xC0) != 0x80) {
+            units += c >= 0xF0 ? 2 : 1;
+        }
+    }
+    return units;
+}
+
+json LanguageServer::range(const CompilationSession& session, int line, size_t begin, size_t end) const {
+    string_view text = session.line(line);
+    return {
+        {"start", {{"line", line}, {"character", toCharacter(text, begin)}}},
+        {"end", {{"line", line}, {"character", toCharacter(text, end)}}}
+    };
+}
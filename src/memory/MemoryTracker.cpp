@@ -0,0 +1,127 @@
+#include "memory/MemoryTracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <malloc.h>
+
+using namespace std;
+
+namespace {
+    atomic<bool> s_tracking{false};
+    //Signed, as memory allocated before tracking started may be freed while tracking
+    atomic<int64_t> s_liveBytes{0};
+    atomic<int64_t> s_peakBytes{0};
+    atomic<int64_t> s_intervalPeakBytes{0};
+
+    void raise(atomic<int64_t>& peak, int64_t value) {
+        int64_t current = peak.load(memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, memory_order_relaxed)) {}
+    }
+
+    void recordAllocation(void* pointer) {
+        if (s_tracking.load(memory_order_relaxed)) {
+            auto size = static_cast<int64_t>(malloc_usable_size(pointer));
+            int64_t live = s_liveBytes.fetch_add(size, memory_order_relaxed) + size;
+            raise(s_peakBytes, live);
+            raise(s_intervalPeakBytes, live);
+        }
+    }
+
+    void recordRelease(void* pointer) {
+        if (pointer != nullptr && s_tracking.load(memory_order_relaxed)) {
+            s_liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(pointer)), memory_order_relaxed);
+        }
+    }
+
+    size_t clamp(int64_t bytes) {
+        return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+    }
+
+    //Read a kilobyte field of /proc/self/status (current and peak resident set size come from the same snapshot source)
+    size_t statusBytes(const char* field) {
+        size_t kilobytes = 0;
+        if (FILE* status = fopen("/proc/self/status", "r")) {
+            char line[256];
+            size_t length = strlen(field);
+            while (fgets(line, sizeof(line), status) != nullptr) {
+                if (strncmp(line, field, length) == 0) {
+                    kilobytes = strtoull(line + length, nullptr, 10);
+                    break;
+                }
+            }
+            fclose(status);
+        }
+        return kilobytes * 1024;
+    }
+}
+
+//Replaced global allocation functions - the array and nothrow forms forward to these
+void* operator new(size_t size) {
+    void* pointer;
+    while ((pointer = malloc(size == 0 ? 1 : size)) == nullptr) {
+        new_handler handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+    recordAllocation(pointer);
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    recordRelease(pointer);
+    free(pointer);
+}
+
+//Sized delete is replaced alongside, as its default is not guaranteed to reach the unsized one
+void operator delete(void* pointer, size_t) noexcept {
+    recordRelease(pointer);
+    free(pointer);
+}
+
+void MemoryTracker::enable() {
+    s_tracking.store(true, memory_order_relaxed);
+}
+
+bool MemoryTracker::enabled() {
+    return s_tracking.load(memory_order_relaxed);
+}
+
+size_t MemoryTracker::liveBytes() {
+    return clamp(s_liveBytes.load(memory_order_relaxed));
+}
+
+size_t MemoryTracker::peakBytes() {
+    return clamp(s_peakBytes.load(memory_order_relaxed));
+}
+
+size_t MemoryTracker::takeIntervalPeakBytes() {
+    int64_t peak = s_intervalPeakBytes.exchange(s_liveBytes.load(memory_order_relaxed), memory_order_relaxed);
+    return clamp(peak);
+}
+
+size_t MemoryTracker::residentBytes() {
+    return statusBytes("VmRSS:");
+}
+
+size_t MemoryTracker::peakResidentBytes() {
+    return statusBytes("VmHWM:");
+}
+
+string MemoryTracker::formatBytes(size_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        unit++;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.2f %s", value, units[unit]);
+    return text;
+}
@@ -0,0 +1,97 @@
+#include "parallel/CostModel.h"
+#include "parallel/TaskScheduler.h"
+#include "cache/CompileCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+void CostModel::calibrate(const std::function<std::pair<double, double>()>& measure) {
+    if (loadCache()) {
+        return;
+    }
+    auto overheads = measure();
+    m_dispatchSeconds = overheads.first;
+    m_startupSeconds = overheads.second;
+    saveCache();
+}
+
+bool CostModel::worthParallel(double serialSeconds, bool workersStarted) const {
+    if (m_jobs <= 1) {
+        return false;
+    }
+    double overhead = m_dispatchSeconds + (workersStarted ? 0.0 : m_startupSeconds);
+    double saved = serialSeconds * (1.0 - 1.0 / m_jobs);
+    //Demand a clear win - measured overheads vary from run to run
+    return saved > SchedulerConstants::OVERHEAD_MARGIN * overhead;
+}
+
+int CostModel::grainFor(double secondsPerIteration, int iterations) const {
+    //Each chunk should take several dispatch round trips, but leave enough chunks to balance the load
+    double chunkSeconds = SchedulerConstants::OVERHEAD_MARGIN * m_dispatchSeconds;
+    int grain = secondsPerIteration > 0 ? static_cast<int>(std::ceil(chunkSeconds / secondsPerIteration)) : iterations;
+    int balancedGrain = (iterations + m_jobs * SchedulerConstants::CHUNKS_PER_THREAD - 1) / (m_jobs * SchedulerConstants::CHUNKS_PER_THREAD);
+    return std::max(1, std::min(std::max(grain, balancedGrain), iterations));
+}
+
+std::string CostModel::cachePath() {
+    string directory = CompileCache::userCacheDirectory();
+    return directory.empty() ? "" : directory + "/costmodel";
+}
+
+bool CostModel::loadCache() {
+    string path = cachePath();
+    if (path.empty()) {
+        return false;
+    }
+    ifstream cache(path);
+    int jobs;
+    double dispatchSeconds, startupSeconds;
+    while (cache >> jobs >> dispatchSeconds >> startupSeconds) {
+        if (jobs == m_jobs && dispatchSeconds > 0 && startupSeconds >= 0) {
+            m_dispatchSeconds = dispatchSeconds;
+            m_startupSeconds = startupSeconds;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CostModel::saveCache() const {
+    string path = cachePath();
+    if (path.empty()) {
+        return;
+    }
+    //Keep entries for other job counts
+    stringstream entries;
+    {
+        ifstream cache(path);
+        int jobs;
+        double dispatchSeconds, startupSeconds;
+        while (cache >> jobs >> dispatchSeconds >> startupSeconds) {
+            if (jobs != m_jobs) {
+                entries << jobs << ' ' << dispatchSeconds << ' ' << startupSeconds << '\n';
+            }
+        }
+    }
+    entries << m_jobs << ' ' << m_dispatchSeconds << ' ' << m_startupSeconds << '\n';
+    //Write to a temporary file and rename, so concurrent compilers never read a partial file
+    string temporary = path + "." + to_string(getpid()) + ".tmp";
+    {
+        ofstream output(temporary, ios::trunc);
+        if (!(output << entries.str())) {
+            remove(temporary.c_str());
+            return;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,330 @@
+#include "parallel/TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+    //Requested number of jobs, 0 until configured
+    std::atomic<int> requestedJobs{0};
+    //Requested execution mode
+    std::atomic<SchedulerConstants::Parallelism> requestedParallelism{SchedulerConstants::AUTO};
+    //Index of the current thread's deque, -1 for threads outside the pool
+    thread_local int workerIndex = -1;
+
+    double now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //Read a cgroup CPU quota as a (possibly fractional) number of CPUs, 0 if unlimited or unknown
+    double cgroupCPULimit() {
+        //cgroup v2 - "quota period" or "max period", relative to the process' cgroup
+        string cgroupPath;
+        ifstream cgroupFile("/proc/self/cgroup");
+        string entry;
+        while (getline(cgroupFile, entry)) {
+            if (entry.rfind("0::", 0) == 0) {
+                cgroupPath = entry.substr(3);
+            }
+        }
+        for (const string& path : {"/sys/fs/cgroup" + cgroupPath + "/cpu.max", string("/sys/fs/cgroup/cpu.max")}) {
+            ifstream cpuMax(path);
+            string quota;
+            double period = 0;
+            if (cpuMax >> quota >> period) {
+                if (quota == "max" || period <= 0) {
+                    return 0;
+                }
+                return stod(quota) / period;
+            }
+        }
+        //cgroup v1 - quota of -1 means unlimited
+        ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        double quota = 0, period = 0;
+        if (quotaFile >> quota && periodFile >> period && quota > 0 && period > 0) {
+            return quota / period;
+        }
+        return 0;
+    }
+}
+
+//TaskGroup
+TaskScheduler::TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskScheduler::TaskGroup::run(Task task) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    if (scheduler.m_jobs == 1) {
+        task();
+        return;
+    }
+    m_pending.fetch_add(1, memory_order_relaxed);
+    scheduler.spawn(std::move(task), this);
+}
+
+void TaskScheduler::TaskGroup::wait() {
+    if (m_pending.load(memory_order_acquire) != 0) {
+        TaskScheduler::instance().waitFor(*this);
+    }
+}
+
+//Configuration
+void TaskScheduler::setJobs(int jobs) {
+    requestedJobs = jobs;
+}
+
+void TaskScheduler::setParallelism(SchedulerConstants::Parallelism parallelism) {
+    requestedParallelism = parallelism;
+}
+
+int TaskScheduler::getJobs() {
+    return instance().m_jobs;
+}
+
+int TaskScheduler::defaultJobs() {
+    int cpus = static_cast<int>(std::thread::hardware_concurrency());
+#ifdef __linux__
+    //Pinned processes may only run on their affinity mask
+    cpu_set_t cpuSet;
+    if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+        cpus = CPU_COUNT(&cpuSet);
+    }
+    //Containers with a CPU quota are throttled beyond it, so never run more threads than the quota allows
+    double limit = cgroupCPULimit();
+    if (limit > 0) {
+        cpus = std::min(cpus, static_cast<int>(std::ceil(limit)));
+    }
+#endif
+    return std::max(1, cpus);
+}
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler(requestedJobs > 0 ? requestedJobs.load() : defaultJobs());
+    return scheduler;
+}
+
+//Scheduler
+//Forcing serial execution is the same as running a single job
+TaskScheduler::TaskScheduler(int jobs) :
+    m_jobs(requestedParallelism == SchedulerConstants::SERIAL ? 1 : std::max(1, jobs)),
+    m_parallelism(requestedParallelism.load()),
+    m_costModel(m_jobs) {
+    //One deque per worker plus the shared queue for outside threads
+    for (int i = 0; i < m_jobs; i++) {
+        m_queues.push_back(std::make_unique<TaskQueue>());
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        lock_guard<mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void TaskScheduler::startWorkers() {
+    call_once(m_started, [this] {
+        m_workers.reserve(m_jobs - 1);
+        for (int i = 0; i < m_jobs - 1; i++) {
+            m_workers.emplace_back(&TaskScheduler::workerLoop, this, i);
+        }
+        m_workersStarted = true;
+    });
+}
+
+void TaskScheduler::workerLoop(int index) {
+    workerIndex = index;
+    QueuedTask task;
+    while (true) {
+        if (findTask(task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::spawn(Task task, TaskGroup* group) {
+    startWorkers();
+    //Workers push to their own deque, other threads to the shared queue
+    TaskQueue& queue = *m_queues[workerIndex >= 0 ? workerIndex : m_jobs - 1];
+    {
+        lock_guard<mutex> lock(queue.mutex);
+        queue.tasks.push_back({std::move(task), group});
+    }
+    m_queued.fetch_add(1);
+    {
+        lock_guard<mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool TaskScheduler::findTask(QueuedTask& task) {
+    if (m_queued.load() == 0) {
+        return false;
+    }
+    //Own deque first, newest task (its data is most likely still in cache)
+    if (workerIndex >= 0) {
+        TaskQueue& own = *m_queues[workerIndex];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    //Then the shared queue and the other workers, oldest task first
+    int start = workerIndex >= 0 ? workerIndex + 1 : 0;
+    for (int i = 0; i < m_jobs; i++) {
+        int victim = (start + i) % m_jobs;
+        if (victim == workerIndex) {
+            continue;
+        }
+        TaskQueue& queue = *m_queues[victim];
+        lock_guard<mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::execute(QueuedTask& task) {
+    task.task();
+    task.task = nullptr;
+    //Wake waiters once the last task of a group has finished
+    if (task.group->m_pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+        {
+            lock_guard<mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_all();
+    }
+}
+
+void TaskScheduler::waitFor(TaskGroup& group) {
+    QueuedTask task;
+    //Help with pending work instead of blocking, sleeping only when there is nothing to run
+    while (group.m_pending.load(memory_order_acquire) != 0) {
+        if (findTask(task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this, &group] { return group.m_pending.load() == 0 || m_queued.load() > 0; });
+    }
+}
+
+void TaskScheduler::calibrate() {
+    call_once(m_calibrated, [this] {
+        m_costModel.calibrate([this] { return measureOverheads(); });
+    });
+}
+
+std::pair<double, double> TaskScheduler::measureOverheads() {
+    //Worker startup, only measurable if nothing has started them yet
+    double start = now();
+    bool started = m_workersStarted;
+    startWorkers();
+    double startupSeconds = started ? 0.0 : now() - start;
+    //Round trip of one empty task per worker, median of several rounds
+    //The caller only watches so the tasks have to be picked up by the workers themselves
+    std::vector<double> rounds;
+    for (int round = 0; round < 9; round++) {
+        std::atomic<int> remaining{m_jobs - 1};
+        TaskGroup group;
+        start = now();
+        for (int i = 0; i < m_jobs - 1; i++) {
+            group.run([&remaining] { remaining.fetch_sub(1); });
+        }
+        while (remaining.load() > 0) {
+            std::this_thread::yield();
+        }
+        rounds.push_back(now() - start);
+        group.wait();
+    }
+    std::sort(rounds.begin(), rounds.end());
+    return {std::max(rounds[rounds.size() / 2], 1e-7), startupSeconds};
+}
+
+bool TaskScheduler::worthParallel(double serialSeconds) {
+    if (m_jobs == 1) {
+        return false;
+    }
+    if (m_parallelism == SchedulerConstants::PARALLEL) {
+        return true;
+    }
+    if (serialSeconds * 1e6 < SchedulerConstants::MIN_PARALLEL_MICROSECONDS) {
+        return false;
+    }
+    calibrate();
+    return m_costModel.worthParallel(serialSeconds, m_workersStarted);
+}
+
+void TaskScheduler::parallelFor(int begin, int end, const std::function<void(int, int)>& body, int minGrain) {
+    int iterations = end - begin;
+    //Tiny loops and single-job runs pay no scheduling overhead at all
+    if (m_jobs == 1 || iterations <= minGrain) {
+        if (iterations > 0) {
+            body(begin, end);
+        }
+        return;
+    }
+    if (m_parallelism == SchedulerConstants::PARALLEL) {
+        //Fixed grain - a few chunks per thread for load balancing, but never below minGrain
+        int chunks = m_jobs * SchedulerConstants::CHUNKS_PER_THREAD;
+        splitLoop(begin, end, std::max(minGrain, (iterations + chunks - 1) / chunks), body);
+        return;
+    }
+
+    //Time a few iterations to estimate the cost of the rest, then let the cost model decide
+    //Loops with a small minGrain may have fewer iterations than the probe
+    int probeIterations = std::min<int>(SchedulerConstants::PROBE_ITERATIONS, iterations);
+    int probeEnd = begin + probeIterations;
+    double start = now();
+    body(begin, probeEnd);
+    double secondsPerIteration = (now() - start) / probeIterations;
+    int remaining = end - probeEnd;
+    if (remaining == 0) {
+        return;
+    }
+    if (!worthParallel(secondsPerIteration * remaining)) {
+        body(probeEnd, end);
+        return;
+    }
+    splitLoop(probeEnd, end, std::max(m_costModel.grainFor(secondsPerIteration, remaining), 1), body);
+}
+
+void TaskScheduler::splitLoop(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+    TaskGroup group;
+    for (int chunkBegin = begin + grain; chunkBegin < end; chunkBegin += grain) {
+        int chunkEnd = std::min(end, chunkBegin + grain);
+        group.run([&body, chunkBegin, chunkEnd] { body(chunkBegin, chunkEnd); });
+    }
+    //The calling thread takes the first chunk itself
+    body(begin, std::min(end, begin + grain));
+    group.wait();
+}
@@ -1,346 +1,255 @@
 #include "parser/Parser.h"
 
-#include <functional>
+#include <algorithm>
 #include <utility>
 
 using namespace std;
 using namespace PTConstants;
 using namespace PT;
 
-//Constructor and helpers - Initialize all data structure values and parsing templates
-Parser::Parser() {
-    // Initialize the instructionMap with expected lengths of each instruction
-    m_instructionMap.reserve(26);
-    m_instructionMap["move"] = 4;
-    m_instructionMap["load"] = 4;
-    m_instructionMap["store"] = 4;
-    m_instructionMap["create"] = 5;
-    m_instructionMap["cast"] = 3;
-    m_instructionMap["add"] = 6;
-    m_instructionMap["sub"] = 6;
-    m_instructionMap["multiply"] = 6;
-    m_instructionMap["divide"] = 6;
-    m_instructionMap["or"] = 4;
-    m_instructionMap["and"] = 4;
-    m_instructionMap["not"] = 2;
-    m_instructionMap["shift"] = 6;
-    m_instructionMap["compare"] = 4;
-    m_instructionMap["jump"] = 5;
-    m_instructionMap["call"] = 3;
-    m_instructionMap["push"] = 2;
-    m_instructionMap["pop"] = 3;
-    m_instructionMap["return"] = 1;
-    m_instructionMap["stop"] = 1;
-    m_instructionMap["input"] = 4;
-    m_instructionMap["output"] = 2;
-    m_instructionMap["print"] = 2;
-    m_instructionMap["label"] = 2;
-    m_instructionMap["comment"] = 2;
-
-    // Preallocate size for the template map
-        m_templateMap.reserve(26);
-
-    // Move instruction template
-        m_templateMap["move"].reserve(2);
-        m_templateMap["move"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["move"].push_back({{"to", 2}, checkExplicitConjunction});
-
-    // Load instruction template
-        m_templateMap["load"].reserve(2);
-        m_templateMap["load"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["load"].push_back({{"to", 2}, checkExplicitConjunction});
-
-    // Store instruction template
-        m_templateMap["store"].reserve(2);
-        m_templateMap["store"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["store"].push_back({{"to", 2}, checkExplicitConjunction});
-
-    // Create instruction template
-        m_templateMap["create"].reserve(3);
-        m_templateMap["create"].push_back({{"type", 0}, checkImplicitCondition});
-        m_templateMap["create"].push_back({{"from", 1}, checkImplicitConjunction});
-        m_templateMap["create"].push_back({{"to", 3}, checkExplicitConjunction});
-
-    // Cast instruction template
-        m_templateMap["cast"].reserve(2);
-        m_templateMap["cast"].push_back({{"type", 0}, checkImplicitCondition});
-        m_templateMap["cast"].push_back({{"self", 1}, checkImplicitConjunction});
-
-    // Add instruction template
-        m_templateMap["add"].reserve(3);
-        m_templateMap["add"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["add"].push_back({{"with", 2}, checkExplicitConjunction});
-        m_templateMap["add"].push_back({{"to", 4}, checkExplicitConjunction});
-
-    // Sub instruction template
-        m_templateMap["sub"].reserve(3);
-        m_templateMap["sub"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["sub"].push_back({{"with", 2}, checkExplicitConjunction});
-        m_templateMap["sub"].push_back({{"to", 4}, checkExplicitConjunction});
-
-    // Multiply instruction template
-        m_templateMap["multiply"].reserve(3);
-        m_templateMap["multiply"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["multiply"].push_back({{"with", 2}, checkExplicitConjunction});
-        m_templateMap["multiply"].push_back({{"to", 4}, checkExplicitConjunction});
-
-    // Divide instruction template
-        m_templateMap["divide"].reserve(3);
-        m_templateMap["divide"].push_back({{"from", 0}, checkImplicitConjunction});
-        m_templateMap["divide"].push_back({{"with", 2}, checkExplicitConjunction});
-        m_templateMap["divide"].push_back({{"to", 4}, checkExplicitConjunction});
-
-    // Or instruction template
-        m_templateMap["or"].reserve(2);
-        m_templateMap["or"].push_back({{"self", 0}, checkImplicitConjunction});
-        m_templateMap["or"].push_back({{"with", 2}, checkExplicitConjunction});
-
-    // And instruction template
-        m_templateMap["and"].reserve(2);
-        m_templateMap["and"].push_back({{"self", 0}, checkImplicitConjunction});
-        m_templateMap["and"].push_back({{"with", 2}, checkExplicitConjunction});
-
-    // Not instruction template
-        m_templateMap["not"].reserve(1);
-        m_templateMap["not"].push_back({{"self", 0}, checkImplicitConjunction});
-
-    // Shift instruction template
-        m_templateMap["shift"].reserve(3);
-        m_templateMap["shift"].push_back({{"direction", 0}, checkImplicitCondition});
-        m_templateMap["shift"].push_back({{"self", 1}, checkImplicitConjunction});
-        m_templateMap["shift"].push_back({{"by", 3}, checkExplicitConjunction});
-
-    // Compare instruction template
-        m_templateMap["compare"].reserve(2);
-        m_templateMap["compare"].push_back({{"self", 0}, checkImplicitConjunction});
-        m_templateMap["compare"].push_back({{"with", 2}, checkExplicitConjunction});
-
-    // Jump instruction
-        m_templateMap["jump"].reserve(2);
-        m_templateMap["jump"].push_back({{"if", 1}, checkExplicitCondition});
-        m_templateMap["jump"].push_back({{"to", 3}, checkExplicitConjunction});
-
-    // Call instruction
-        m_templateMap["call"].reserve(1);
-        m_templateMap["call"].push_back({{"to", 1}, checkExplicitConjunction});
-
-    // Push instruction
-        m_templateMap["push"].reserve(1);
-        m_templateMap["push"].push_back({{"from", 0}, checkImplicitConjunction});
-
-    // Pop instruction
-        m_templateMap["pop"].reserve(1);
-        m_templateMap["pop"].push_back({{"to", 1}, checkExplicitConjunction});
-
-    // Return instruction
-        m_templateMap["return"].reserve(0);  // No arguments for return
-
-    // Stop instruction
-        m_templateMap["stop"].reserve(0);  // No arguments for stop
-
-    // Input instruction
-        m_templateMap["input"].reserve(2);
-        m_templateMap["input"].push_back({{"type", 0}, checkImplicitCondition});
-        m_templateMap["input"].push_back({{"to", 2}, checkExplicitConjunction});
-
-    // Output instruction template
-        m_templateMap["output"].reserve(1);
-        m_templateMap["output"].push_back({{"from", 0}, checkImplicitConjunction});
-
-    // Print instruction
-        m_templateMap["print"].reserve(1);
-        m_templateMap["print"].push_back({{"from", 0}, checkImplicitConjunction});
-
-    // Comment instruction
-        m_templateMap["comment"].reserve(1);
-        m_templateMap["comment"].push_back({{"static", 0}, checkImplicitConjunction});
+//Template table - sorted by instruction for binary search
+const Parser::InstructionTemplate* Parser::findTemplate(string_view instruction) {
+    static constexpr InstructionTemplate TEMPLATES[] = {
+        {"add", 6, 3, {{"from", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}, {"to", 4, checkExplicitConjunction}}},
+        {"and", 4, 2, {{"self", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}}},
+        {"call", 3, 1, {{"to", 1, checkExplicitConjunction}}},
+        {"cast", 3, 2, {{"type", 0, checkImplicitCondition}, {"self", 1, checkImplicitConjunction}}},
+        {"comment", 2, 1, {{"static", 0, checkImplicitConjunction}}},
+        {"compare", 4, 2, {{"self", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}}},
+        {"create", 5, 3, {{"type", 0, checkImplicitCondition}, {"from", 1, checkImplicitConjunction}, {"to", 3, checkExplicitConjunction}}},
+        {"divide", 6, 3, {{"from", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}, {"to", 4, checkExplicitConjunction}}},
+        {"input", 4, 2, {{"type", 0, checkImplicitCondition}, {"to", 2, checkExplicitConjunction}}},
+        {"jump", 5, 2, {{"if", 1, checkExplicitCondition}, {"to", 3, checkExplicitConjunction}}},
+        {"label", 2, 1, {{"static", 0, checkImplicitConjunction}}},
+        {"load", 4, 2, {{"from", 0, checkImplicitConjunction}, {"to", 2, checkExplicitConjunction}}},
+        {"move", 4, 2, {{"from", 0, checkImplicitConjunction}, {"to", 2, checkExplicitConjunction}}},
+        {"multiply", 6, 3, {{"from", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}, {"to", 4, checkExplicitConjunction}}},
+        {"not", 2, 1, {{"self", 0, checkImplicitConjunction}}},
+        {"or", 4, 2, {{"self", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}}},
+        {"output", 2, 1, {{"from", 0, checkImplicitConjunction}}},
+        {"pop", 3, 1, {{"to", 1, checkExplicitConjunction}}},
+        {"print", 2, 1, {{"from", 0, checkImplicitConjunction}}},
+        {"push", 2, 1, {{"from", 0, checkImplicitConjunction}}},
+        {"return", 1, 0, {}},
+        {"shift", 6, 3, {{"direction", 0, checkImplicitCondition}, {"self", 1, checkImplicitConjunction}, {"by", 3, checkExplicitConjunction}}},
+        {"stop", 1, 0, {}},
+        {"store", 4, 2, {{"from", 0, checkImplicitConjunction}, {"to", 2, checkExplicitConjunction}}},
+        {"sub", 6, 3, {{"from", 0, checkImplicitConjunction}, {"with", 2, checkExplicitConjunction}, {"to", 4, checkExplicitConjunction}}},
+    };
+    static_assert([] {
+        for (size_t i = 1; i < sizeof(TEMPLATES) / sizeof(TEMPLATES[0]); i++) {
+            if (!(TEMPLATES[i - 1].instruction < TEMPLATES[i].instruction)) {
+                return false;
+            }
+        }
+        return true;
+    }(), "Parser template table must stay sorted");
+    auto itr = lower_bound(begin(TEMPLATES), end(TEMPLATES), instruction, [](const InstructionTemplate& entry, string_view value) {
+        return entry.instruction < value;
+    });
+    if (itr != end(TEMPLATES) && itr->instruction == instruction) {
+        return itr;
+    }
+    return nullptr;
+}
 
-    // Label instruction
-        m_templateMap["label"].reserve(1);
-        m_templateMap["label"].push_back({{"static", 0}, checkImplicitConjunction});
+bool Parser::parseCode(PT::ParseTree* parseTree, const SourceBuffer& source, const std::vector<Tokens>& tokens, DiagnosticEngine& diagnostics) {
+    return parseLines(parseTree, source, tokens, 0, diagnostics);
 }
 
-bool Parser::parseCode(PT::ParseTree* parseTree, const std::vector<std::string>& codeLines, const std::vector<std::vector<std::pair<std::string, LexerConstants::TokenType>>>& tokens, std::string& errorMessage) {
+bool Parser::parseLines(PT::ParseTree* parseTree, const SourceBuffer& source, const std::vector<Tokens>& tokens, int firstLine, DiagnosticEngine& diagnostics) {
     //The parser relies on top-down recursive descent parsing
-    //Preallocate L1 based on codeLines
+    //Preallocate L1 based on the number of lines
     int numTokens = tokens.size();
     parseTree->getRoot()->reserveChildren(numTokens);
+    bool valid = true;
     for (int i=0; i<numTokens; i++) {
+        //Stop early once the error cap holds errors sorting before this line
+        if (diagnostics.full(DiagnosticConstants::PARSER, firstLine + i + 1)) {
+            break;
+        }
         //Call validateInstruction in InstructionSet
-        string error = checkInstruction(parseTree, tokens[i]);
-        //If an error is present
-        if (!error.empty()) {
-            errorMessage += "\nInvalid syntax at line " + to_string(i + 1) + ": " + codeLines[i] + "\n" + error + "\n";
+        Diagnostic error{DiagnosticConstants::PARSER, DiagnosticConstants::UNKNOWN_INSTRUCTION};
+        //If an error is present, record it and locate the offending token
+        if (!checkInstruction(parseTree, tokens[i], error)) {
+            error.line = firstLine + i + 1;
+            int tokenIndex = error.column;
+            error.column = DiagnosticConstants::NO_COLUMN;
+            if (tokenIndex >= 0) {
+                DiagnosticEngine::setTokenSpan(error, source.line(firstLine + i), tokenIndex);
+            }
+            diagnostics.report(std::move(error));
+            valid = false;
         }
     }
-    //Concatenate the statusMessage string from the map (which should be ordered already)
-    if (errorMessage.empty()) {
-        return true;
-    }
-    else {
-        return false;
-    }
+    return valid;
 }
 
 //LEVEL 1 - INSTRUCTION PARSER AND CHECKER
-string Parser::checkInstruction(ParseTree* parseTree, vector<pair<string, LexerConstants::TokenType>> tokens) {
+//NOTE - on error, helpers set error.column to the index of the offending token until parseCode converts it into a column span
+bool Parser::checkInstruction(ParseTree* parseTree, const Tokens& tokens, Diagnostic& error) {
     //Zero case, return instantly with valid syntax and no AST construction
     if (tokens[0].second == LexerConstants::TokenType::BLANK) {
         parseTree->getRoot()->insertChild((new GeneralNode(0, "", BLANK)));
-        return "";
+        return true;
     }
     //If keyword doesn't match, return error no instruction found
     if (tokens[0].second != LexerConstants::TokenType::INSTRUCTION) {
-        return "Unknown instruction '" + tokens[0].first + "'";
+        error.code = DiagnosticConstants::UNKNOWN_INSTRUCTION;
+        error.args[0] = tokens[0].first;
+        error.column = 0;
+        return false;
     }
-    auto itr = m_templateMap.find(tokens[0].first);
+    const InstructionTemplate* parsingTemplate = findTemplate(tokens[0].first);
     //If found, go to parse instruction method creating a new instruction node
-    if (itr!= m_templateMap.end()) {
-        return parseInstruction(parseTree, (parseTree->getRoot()->insertChild((new GeneralNode(0, tokens[0].first, INSTRUCTION)))), tokens, itr->second);
+    if (parsingTemplate != nullptr) {
+        return parseInstruction(parseTree, (parseTree->getRoot()->insertChild((new GeneralNode(0, tokens[0].first, INSTRUCTION)))), tokens, *parsingTemplate, error);
     }
     else {
         //Edge case, valid instruction with no method implemented (debug)
-        return "Compiler error for '" + tokens[0].first + "'. Could not find instruction parsing method.";
+        error.code = DiagnosticConstants::MISSING_INSTRUCTION_PARSER;
+        error.args[0] = tokens[0].first;
+        error.column = 0;
+        return false;
     }
 }
 
-string Parser::parseInstruction(ParseTree* parseTree, PTNode* node, std::vector<std::pair<std::string, LexerConstants::TokenType>> tokens, std::vector<std::pair<std::pair<std::string, int>, std::function<std::string(ParseTree*, PTNode*, std::vector<std::pair<std::string, LexerConstants::TokenType>>, std::string&, int)>>> parsingTemplate) {
-    //Temporary return string
-    string returnString;
-    //Loop through all templates
-    //NOTE - if the instruction is a no operand (i.e. empty parsingTemplate) loop will not run and will go straight to final check
-    for (auto& templateElement : parsingTemplate) {
+bool Parser::parseInstruction(ParseTree* parseTree, PTNode* node, const Tokens& tokens, const InstructionTemplate& parsingTemplate, Diagnostic& error) {
+    //Loop through all template steps
+    //NOTE - if the instruction is a no operand (i.e. no steps) loop will not run and will go straight to final check
+    for (int i = 0; i < parsingTemplate.numSteps; i++) {
+        const TemplateStep& step = parsingTemplate.steps[i];
         //Access the parsing function, passing the index expected in the token sequence
-        returnString = templateElement.second(parseTree, node, tokens, templateElement.first.first, templateElement.first.second);
         //If an error arises, return instantly
-        if (!returnString.empty()) {
-            return returnString;
+        if (!step.function(parseTree, node, tokens, step.keyword, step.index, error)) {
+            return false;
         }
-        //Clear return string on every iteration
-        returnString.clear();
     }
 
     //Final check - syntax correct but there's excess tokens present
-    //Find size of template expected through instructionMap lookup
-    auto itr = m_instructionMap.find(tokens[0].first);
-    if(itr!=m_instructionMap.end()) {
-        //If tokens exceed expected size
-        if (tokens.size() > itr->second) {
-            return "Excess tokens at and past '" + tokens[tokens.size()].first + "' found.";
-        }
-        else {
-            //Correct syntax
-            return "";
-        }
-    }
-    else {
-        //Compiler error - edge case with valid instruction not in hash table
-        return "Compiler error for '" + tokens[0].first + "'. Could not find instruction information.";
+    if (tokens.size() > parsingTemplate.numTokens) {
+        error.code = DiagnosticConstants::EXCESS_TOKENS;
+        error.args[0] = tokens[parsingTemplate.numTokens].first;
+        error.column = parsingTemplate.numTokens;
+        return false;
     }
-
+    //Correct syntax
+    return true;
 }
 
 
 
 //LEVEL 2 - CONJUNCTION AND CONDITION CHECKERS / PARSER HELPERS
-string Parser::checkImplicitConjunction(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    string returnString;
+bool Parser::checkImplicitConjunction(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Implicit node is implicit, so always exists
     //Add keyword as child
-    //Rewrite returnString if L2 analysis returns an error
-    returnString = parseConjunction(parseTree, node->insertChild((new GeneralNode(Constants::IMPLICIT_INDEX, keyword, CONJUNCTION))), tokens, keyword, index);
-    return returnString;
+    //Return false if L2 analysis returns an error
+    return parseConjunction(parseTree, node->insertChild((new GeneralNode(Constants::IMPLICIT_INDEX, string(keyword), CONJUNCTION))), tokens, keyword, index, error);
 }
 
-string Parser::checkImplicitCondition(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    string returnString;
+bool Parser::checkImplicitCondition(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Implicit node is implicit, so always exists
     //Add keyword as child
-    //Rewrite returnString if L2 analysis returns an error
-    returnString = parseCondition(parseTree, node->insertChild((new GeneralNode(Constants::IMPLICIT_INDEX, keyword, CONJUNCTION))), tokens, keyword, index);
-    return returnString;
+    //Return false if L2 analysis returns an error
+    return parseCondition(parseTree, node->insertChild((new GeneralNode(Constants::IMPLICIT_INDEX, string(keyword), CONJUNCTION))), tokens, keyword, index, error);
 }
 
-string Parser::checkExplicitConjunction(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    string returnString;
+bool Parser::checkExplicitConjunction(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Check if a conjunction exists by comparing size
     if (tokens.size()<=index) {
-        return "Missing conjunction. Expected '" + keyword + "'";
+        error.code = DiagnosticConstants::MISSING_CONJUNCTION;
+        error.args[0] = keyword;
+        return false;
     }
     //Check if to keyword is valid
     else if (tokens[index].first != keyword) {
-        return "Unknown conjunction '" + tokens[index].first + "'. Expected '" + keyword + "'";
+        error.code = DiagnosticConstants::UNKNOWN_CONJUNCTION;
+        error.args[0] = tokens[index].first;
+        error.args[1] = keyword;
+        error.column = index;
+        return false;
     }
     //If passed, add to keyword as child
-    //Rewrite returnString if L2 analysis returns an error
+    //Return false if L2 analysis returns an error
     else {
-        returnString = parseConjunction(parseTree, node->insertChild((new GeneralNode(index, keyword, CONJUNCTION))), tokens, keyword, index);
-        return returnString;
+        return parseConjunction(parseTree, node->insertChild((new GeneralNode(index, string(keyword), CONJUNCTION))), tokens, keyword, index, error);
     }
 }
 
-string Parser::checkExplicitCondition(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    string returnString;
+bool Parser::checkExplicitCondition(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Check if a condition exists by comparing size
     if (tokens.size()<=index) {
-        return "Missing condition. Expected '" + keyword + "'";
+        error.code = DiagnosticConstants::MISSING_CONDITION;
+        error.args[0] = keyword;
+        return false;
     }
     //Check if to keyword is valid
     else if (tokens[index].first != keyword) {
-        return "Unknown condition '" + tokens[index].first + "'. Expected '" + keyword + "'";
+        error.code = DiagnosticConstants::UNKNOWN_CONDITION;
+        error.args[0] = tokens[index].first;
+        error.args[1] = keyword;
+        error.column = index;
+        return false;
     }
     //If passed, add to keyword as child
-    //Rewrite returnString if L2 analysis returns an error
+    //Return false if L2 analysis returns an error
     else {
-        returnString = parseCondition(parseTree, node->insertChild((new GeneralNode(index, keyword, CONJUNCTION))), tokens, keyword, index);
-        return returnString;
+        return parseCondition(parseTree, node->insertChild((new GeneralNode(index, string(keyword), CONJUNCTION))), tokens, keyword, index, error);
     }
 }
 
-string Parser::parseConjunction(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    //Create temporary return string
-    string returnString;
+bool Parser::parseConjunction(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Increment index by one to now point to where the operand should be
     index++;
     //If the operand does not exist after the keyword, return an error
     if(tokens.size()<=index) {
-        return "Missing operand after '" + tokens[index-1].first + "'";
+        error.code = DiagnosticConstants::MISSING_OPERAND;
+        error.args[0] = tokens[index-1].first;
+        return false;
     }
     //If the token in the operand position is not an operand, return an error
     else if (!isOperand(tokens[index])) {
-        return "Unknown operand '" + tokens[index].first + "' after '" + tokens[index-1].first + "'";
+        error.code = DiagnosticConstants::UNKNOWN_OPERAND;
+        error.args[0] = tokens[index].first;
+        error.args[1] = tokens[index-1].first;
+        error.column = index;
+        return false;
     }
     else {
         //Insert a new child as the operand
         node->insertChild((new OperandNode(index, tokens[index].first, returnPTOperand(tokens[index].second))));
-        return "";
+        return true;
     }
 }
 
-string Parser::parseCondition(ParseTree* parseTree, PTNode* node, vector<pair<string, LexerConstants::TokenType>> tokens, string& keyword, int index) {
-    //Create temporary return string
-    string returnString;
+bool Parser::parseCondition(ParseTree* parseTree, PTNode* node, const Tokens& tokens, string_view keyword, int index, Diagnostic& error) {
     //Iterate the index to now point to where the condition should be
     index++;
     //If the descriptor after keyword does not exist
     if(tokens.size()<=index) {
-        return "Missing descriptor after '" + tokens[index-1].first + "'";
+        error.code = DiagnosticConstants::MISSING_DESCRIPTOR;
+        error.args[0] = tokens[index-1].first;
+        return false;
     }
     //If the token after keyword does not match as a descriptor
     else if (!isDescriptor(tokens[index])) {
-        return "Unknown descriptor '" + tokens[index].first + "' after '" + tokens[index-1].first + "'";
+        error.code = DiagnosticConstants::UNKNOWN_DESCRIPTOR;
+        error.args[0] = tokens[index].first;
+        error.args[1] = tokens[index-1].first;
+        error.column = index;
+        return false;
     }
     else {
         //Insert a new child as the operand
         node->insertChild((new OperandNode(index, tokens[index].first, returnPTOperand(tokens[index].second))));
-        return "";
+        return true;
     }
 }
 
 
 
 //LEVEL 3 - OPERANDS AND DESCRIPTORS
-bool Parser::isOperand(pair<string, LexerConstants::TokenType>& token) {
+bool Parser::isOperand(const pair<string, LexerConstants::TokenType>& token) {
     //Switch statement to determine if a lexer constant constitutes an operand in the PT
     switch (token.second) {
         case LexerConstants::TokenType::REGISTER:
@@ -359,7 +268,7 @@ bool Parser::isOperand(pair<string, LexerConstants::TokenType>& token) {
     }
 }
 
-bool Parser::isDescriptor(pair<string, LexerConstants::TokenType>& token) {
+bool Parser::isDescriptor(const pair<string, LexerConstants::TokenType>& token) {
     //Check if token is a condition
     //Switch statement
     switch (token.second) {
@@ -0,0 +1,262 @@
+#include "pipeline/FrontendPipeline.h"
+#include "ast/ASTBuilder.h"
+#include "scopecheck/ScopeChecker.h"
+#include "semantics/SemanticAnalyzer.h"
+#include "parallel/TaskScheduler.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+FrontendPipeline::FrontendPipeline(int chunkLines) :
+    m_builder(std::make_unique<ASTBuilder>()),
+    m_scopeChecker(std::make_unique<ScopeChecker>()),
+    m_semanticAnalyzer(std::make_unique<SemanticAnalyzer>()),
+    m_chunkLines(chunkLines > 0 ? chunkLines : PipelineConstants::CHUNK_LINES) {}
+
+FrontendPipeline::~FrontendPipeline() = default;
+
+bool FrontendPipeline::run(const std::string& pathname, std::shared_ptr<const SourceBuffer>& source, AST::AbstractSyntaxTree* abstractSyntaxTree, DiagnosticEngine& diagnostics) {
+    //The whole file is indexed up front so every stage knows the total number of lines (reusing a source loaded for a cache lookup)
+    m_source = source != nullptr ? source : SourceBuffer::fromFile(pathname);
+    source = m_source;
+    if (m_source == nullptr) {
+        diagnostics.report({DiagnosticConstants::LEXER, DiagnosticConstants::FILE_NOT_FOUND});
+        return false;
+    }
+    m_AST = abstractSyntaxTree;
+    m_diagnostics = &diagnostics;
+    m_AST->getRoot()->reserveChildren(m_source->numLines());
+    m_scopeChecker->beginChecks(m_deferred, m_source);
+    m_semanticAnalyzer->beginAnalysis(m_deferred, m_source);
+
+    //Never run more stage threads than jobs - with a single job every chunk passes through all stages in turn
+    int numGroups = std::min(TaskScheduler::getJobs(), static_cast<int>(NUM_STAGES));
+    std::vector<std::unique_ptr<BoundedQueue<Chunk>>> queues;
+    for (int i = 0; i < numGroups - 1; i++) {
+        queues.push_back(std::make_unique<BoundedQueue<Chunk>>(PipelineConstants::QUEUE_CAPACITY));
+    }
+    //The last group (validation) runs on the calling thread
+    std::vector<std::thread> threads;
+    for (int group = 0; group < numGroups - 1; group++) {
+        threads.emplace_back(&FrontendPipeline::runGroup, this, group, numGroups, std::ref(queues));
+    }
+    runGroup(numGroups - 1, numGroups, queues);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    m_semanticAnalyzer->endAnalysis();
+
+    //Same gating as the batch passes - parse errors hide label errors, label errors hide scope and semantic errors
+    if (m_parseFailed || diagnostics.hasErrors(DiagnosticConstants::PARSER)) {
+        return false;
+    }
+    if (!resolveLabels()) {
+        return false;
+    }
+    for (auto& diagnostic : m_deferred.collect()) {
+        diagnostics.report(std::move(diagnostic));
+    }
+    return !diagnostics.hasErrors();
+}
+
+void FrontendPipeline::runGroup(int group, int numGroups, std::vector<std::unique_ptr<BoundedQueue<Chunk>>>& queues) {
+    int firstStage = group * NUM_STAGES / numGroups;
+    int lastStage = (group + 1) * NUM_STAGES / numGroups;
+    bool hasOutput = group < numGroups - 1;
+    auto process = [&](Chunk& chunk) {
+        for (int stage = firstStage; stage < lastStage; stage++) {
+            runStage(static_cast<Stage>(stage), chunk);
+        }
+        if (hasOutput) {
+            queues[group]->push(std::move(chunk));
+        }
+    };
+
+    if (group == 0) {
+        //The first group produces the chunks
+        int numLines = m_source->numLines();
+        for (int begin = 0; begin < numLines && !m_cancelled; begin += m_chunkLines) {
+            Chunk chunk;
+            chunk.firstLine = begin;
+            chunk.endLine = std::min(begin + m_chunkLines, numLines);
+            process(chunk);
+        }
+    }
+    else {
+        //Keep draining the input after cancelling so the previous group is never left blocked
+        Chunk chunk;
+        while (queues[group - 1]->pop(chunk)) {
+            process(chunk);
+        }
+    }
+    if (hasOutput) {
+        queues[group]->close();
+    }
+}
+
+void FrontendPipeline::runStage(Stage stage, Chunk& chunk) {
+    switch (stage) {
+        case LEX:
+            lexChunk(chunk);
+            break;
+        case PARSE:
+            parseChunk(chunk);
+            break;
+        case BUILD:
+            buildChunk(chunk);
+            break;
+        case VALIDATE:
+            validateChunk(chunk);
+            break;
+        default:
+            break;
+    }
+}
+
+void FrontendPipeline::lexChunk(Chunk& chunk) {
+    if (m_cancelled) {
+        return;
+    }
+    m_lexer.tokenizeLines(*m_source, chunk.firstLine, chunk.endLine, chunk.tokens);
+}
+
+void FrontendPipeline::parseChunk(Chunk& chunk) {
+    if (m_cancelled) {
+        return;
+    }
+    chunk.parseTree = std::make_unique<PT::ParseTree>();
+    //Parse errors are reported straight away, every chunk is still parsed so all of them are found
+    if (!m_parser.parseLines(chunk.parseTree.get(), *m_source, chunk.tokens, chunk.firstLine, *m_diagnostics)) {
+        m_parseFailed = true;
+    }
+    if (m_diagnostics->full(DiagnosticConstants::PARSER, chunk.endLine)) {
+        m_cancelled = true;
+    }
+    //The tokens are no longer needed
+    std::vector<Parser::Tokens>().swap(chunk.tokens);
+}
+
+void FrontendPipeline::buildChunk(Chunk& chunk) {
+    //Nothing downstream is needed once parsing has failed
+    if (m_parseFailed || chunk.parseTree == nullptr) {
+        chunk.parseTree.reset();
+        return;
+    }
+    AST::ASTNode* root = m_AST->getRoot();
+    PT::PTNode* chunkRoot = chunk.parseTree->getRoot();
+    int numInstructions = chunkRoot->getNumChildren();
+    chunk.instructions.reserve(numInstructions);
+    chunk.placeholders.reserve(numInstructions);
+
+    for (int i = 0; i < numInstructions; i++) {
+        PT::PTNode* PTInstructionNode = chunkRoot->childAt(i);
+        int line = chunk.firstLine + i + 1;
+        size_t firstUse = m_uses.size();
+        std::uint8_t placeholders = 0;
+
+        //Turn label operands into instruction address placeholders, remembering declarations and uses
+        for (int j = 0; j < PTInstructionNode->getNumChildren(); j++) {
+            auto labelNode = dynamic_cast<PT::OperandNode*>(PTInstructionNode->childAt(j)->childAt(0));
+            if (labelNode != nullptr && labelNode->getOperandType() == PTConstants::OperandType::LABEL) {
+                if (PTInstructionNode->getNodeValue() == "label") {
+                    m_declarations.push_back({labelNode->getNodeValue(), line, labelNode->getIndex(), nullptr});
+                }
+                m_uses.push_back({labelNode->getNodeValue(), line, labelNode->getIndex(), nullptr});
+                labelNode->setOperandType(PTConstants::OperandType::INSTRUCTIONADDRESS);
+                placeholders |= static_cast<std::uint8_t>(1u << j);
+            }
+        }
+
+        AST::InstructionNode* instruction = m_builder->buildInstruction(PTInstructionNode, m_AST, line);
+        if (instruction == nullptr) {
+            continue;
+        }
+        //Link each recorded use to its AST operand so the fixup can bind it in place
+        for (int j = 0; j < instruction->getNumChildren(); j++) {
+            auto operand = static_cast<AST::OperandNode*>(instruction->childAt(j));
+            if (placeholders & (1u << operand->getPos())) {
+                for (size_t k = firstUse; k < m_uses.size(); k++) {
+                    if (m_uses[k].operand == nullptr) {
+                        m_uses[k].operand = operand;
+                        break;
+                    }
+                }
+            }
+        }
+        root->insertChild(instruction);
+        chunk.instructions.push_back(instruction);
+        chunk.placeholders.push_back(placeholders);
+    }
+    //The chunk's parse tree is no longer needed
+    chunk.parseTree.reset();
+}
+
+void FrontendPipeline::validateChunk(Chunk& chunk) {
+    if (m_parseFailed) {
+        return;
+    }
+    for (size_t i = 0; i < chunk.instructions.size(); i++) {
+        AST::InstructionNode* instruction = chunk.instructions[i];
+        //Semantics only depend on operand types, so placeholders can be analyzed before they are bound
+        m_semanticAnalyzer->analyzeNode(*instruction);
+        //Scopes of placeholders are checked once their address is known
+        for (int j = 0; j < instruction->getNumChildren(); j++) {
+            auto operand = static_cast<AST::OperandNode*>(instruction->childAt(j));
+            if (!(chunk.placeholders[i] & (1u << operand->getPos()))) {
+                m_scopeChecker->checkNode(*operand);
+            }
+        }
+    }
+}
+
+bool FrontendPipeline::resolveLabels() {
+    //Build the symbol table in line order - the first declaration of a label wins
+    std::unordered_map<std::string, int> symbolTable;
+    symbolTable.reserve(m_declarations.size());
+    for (const auto& declaration : m_declarations) {
+        auto itr = symbolTable.find(declaration.label);
+        if (itr != symbolTable.end()) {
+            Diagnostic error{DiagnosticConstants::SYMBOLS, DiagnosticConstants::DUPLICATE_LABEL, declaration.line};
+            error.number = itr->second;
+            error.args[0] = declaration.label;
+            DiagnosticEngine::setTokenSpan(error, m_source->line(declaration.line - 1), 1);
+            m_diagnostics->report(std::move(error));
+        }
+        else {
+            symbolTable.emplace(declaration.label, declaration.line);
+        }
+    }
+
+    //Bind every use to its declaration's instruction address
+    for (const auto& use : m_uses) {
+        if (m_diagnostics->full(DiagnosticConstants::SYMBOLS, use.line)) {
+            break;
+        }
+        auto itr = symbolTable.find(use.label);
+        if (itr == symbolTable.end()) {
+            Diagnostic error{DiagnosticConstants::SYMBOLS, DiagnosticConstants::UNDEFINED_LABEL, use.line};
+            error.args[0] = use.label;
+            DiagnosticEngine::setTokenSpan(error, m_source->line(use.line - 1), use.tokenIndex);
+            m_diagnostics->report(std::move(error));
+        }
+        else if (use.operand != nullptr) {
+            use.operand->setNodeValue("i[" + to_string(itr->second) + "]");
+        }
+    }
+    if (m_diagnostics->hasErrors(DiagnosticConstants::SYMBOLS)) {
+        return false;
+    }
+
+    //Check the scopes of the now bound addresses
+    for (const auto& use : m_uses) {
+        if (use.operand != nullptr) {
+            m_scopeChecker->checkNode(*use.operand);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#include "runtime/Runtime.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace RuntimeConstants;
+using Runtime::Value;
+
+__attribute__((cold)) void startasmFail(std::int32_t line, const char* message) {
+    //Output the program wrote so far goes first
+    std::fflush(nullptr);
+    dprintf(2, "\nRuntime error at line %d: %s\n", line, message);
+    std::exit(1);
+}
+
+Value* startasmCell(Value** pages, std::int32_t line, std::int32_t address) {
+    Value*& page = pages[address >> PAGE_BITS];
+    if (page == nullptr) {
+        page = static_cast<Value*>(std::calloc(1 << PAGE_BITS, sizeof(Value)));
+        if (page == nullptr) {
+            startasmFail(line, "Out of memory");
+        }
+    }
+    return page + (address & ((1 << PAGE_BITS) - 1));
+}
+
+void startasmOutput(std::int32_t type, std::int32_t payload) {
+    switch (type) {
+        case INTEGER:
+            std::printf("%d", payload);
+            break;
+        case FLOAT: {
+            //Floats are carried as the payload bits
+            float value;
+            std::memcpy(&value, &payload, sizeof(value));
+            std::printf("%g", value);
+            break;
+        }
+        case BOOLEAN:
+            std::printf("%s", payload != 0 ? "true" : "false");
+            break;
+        case CHARACTER:
+            std::putchar(payload);
+            break;
+        case MEMORY:
+            std::printf("m<%d>", payload);
+            break;
+        case INSTRUCTION:
+            std::printf("i[%d]", payload);
+            break;
+        default:
+            break;
+    }
+}
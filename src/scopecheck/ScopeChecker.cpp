@@ -1,75 +1,86 @@
 #include "scopecheck/ScopeChecker.h"
 
 #include <string>
-#include <vector>
-#include <regex>
+#include <utility>
 
 using namespace std;
 
-ScopeChecker::ScopeChecker(std::vector<std::string> &lines): m_codeLines(lines) {};
+namespace {
+    //Number of digits between a prefix and a one character suffix, 0 if the operand is malformed
+    //NOTE - the lexer and the symbol resolver guarantee the operand shape, so this only counts
+    size_t countDigits(const string& value, size_t prefix) {
+        if (value.size() <= prefix + 1) {
+            return 0;
+        }
+        for (size_t i = prefix; i < value.size() - 1; i++) {
+            if (value[i] < '0' || value[i] > '9') {
+                return 0;
+            }
+        }
+        return value.size() - prefix - 1;
+    }
+}
 
-bool ScopeChecker::checkAddressScopes(AST::ASTNode *AST, std::string &errorMessage, const std::vector<std::string> &codeLines) {
-    //Set the code lines to the given argument
-    m_codeLines = codeLines;
+bool ScopeChecker::checkAddressScopes(AST::ASTNode *AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source) {
+    beginChecks(diagnostics, std::move(source));
 
     //Visit the root and iterate over the AST
     AST->accept(*this);
 
-    //Concatenate status message string with all error messages
-    for (const auto& pair : m_invalidLines) {
-        errorMessage += pair.second;
-    }
-
     //Return true if no errors, false otherwise
-    if (!errorMessage.empty()) {
-        return false;
-    }
-    return true;
+    return !diagnostics.hasErrors(DiagnosticConstants::SCOPE);
 }
 
+void ScopeChecker::beginChecks(DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source) {
+    //Share the source buffer for error reporting (no copy of the code lines is made)
+    m_source = std::move(source);
+    m_numLines = m_source->numLines();
+    m_diagnostics = &diagnostics;
+}
 
-void ScopeChecker::visit(AST::RegisterOperand& node) {
+void ScopeChecker::reportError(AST::OperandNode& node, DiagnosticConstants::Code code, int number) {
     int line = node.getLine();
-    // Run a regex template (this one with explicit bounds) to determine if the operand is in scope
-    if (!std::regex_match(node.getNodeValue(), registerTemplate)) {
-#pragma omp critical
-        {
-            m_invalidLines[line] += "\nScope error at line " + std::to_string(line + 1) + ": " + m_codeLines[line] + "\n" + "Register '" + node.getNodeValue() + "' is out of range. Max register is r9\n";
-        }
+    Diagnostic error{DiagnosticConstants::SCOPE, code, line};
+    error.number = number;
+    error.args[0] = node.getNodeValue();
+    DiagnosticEngine::setTextSpan(error, m_source->line(line - 1), error.args[0]);
+    m_diagnostics->report(std::move(error));
+}
+
+
+void ScopeChecker::visit(AST::RegisterOperand& node) {
+    // Only single digit registers (r0 to r9) are in scope
+    const std::string& value = node.getNodeValue();
+    if (!m_diagnostics->full(DiagnosticConstants::SCOPE, node.getLine()) && !(value.size() == 2 && value[1] >= '0' && value[1] <= '9')) {
+        reportError(node, DiagnosticConstants::REGISTER_OUT_OF_RANGE);
     }
 }
 
 void ScopeChecker::visit(AST::MemoryAddressOperand& node) {
-    int line = node.getLine();
-    if (!std::regex_match(node.getNodeValue(), memoryTemplate)) {
-#pragma omp critical
-        {
-            m_invalidLines[line] += "\nScope error at line " + std::to_string(line + 1) + ": " + m_codeLines[line] + "\n" + "Memory address '" + node.getNodeValue() + "' is out of range. Max address is m<999999999>\n";
-        }
+    size_t digits = countDigits(node.getNodeValue(), 2);
+    if (!m_diagnostics->full(DiagnosticConstants::SCOPE, node.getLine()) && (digits == 0 || digits > MAX_ADDRESS_DIGITS)) {
+        reportError(node, DiagnosticConstants::MEMORY_OUT_OF_RANGE);
     }
 }
 
 void ScopeChecker::visit(AST::InstructionAddressOperand& node) {
-    int line = node.getLine();
+    if (m_diagnostics->full(DiagnosticConstants::SCOPE, node.getLine())) {
+        return;
+    }
     // Instruction address both has to adhere to StartASM bounds (4 byte address) and the number of instructions themselves
-    // First get the actual instruction index
-    std::string localInstructionIndex;
-    for (int k = 2; k < node.getNodeValue().size() - 1; k++) {
-        localInstructionIndex += node.getNodeValue()[k];
+    // First get the actual instruction index, saturating instead of overflowing on very long addresses
+    const std::string& value = node.getNodeValue();
+    size_t digits = countDigits(value, 2);
+    long long index = 0;
+    for (size_t k = 2; k < 2 + digits && index <= m_numLines; k++) {
+        index = index * 10 + (value[k] - '0');
     }
     // If the given instruction index is greater than the number of lines
-    if ((std::stoi(localInstructionIndex) > m_codeLines.size())) {
-#pragma omp critical
-        {
-            m_invalidLines[line] += "\nScope error at line " + std::to_string(line + 1) + ": " + m_codeLines[line] + "\n" + "Instruction address '" + node.getNodeValue() + "' is out of range. Expected i[0]-i[" + std::to_string(m_codeLines.size()) + "]\n";
-        }
+    if (index > m_numLines) {
+        reportError(node, DiagnosticConstants::INSTRUCTION_OUT_OF_PROGRAM, m_numLines);
     }
         // If the instruction index is larger than the StartASM limit
-    else if (!std::regex_match(node.getNodeValue(), instructionTemplate)) {
-#pragma omp critical
-        {
-            m_invalidLines[line] += "\nScope error at line " + std::to_string(line + 1) + ": " + m_codeLines[line] + "\n" + "Instruction address '" + node.getNodeValue() + "' is out of range. Max address is i[999999999]\n";
-        }
+    else if (digits == 0 || digits > MAX_ADDRESS_DIGITS) {
+        reportError(node, DiagnosticConstants::INSTRUCTION_OUT_OF_RANGE);
     }
 }
-
@@ -2,36 +2,33 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 
 using namespace std;
 using namespace AST;
 using namespace ASTConstants;
 
-SemanticAnalyzer::SemanticAnalyzer(std::vector<std::string>& lines) : m_lines(lines) {
-    // Initialization code if needed
-}
-bool SemanticAnalyzer::analyzeSemantics(AST::ASTNode *AST, std::string &errorMessage) {
-    //Prepopulate the local semantic context - an operation will never have >3 operands
-    std::vector<ASTConstants::OperandType> localContext(3, ASTConstants::EMPTY); //Set initial operands to empty for easier matching
-    //Perallocate the global semantic context based on the number of lines
-    m_semanticContext = std::vector<std::vector<ASTConstants::OperandType>>(m_lines.size()+1, localContext);
+bool SemanticAnalyzer::analyzeSemantics(AST::ASTNode *AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source) {
+    beginAnalysis(diagnostics, std::move(source));
 
     //Visit the root and iterate over the AST
     AST->accept(*this);
 
     //Clear the context
-    m_semanticContext.clear();
-
-    //Concatenate status message string with all error messages
-    for (const auto& pair : m_invalidLines) {
-        errorMessage += pair.second;
-    }
+    endAnalysis();
 
     //Return true if no errors, false otherwise
-    if (!errorMessage.empty()) {
-        return false;
-    }
-    return true;
+    return !diagnostics.hasErrors(DiagnosticConstants::SEMANTICS);
+}
+
+void SemanticAnalyzer::beginAnalysis(DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source) {
+    //Share the source buffer for error reporting
+    m_source = std::move(source);
+    m_diagnostics = &diagnostics;
+    //Prepopulate the local semantic context - an operation will never have >3 operands
+    std::vector<ASTConstants::OperandType> localContext(3, ASTConstants::EMPTY); //Set initial operands to empty for easier matching
+    //Perallocate the global semantic context based on the number of lines
+    m_semanticContext = std::vector<std::vector<ASTConstants::OperandType>>(m_source->numLines()+1, localContext);
 }
 
 void SemanticAnalyzer::visit(AST::RootNode& node)  {}
@@ -365,91 +362,51 @@ void SemanticAnalyzer::visit(AST::JumpConditionOperand& node) {
 }
 
 void SemanticAnalyzer::handleAtomicInstructionError(int line, const std::vector<ASTConstants::OperandType> &expectedTemplate, AST::InstructionNode &node) {
-    //Create the invalid line log first
-    string errorLine = "Invalid syntax at line " + to_string(line) + ": " + m_lines[line-1] + "\n";
-    vector<ASTConstants::OperandType> localContext = m_semanticContext[line];
+    //Stop recording once the error cap holds errors sorting before this line
+    if (m_diagnostics->full(DiagnosticConstants::SEMANTICS, line)) {
+        return;
+    }
+    const vector<ASTConstants::OperandType>& localContext = m_semanticContext[line];
     //Check every mismatched operand
     for (int i=0; i<localContext.size(); i++) {
         if (localContext[i] != expectedTemplate[i]) {
-            if (expectedTemplate[i] != EMPTY) {
-                //Unrecognized operand if not expecting an empty space
-                 errorLine += "Unrecognized operand '" + node.childAt(i)->getNodeValue() + "'. Expected " + enumToString(expectedTemplate[i]) + "\n\n";
-            }
-            else {
-                //Excess operand if expecting an empty space
-                errorLine += "Unexpected extra operand '" + node.childAt(i)->getNodeValue() + "'\n\n";
-            }
+            //An expected empty space records an excess operand, anything else an unrecognized one
+            reportOperandError(line, i, expectedTemplate[i] != EMPTY ? (1u << expectedTemplate[i]) : 0, node);
         }
     }
-    //Add to the invalid lines map
-    #pragma omp critical
-    {
-        m_invalidLines[line] = errorLine;
-    };
 }
 
 void SemanticAnalyzer::handleMultipleInstructionError(int line, const std::vector<std::unordered_set<ASTConstants::OperandType>> &expectedTemplate, AST::InstructionNode &node) {
-    //Create the invalid line log first
+    if (m_diagnostics->full(DiagnosticConstants::SEMANTICS, line)) {
+        return;
+    }
     const unordered_set<ASTConstants::OperandType> emptyTemplate = {EMPTY};
-    string errorLine = "Invalid syntax at line " + to_string(line) + ": " + m_lines[line-1] + "\n";
-    vector<ASTConstants::OperandType> localContext = m_semanticContext[line];
+    const vector<ASTConstants::OperandType>& localContext = m_semanticContext[line];
 
     //Iterate over all given operands in the local context
     for (int i=0; i<localContext.size(); i++) {
         //If a local context token doesn't match any in the template for that index
         if (expectedTemplate[i].find(localContext[i]) == expectedTemplate[i].end()) {
+            //Collect all possible expected operands
+            std::uint32_t expected = 0;
             if (expectedTemplate[i] != emptyTemplate) {
-                errorLine += "Unrecognized operand '" + node.childAt(i)->getNodeValue() + "'. Expected ";
-                //Add all possible expected operands
-                for (auto it = expectedTemplate[i].begin(); it != expectedTemplate[i].end(); ++it) {
-                    if (it != expectedTemplate[i].begin()) {
-                        errorLine += " or ";
-                    }
-                    errorLine += enumToString(*it);
+                for (auto type : expectedTemplate[i]) {
+                    expected |= 1u << type;
                 }
-                errorLine += "\n\n";
-            }
-            else {
-                //Excess operand if expecting an empty space
-                errorLine += "Unexpected extra operand '" + node.childAt(i)->getNodeValue() + "'\n\n";
             }
+            reportOperandError(line, i, expected, node);
         }
     }
-    //Add to the invalid lines map
-    #pragma omp critical
-    {
-        m_invalidLines[line] = errorLine;
-    };
 }
 
-string SemanticAnalyzer::enumToString(OperandType type) {
-    //This method simply switches an OperandType with a string outlining the expected operand for easy error printing
-    switch (type) {
-        case REGISTER:
-            return "register r0-r9";
-        case INSTRUCTIONADDRESS:
-            return "instruction address i[...]";
-        case MEMORYADDRESS:
-            return "memory address m<...>";
-        case INTEGER:
-            return "integer";
-        case FLOAT:
-            return "float";
-        case BOOLEAN:
-            return "boolean";
-        case CHARACTER:
-            return "character";
-        case STRING:
-            return "comment string";
-        case NEWLINE:
-            return "newline";
-        case TYPECONDITION:
-            return "type condition: integer/float/boolean/character/memory/instruction";
-        case SHIFTCONDITION:
-            return "shift condition: left/right";
-        case JUMPCONDITION:
-            return "jump condition: unconditional/greater/less/equal/zero/unequal/nonzero";
-        default:
-            return "undefined";
+void SemanticAnalyzer::reportOperandError(int line, int pos, std::uint32_t expected, AST::InstructionNode &node) {
+    //An empty expected set means the operand is an excess one
+    Diagnostic error{DiagnosticConstants::SEMANTICS, expected != 0 ? DiagnosticConstants::UNRECOGNIZED_OPERAND : DiagnosticConstants::UNEXPECTED_OPERAND, line};
+    error.expected = expected;
+    AST::ASTNode* operand = node.childAt(pos);
+    if (operand != nullptr) {
+        error.args[0] = operand->getNodeValue();
+        DiagnosticEngine::setTextSpan(error, m_source->line(line-1), error.args[0]);
     }
+    m_diagnostics->report(std::move(error));
 }
@@ -0,0 +1,474 @@
+#include "session/CompilationSession.h"
+#include "lexer/Lexer.h"
+#include "parser/Parser.h"
+#include "pt/ParseTree.h"
+#include "ast/AbstractSyntaxTree.h"
+#include "ast/ASTBuilder.h"
+#include "scopecheck/ScopeChecker.h"
+#include "semantics/SemanticAnalyzer.h"
+#include "parallel/TaskScheduler.h"
+#include "source/SourceBuffer.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    //Same whitespace set as the source buffer, so both agree on which lines are code
+    bool isBlank(string_view line) {
+        return all_of(line.begin(), line.end(), [](char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+        });
+    }
+
+    //Index of an i[N] operand, saturated above any program length (the lexer guarantees the digits)
+    long long addressIndex(const string& value) {
+        long long index = 0;
+        for (size_t k = 2; k + 1 < value.size() && index <= INT_MAX; k++) {
+            index = index * 10 + (value[k] - '0');
+        }
+        return index;
+    }
+
+    //Replace items [begin, end) of a vector, moving the tail only if the number of items changes
+    template <typename T>
+    void replaceRange(vector<T>& items, size_t begin, size_t end, const vector<T>& replacement) {
+        size_t overlap = min(end - begin, replacement.size());
+        copy(replacement.begin(), replacement.begin() + overlap, items.begin() + begin);
+        if (replacement.size() > overlap) {
+            items.insert(items.begin() + begin + overlap, replacement.begin() + overlap, replacement.end());
+        }
+        else {
+            items.erase(items.begin() + begin + overlap, items.begin() + end);
+        }
+    }
+
+    //Remove a single occurrence of an id
+    template <typename T>
+    void eraseOne(vector<T>& items, T item) {
+        auto itr = find(items.begin(), items.end(), item);
+        if (itr != items.end()) {
+            items.erase(itr);
+        }
+    }
+}
+
+CompilationSession::CompilationSession(int maxErrors) : m_maxErrors(maxErrors > 0 ? maxErrors : 0) {}
+
+void CompilationSession::open(string_view text) {
+    m_text.clear();
+    m_positions.clear();
+    m_freeIds.clear();
+    m_fileLines.clear();
+    m_codeLines.clear();
+    m_states.clear();
+    m_labels.clear();
+    m_duplicateLabels.clear();
+    m_undefinedLabels.clear();
+    m_parseErrors.clear();
+    m_checkErrors.clear();
+    m_addresses.clear();
+
+    //Split on newlines the way the source buffer does, then analyze the document as one big edit
+    vector<string> lines;
+    size_t start = 0;
+    while (true) {
+        size_t end = text.find('\n', start);
+        if (end == string_view::npos) {
+            lines.emplace_back(text.substr(start));
+            break;
+        }
+        lines.emplace_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    edit(0, 0, lines);
+}
+
+void CompilationSession::edit(int firstLine, int endLine, const vector<string>& lines) {
+    int numFileLines = numLines();
+    firstLine = clamp(firstLine, 0, numFileLines);
+    endLine = clamp(endLine, firstLine, numFileLines);
+    int previousCodeLines = numCodeLines();
+    //Code lines covered by the edited file lines
+    int codeBegin = firstLine < numFileLines ? m_positions[m_fileLines[firstLine]].codeLine : previousCodeLines;
+    int codeEnd = endLine < numFileLines ? m_positions[m_fileLines[endLine]].codeLine : previousCodeLines;
+
+    for (int i = firstLine; i < endLine; i++) {
+        removeLine(m_fileLines[i]);
+    }
+    vector<LineId> added;
+    vector<LineId> addedCode;
+    added.reserve(lines.size());
+    for (const string& line : lines) {
+        LineId id = addLine(line);
+        added.push_back(id);
+        if (m_positions[id].code) {
+            addedCode.push_back(id);
+        }
+    }
+    replaceRange(m_fileLines, firstLine, endLine, added);
+    replaceRange(m_codeLines, codeBegin, codeEnd, addedCode);
+    updatePositions(firstLine, firstLine + static_cast<int>(added.size()));
+
+    //Literal instruction addresses between the old and new program length flip their bound check
+    vector<LineId> touched = std::move(addedCode);
+    int low = min(previousCodeLines, numCodeLines());
+    int high = max(previousCodeLines, numCodeLines());
+    for (auto itr = m_addresses.upper_bound(low); itr != m_addresses.end() && itr->first <= high; ++itr) {
+        touched.push_back(itr->second);
+    }
+    analyze(touched);
+}
+
+vector<Diagnostic> CompilationSession::diagnostics() const {
+    //Diagnostics are replayed into an engine in the order a full compile reports them, so the error cap drops the same ones
+    DiagnosticEngine engine(m_maxErrors);
+    auto sortedLines = [this](const unordered_set<LineId>& ids) {
+        vector<LineId> lines(ids.begin(), ids.end());
+        sort(lines.begin(), lines.end(), [this](LineId a, LineId b) {
+            return m_positions[a].codeLine < m_positions[b].codeLine;
+        });
+        return lines;
+    };
+    auto replay = [this, &engine](LineId id, DiagnosticConstants::Phase phase) {
+        for (const Diagnostic& stored : m_states.at(id).diagnostics) {
+            if (stored.phase == phase) {
+                Diagnostic diagnostic = stored;
+                diagnostic.line = m_positions[id].codeLine + 1;
+                //Addresses past the end of the program report its current length
+                if (diagnostic.code == DiagnosticConstants::INSTRUCTION_OUT_OF_PROGRAM) {
+                    diagnostic.number = numCodeLines();
+                }
+                engine.report(std::move(diagnostic));
+            }
+        }
+    };
+
+    //Parse errors hide every other diagnostic
+    if (!m_parseErrors.empty()) {
+        for (LineId id : sortedLines(m_parseErrors)) {
+            if (engine.full(DiagnosticConstants::PARSER, m_positions[id].codeLine + 1)) {
+                break;
+            }
+            replay(id, DiagnosticConstants::PARSER);
+        }
+        return engine.collect();
+    }
+
+    //Duplicate declarations in line order - the first declaration of a label wins
+    vector<Diagnostic> duplicates;
+    for (const string& name : m_duplicateLabels) {
+        vector<LineId> declarations = m_labels.at(name).declarations;
+        sort(declarations.begin(), declarations.end(), [this](LineId a, LineId b) {
+            return m_positions[a].codeLine < m_positions[b].codeLine;
+        });
+        for (size_t i = 1; i < declarations.size(); i++) {
+            Diagnostic error{DiagnosticConstants::SYMBOLS, DiagnosticConstants::DUPLICATE_LABEL, m_positions[declarations[i]].codeLine + 1};
+            error.number = m_positions[declarations[0]].codeLine + 1;
+            error.args[0] = name;
+            DiagnosticEngine::setTokenSpan(error, m_text[declarations[i]], 1);
+            duplicates.push_back(std::move(error));
+        }
+    }
+    sort(duplicates.begin(), duplicates.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        return a.line < b.line;
+    });
+    for (Diagnostic& error : duplicates) {
+        engine.report(std::move(error));
+    }
+    //Then uses of undeclared labels, in line and operand order
+    vector<pair<int, Diagnostic>> undefined;
+    for (const string& name : m_undefinedLabels) {
+        vector<LineId> uses = m_labels.at(name).uses;
+        sort(uses.begin(), uses.end());
+        uses.erase(unique(uses.begin(), uses.end()), uses.end());
+        for (LineId id : uses) {
+            const auto& lineUses = m_states.at(id).uses;
+            for (size_t k = 0; k < lineUses.size(); k++) {
+                if (lineUses[k].first == name) {
+                    Diagnostic error{DiagnosticConstants::SYMBOLS, DiagnosticConstants::UNDEFINED_LABEL, m_positions[id].codeLine + 1};
+                    error.args[0] = name;
+                    DiagnosticEngine::setTokenSpan(error, m_text[id], lineUses[k].second);
+                    undefined.emplace_back(static_cast<int>(k), std::move(error));
+                }
+            }
+        }
+    }
+    sort(undefined.begin(), undefined.end(), [](const pair<int, Diagnostic>& a, const pair<int, Diagnostic>& b) {
+        return a.second.line != b.second.line ? a.second.line < b.second.line : a.first < b.first;
+    });
+    for (auto& error : undefined) {
+        if (engine.full(DiagnosticConstants::SYMBOLS, error.second.line)) {
+            break;
+        }
+        engine.report(std::move(error.second));
+    }
+    //Label errors hide scope and semantic errors
+    if (engine.hasErrors(DiagnosticConstants::SYMBOLS)) {
+        return engine.collect();
+    }
+
+    //Bound label addresses never leave the program, so the remaining diagnostics all come from single lines
+    vector<LineId> lines = sortedLines(m_checkErrors);
+    for (DiagnosticConstants::Phase phase : {DiagnosticConstants::SCOPE, DiagnosticConstants::SEMANTICS}) {
+        for (LineId id : lines) {
+            replay(id, phase);
+        }
+    }
+    return engine.collect();
+}
+
+int CompilationSession::codeLine(int fileLine) const {
+    const Position& position = m_positions[m_fileLines[fileLine]];
+    return position.code ? position.codeLine : -1;
+}
+
+string CompilationSession::text() const {
+    string text;
+    for (size_t i = 0; i < m_fileLines.size(); i++) {
+        if (i > 0) {
+            text += '\n';
+        }
+        text += m_text[m_fileLines[i]];
+    }
+    return text;
+}
+
+vector<int> CompilationSession::labelDeclarations(const string& label) const {
+    auto itr = m_labels.find(label);
+    return itr != m_labels.end() ? fileLines(itr->second.declarations) : vector<int>();
+}
+
+vector<int> CompilationSession::labelUses(const string& label) const {
+    auto itr = m_labels.find(label);
+    return itr != m_labels.end() ? fileLines(itr->second.uses) : vector<int>();
+}
+
+vector<int> CompilationSession::fileLines(const vector<LineId>& ids) const {
+    vector<int> lines;
+    lines.reserve(ids.size());
+    for (LineId id : ids) {
+        lines.push_back(m_positions[id].fileLine);
+    }
+    sort(lines.begin(), lines.end());
+    lines.erase(unique(lines.begin(), lines.end()), lines.end());
+    return lines;
+}
+
+CompilationSession::LineId CompilationSession::addLine(string text) {
+    LineId id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else {
+        id = static_cast<LineId>(m_text.size());
+        m_text.emplace_back();
+        m_positions.emplace_back();
+    }
+    m_positions[id].code = !isBlank(text);
+    m_text[id] = std::move(text);
+    return id;
+}
+
+void CompilationSession::removeLine(LineId id) {
+    detach(id);
+    string().swap(m_text[id]);
+    m_freeIds.push_back(id);
+}
+
+void CompilationSession::updatePositions(int firstLine, int stableLine) {
+    int code = 0;
+    if (firstLine > 0) {
+        const Position& previous = m_positions[m_fileLines[firstLine - 1]];
+        code = previous.codeLine + (previous.code ? 1 : 0);
+    }
+    for (int i = firstLine; i < numLines(); i++) {
+        Position& position = m_positions[m_fileLines[i]];
+        //Past the edited lines, the first line already in place means every following one is as well
+        if (i >= stableLine && position.fileLine == i && position.codeLine == code) {
+            break;
+        }
+        position.fileLine = i;
+        position.codeLine = code;
+        if (position.code) {
+            code++;
+        }
+    }
+}
+
+void CompilationSession::analyze(vector<LineId>& ids) {
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    for (LineId id : ids) {
+        detach(id);
+    }
+    //Batches only read the session, so a large edit (such as opening a document) is analyzed in parallel
+    //Each batch is already a thousand lines of work, so any two of them may run on separate threads
+    int numIds = static_cast<int>(ids.size());
+    int numBatches = (numIds + SessionConstants::BATCH_LINES - 1) / SessionConstants::BATCH_LINES;
+    vector<LineState> states(ids.size());
+    TaskScheduler::instance().parallelFor(0, numBatches, [&](int begin, int end) {
+        for (int batch = begin; batch < end; batch++) {
+            int first = batch * SessionConstants::BATCH_LINES;
+            int count = min(static_cast<int>(SessionConstants::BATCH_LINES), numIds - first);
+            analyzeBatch(ids.data() + first, count, states.data() + first);
+        }
+    }, 1);
+    for (int i = 0; i < numIds; i++) {
+        attach(ids[i], std::move(states[i]));
+    }
+}
+
+void CompilationSession::analyzeBatch(const LineId* ids, int count, LineState* states) const {
+    //The batch is joined into a source of its own, so every phase sees its lines as consecutive code lines
+    string text;
+    for (int i = 0; i < count; i++) {
+        text += m_text[ids[i]];
+        text += '\n';
+    }
+    shared_ptr<const SourceBuffer> source = SourceBuffer::fromString(std::move(text));
+
+    Lexer lexer;
+    Parser parser;
+    ASTBuilder builder;
+    ScopeChecker scopeChecker;
+    SemanticAnalyzer semanticAnalyzer;
+    AST::AbstractSyntaxTree abstractSyntaxTree;
+    PT::ParseTree parseTree;
+    DiagnosticEngine diagnostics;
+    scopeChecker.beginChecks(diagnostics, source);
+    scopeChecker.setProgramLines(numCodeLines());
+    semanticAnalyzer.beginAnalysis(diagnostics, source);
+
+    vector<Parser::Tokens> tokens;
+    lexer.tokenizeLines(*source, 0, count, tokens);
+    vector<Parser::Tokens> lineTokens(1);
+    for (int i = 0; i < count; i++) {
+        LineState& state = states[i];
+        //Lines are parsed one at a time, so a failed line never shifts the parse tree nodes of the next
+        lineTokens[0] = std::move(tokens[i]);
+        int numParsed = parseTree.getRoot()->getNumChildren();
+        if (!parser.parseLines(&parseTree, *source, lineTokens, i, diagnostics)) {
+            state.parseFailed = true;
+            continue;
+        }
+        PT::PTNode* PTInstructionNode = parseTree.getRoot()->childAt(numParsed);
+
+        //Turn label operands into instruction address placeholders, as the front end does before binding them
+        std::uint8_t placeholders = 0;
+        for (int j = 0; j < PTInstructionNode->getNumChildren(); j++) {
+            auto labelNode = dynamic_cast<PT::OperandNode*>(PTInstructionNode->childAt(j)->childAt(0));
+            if (labelNode != nullptr && labelNode->getOperandType() == PTConstants::OperandType::LABEL) {
+                //A declaration also counts as a use of itself, which always binds, so it isn't recorded
+                if (PTInstructionNode->getNodeValue() == "label") {
+                    state.declaration = labelNode->getNodeValue();
+                }
+                else {
+                    state.uses.emplace_back(labelNode->getNodeValue(), labelNode->getIndex());
+                }
+                labelNode->setOperandType(PTConstants::OperandType::INSTRUCTIONADDRESS);
+                placeholders |= static_cast<std::uint8_t>(1u << j);
+            }
+        }
+
+        std::unique_ptr<AST::InstructionNode> instruction(builder.buildInstruction(PTInstructionNode, &abstractSyntaxTree, i + 1));
+        if (instruction == nullptr) {
+            continue;
+        }
+        semanticAnalyzer.analyzeNode(*instruction);
+        for (int j = 0; j < instruction->getNumChildren(); j++) {
+            auto operand = static_cast<AST::OperandNode*>(instruction->childAt(j));
+            if (placeholders & (1u << operand->getPos())) {
+                continue;
+            }
+            scopeChecker.checkNode(*operand);
+            if (operand->getOperandType() == ASTConstants::INSTRUCTIONADDRESS) {
+                state.addresses.push_back(addressIndex(operand->getNodeValue()));
+            }
+        }
+    }
+    semanticAnalyzer.endAnalysis();
+
+    //Hand each diagnostic to its line, which numbers it once it is reported
+    for (Diagnostic& diagnostic : diagnostics.collect()) {
+        int index = diagnostic.line - 1;
+        diagnostic.line = DiagnosticConstants::NO_LINE;
+        states[index].diagnostics.push_back(std::move(diagnostic));
+    }
+}
+
+void CompilationSession::attach(LineId id, LineState state) {
+    if (state.empty()) {
+        return;
+    }
+    if (state.parseFailed) {
+        m_parseErrors.insert(id);
+    }
+    else if (!state.diagnostics.empty()) {
+        m_checkErrors.insert(id);
+    }
+    if (!state.declaration.empty()) {
+        m_labels[state.declaration].declarations.push_back(id);
+        updateLabel(state.declaration);
+    }
+    for (const auto& use : state.uses) {
+        m_labels[use.first].uses.push_back(id);
+        updateLabel(use.first);
+    }
+    for (long long index : state.addresses) {
+        m_addresses.emplace(index, id);
+    }
+    m_states.emplace(id, std::move(state));
+}
+
+void CompilationSession::detach(LineId id) {
+    auto itr = m_states.find(id);
+    if (itr == m_states.end()) {
+        return;
+    }
+    const LineState& state = itr->second;
+    m_parseErrors.erase(id);
+    m_checkErrors.erase(id);
+    if (!state.declaration.empty()) {
+        eraseOne(m_labels[state.declaration].declarations, id);
+        updateLabel(state.declaration);
+    }
+    for (const auto& use : state.uses) {
+        eraseOne(m_labels[use.first].uses, id);
+        updateLabel(use.first);
+    }
+    for (long long index : state.addresses) {
+        auto range = m_addresses.equal_range(index);
+        for (auto address = range.first; address != range.second; ++address) {
+            if (address->second == id) {
+                m_addresses.erase(address);
+                break;
+            }
+        }
+    }
+    m_states.erase(itr);
+}
+
+void CompilationSession::updateLabel(const string& name) {
+    auto itr = m_labels.find(name);
+    const Label& label = itr->second;
+    if (label.declarations.size() > 1) {
+        m_duplicateLabels.insert(name);
+    }
+    else {
+        m_duplicateLabels.erase(name);
+    }
+    if (label.declarations.empty() && !label.uses.empty()) {
+        m_undefinedLabels.insert(name);
+    }
+    else {
+        m_undefinedLabels.erase(name);
+    }
+    if (label.declarations.empty() && label.uses.empty()) {
+        m_labels.erase(itr);
+    }
+}
@@ -0,0 +1,64 @@
+#include "source/SourceBuffer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+SourceBuffer::SourceBuffer(std::string text) : m_text(std::move(text)) {
+    indexLines();
+}
+
+shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const string& pathname) {
+    string text;
+    //If file can't be read, return an empty pointer
+    if (!readFile(pathname, text)) {
+        return nullptr;
+    }
+    return fromString(std::move(text));
+}
+
+bool SourceBuffer::readFile(const string& pathname, string& text) {
+    //Open the file in binary mode so the buffer matches the file byte for byte
+    ifstream file(pathname, ios::in | ios::binary | ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    //Read the whole file with a single read, sized from the end position
+    streamoff size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    text.assign(static_cast<size_t>(size), '\0');
+    return static_cast<bool>(file.seekg(0).read(text.data(), size));
+}
+
+shared_ptr<const SourceBuffer> SourceBuffer::fromString(string text) {
+    //Constructor is private, so make_shared can't be used here
+    return shared_ptr<const SourceBuffer>(new SourceBuffer(std::move(text)));
+}
+
+void SourceBuffer::indexLines() {
+    size_t start = 0;
+    const size_t size = m_text.size();
+    //Size the index up front (an upper bound, as blank lines are skipped) to avoid regrowing it on huge files
+    m_lines.reserve(count(m_text.begin(), m_text.end(), '\n') + 1);
+    //Loop through every line in the buffer
+    while (start < size) {
+        size_t end = m_text.find('\n', start);
+        if (end == string::npos) {
+            end = size;
+        }
+        //Only index the line if it is not just whitespace
+        for (size_t i = start; i < end; i++) {
+            char c = m_text[i];
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\f' && c != '\v') {
+                m_lines.push_back({start, static_cast<uint32_t>(end - start)});
+                break;
+            }
+        }
+        start = end + 1;
+    }
+}
@@ -0,0 +1,354 @@
+#include "typeinfer/TypeInference.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace TypeConstants;
+using namespace RuntimeConstants;
+
+namespace {
+    constexpr TypeSet typeBit(ValueType type) {
+        return static_cast<TypeSet>(1u << type);
+    }
+
+    //Types accepted by each runtime check (see CodeGenerator)
+    constexpr TypeSet DEFINED = ALL_TYPES & ~typeBit(UNDEFINED);
+    constexpr TypeSet NUMERIC = typeBit(INTEGER) | typeBit(FLOAT) | typeBit(CHARACTER);
+    constexpr TypeSet ARITHMETIC = NUMERIC | typeBit(MEMORY) | typeBit(INSTRUCTION);
+
+    //Register index of a register operand (the scope checker guarantees r0-r9)
+    int registerIndex(const AST::ASTNode* node) {
+        return node->getNodeValue()[1] - '0';
+    }
+
+    //Index of an i[N] operand (the scope checker guarantees it fits)
+    int addressIndex(const AST::ASTNode* node) {
+        return static_cast<int>(strtol(node->getNodeValue().c_str() + 2, nullptr, 10));
+    }
+
+    ASTConstants::OperandType operandType(const AST::ASTNode* node) {
+        return static_cast<const AST::OperandNode*>(node)->getOperandType();
+    }
+
+    ValueType typeOf(const string& typeCondition) {
+        if (typeCondition == "integer") return INTEGER;
+        if (typeCondition == "float") return FLOAT;
+        if (typeCondition == "boolean") return BOOLEAN;
+        if (typeCondition == "character") return CHARACTER;
+        if (typeCondition == "memory") return MEMORY;
+        return INSTRUCTION;
+    }
+
+    bool isRegisterJump(const AST::InstructionNode* instruction) {
+        switch (instruction->getInstructionType()) {
+            case ASTConstants::JUMP:
+            case ASTConstants::CALL:
+                return operandType(instruction->getChildren().back()) == ASTConstants::REGISTER;
+            case ASTConstants::RETURN:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    //Whether an instruction could compute an instruction address, whatever the types of its registers
+    bool mayComputeAddress(const AST::InstructionNode* instruction) {
+        switch (instruction->getInstructionType()) {
+            case ASTConstants::ADD:
+            case ASTConstants::SUB:
+            case ASTConstants::OR:
+            case ASTConstants::AND:
+            case ASTConstants::NOT:
+                return true;
+            case ASTConstants::CAST:
+            case ASTConstants::INPUT:
+                return typeOf(instruction->getChildren()[0]->getNodeValue()) == INSTRUCTION;
+            default:
+                return false;
+        }
+    }
+
+    //Lines an instruction address held in a register may point to without being computed - created addresses, return
+    //addresses and literal instruction addresses (i[0] being the first line, the line past the end exiting)
+    vector<int> addressTargets(const vector<AST::ASTNode*>& instructions) {
+        int numLines = static_cast<int>(instructions.size());
+        vector<char> targets(numLines + 1, false);
+        for (auto* child : instructions) {
+            auto* instruction = static_cast<const AST::InstructionNode*>(child);
+            const auto& operands = instruction->getChildren();
+            for (auto* operand : operands) {
+                if (operandType(operand) == ASTConstants::INSTRUCTIONADDRESS && addressIndex(operand) <= numLines) {
+                    targets[max(addressIndex(operand), 1)] = true;
+                }
+            }
+            if (instruction->getInstructionType() == ASTConstants::CALL && instruction->getLine() < numLines) {
+                targets[instruction->getLine() + 1] = true;
+            }
+            else if (instruction->getInstructionType() == ASTConstants::CREATE && typeOf(operands[0]->getNodeValue()) == INSTRUCTION) {
+                //Created from an integer, or from the index of an address (see CodeGenerator)
+                bool address = operandType(operands[1]) == ASTConstants::INSTRUCTIONADDRESS || operandType(operands[1]) == ASTConstants::MEMORYADDRESS;
+                long long target = strtoll(operands[1]->getNodeValue().c_str() + (address ? 2 : 0), nullptr, 10);
+                if (target >= 0 && target <= numLines) {
+                    targets[max(static_cast<int>(target), 1)] = true;
+                }
+            }
+        }
+        vector<int> lines;
+        for (int line = 1; line <= numLines; line++) {
+            if (targets[line]) {
+                lines.push_back(line);
+            }
+        }
+        return lines;
+    }
+
+    //Every line of the program
+    vector<int> allLines(int numLines) {
+        vector<int> lines(numLines);
+        for (int line = 1; line <= numLines; line++) {
+            lines[line - 1] = line;
+        }
+        return lines;
+    }
+
+    //Narrow a register to the types a check accepts, false if it holds none of them
+    bool narrow(RegisterTypes& types, const AST::ASTNode* node, TypeSet accepted) {
+        TypeSet& held = types[registerIndex(node)];
+        held &= accepted;
+        return held != NO_TYPES;
+    }
+}
+
+bool TypeInference::inferTypes(AST::ASTNode* AST, DiagnosticEngine& diagnostics, std::shared_ptr<const SourceBuffer> source) {
+    m_diagnostics = &diagnostics;
+    m_source = std::move(source);
+    const auto& instructions = AST->getChildren();
+    int numLines = static_cast<int>(instructions.size());
+
+    //Without jumps through registers there are no dynamic targets, otherwise first assume any arithmetic may compute
+    //an address. If none can with the inferred types, the analysis is rerun with only the addresses the program makes,
+    //which can only narrow the types - so no address is computed on the second run either
+    bool dynamic = false;
+    bool arithmetic = false;
+    for (auto* child : instructions) {
+        auto* instruction = static_cast<const AST::InstructionNode*>(child);
+        dynamic = dynamic || isRegisterJump(instruction);
+        arithmetic = arithmetic || mayComputeAddress(instruction);
+    }
+    m_dynamicTargets = dynamic && arithmetic ? allLines(numLines) : addressTargets(instructions);
+    solve(instructions);
+    m_computed = false;
+    for (int line = 1; line <= numLines && !m_computed; line++) {
+        m_computed = m_types[line][0] != NO_TYPES && computesAddress(instructions[line - 1]);
+    }
+    if (dynamic && arithmetic && !m_computed) {
+        m_dynamicTargets = addressTargets(instructions);
+        solve(instructions);
+    }
+    std::vector<int>().swap(m_dynamicTargets);
+    std::vector<char>().swap(m_queued);
+
+    //Only reachable lines are checked, and a failed check ends its paths, so every failure is reported once
+    for (int line = 1; line <= numLines; line++) {
+        RegisterTypes types = m_types[line];
+        Failure failure;
+        if (types[0] != NO_TYPES && !transfer(instructions[line - 1], types, failure)) {
+            reportFailure(line, failure);
+        }
+    }
+    return true;
+}
+
+void TypeInference::solve(const std::vector<AST::ASTNode*>& instructions) {
+    int numLines = static_cast<int>(instructions.size());
+    m_types.assign(numLines + 2, RegisterTypes{});
+    m_queued.assign(numLines + 2, false);
+    m_dynamicTypes.fill(NO_TYPES);
+
+    //Registers start out without a value
+    RegisterTypes start;
+    start.fill(typeBit(UNDEFINED));
+    join(1, start);
+    while (!m_worklist.empty()) {
+        int line = m_worklist.back();
+        m_worklist.pop_back();
+        m_queued[line] = false;
+        auto* instruction = static_cast<const AST::InstructionNode*>(instructions[line - 1]);
+        RegisterTypes types = m_types[line];
+        Failure failure;
+        if (!transfer(instruction, types, failure)) {
+            continue;
+        }
+
+        const auto& operands = instruction->getChildren();
+        const AST::ASTNode* target = nullptr;
+        switch (instruction->getInstructionType()) {
+            case ASTConstants::JUMP:
+                if (operands[0]->getNodeValue() != "unconditional") {
+                    join(line + 1, types);
+                }
+                target = operands[1];
+                break;
+            case ASTConstants::CALL:
+                target = operands[0];
+                break;
+            case ASTConstants::RETURN:
+                break;
+            case ASTConstants::STOP:
+                continue;
+            default:
+                join(line + 1, types);
+                continue;
+        }
+        if (target != nullptr && operandType(target) == ASTConstants::INSTRUCTIONADDRESS) {
+            join(max(addressIndex(target), 1), types);
+            continue;
+        }
+        //Jumps through registers and returns continue at any dynamic target
+        bool grew = false;
+        for (int reg = 0; reg < NUM_REGISTERS; reg++) {
+            grew = grew || (types[reg] & ~m_dynamicTypes[reg]) != 0;
+            m_dynamicTypes[reg] |= types[reg];
+        }
+        if (grew) {
+            for (int dynamicTarget : m_dynamicTargets) {
+                join(dynamicTarget, m_dynamicTypes);
+            }
+        }
+    }
+}
+
+bool TypeInference::transfer(const AST::ASTNode* node, RegisterTypes& types, Failure& failure) const {
+    auto* instruction = static_cast<const AST::InstructionNode*>(node);
+    const auto& operands = instruction->getChildren();
+
+    //A register has to hold one of the accepted types
+    auto expect = [&](const AST::ASTNode* operand, TypeSet accepted) {
+        if (narrow(types, operand, accepted)) {
+            return true;
+        }
+        failure = {DiagnosticConstants::UNEXPECTED_TYPE, operand, nullptr, accepted};
+        return false;
+    };
+    //Two registers have to hold the same type, one of the accepted ones, which the result then has
+    auto expectSame = [&](const AST::ASTNode* a, const AST::ASTNode* b, const AST::ASTNode* result, TypeSet accepted) {
+        if (!expect(a, accepted) || !expect(b, accepted)) {
+            return false;
+        }
+        TypeSet same = types[registerIndex(a)] & types[registerIndex(b)];
+        if (same == NO_TYPES) {
+            failure = {DiagnosticConstants::MISMATCHED_TYPES, a, b, accepted};
+            return false;
+        }
+        types[registerIndex(a)] = same;
+        types[registerIndex(b)] = same;
+        if (result != nullptr) {
+            types[registerIndex(result)] = same;
+        }
+        return true;
+    };
+    //Address operands are literals or registers holding an address of the kind
+    auto expectAddress = [&](const AST::ASTNode* operand, ValueType type) {
+        return operandType(operand) != ASTConstants::REGISTER || expect(operand, typeBit(type));
+    };
+
+    switch (instruction->getInstructionType()) {
+        case ASTConstants::MOVE:
+            types[registerIndex(operands[1])] = types[registerIndex(operands[0])];
+            return true;
+        case ASTConstants::LOAD:
+            //Memory is not tracked, so a loaded value may have any type
+            if (!expectAddress(operands[0], MEMORY)) {
+                return false;
+            }
+            types[registerIndex(operands[1])] = ALL_TYPES;
+            return true;
+        case ASTConstants::STORE:
+            return expectAddress(operands[1], MEMORY);
+        case ASTConstants::CREATE:
+            types[registerIndex(operands[2])] = typeBit(typeOf(operands[0]->getNodeValue()));
+            return true;
+        case ASTConstants::CAST:
+        case ASTConstants::INPUT:
+            types[registerIndex(operands[1])] = typeBit(typeOf(operands[0]->getNodeValue()));
+            return true;
+        case ASTConstants::ADD:
+        case ASTConstants::SUB:
+            return expectSame(operands[0], operands[1], operands[2], ARITHMETIC);
+        case ASTConstants::MULTIPLY:
+        case ASTConstants::DIVIDE:
+            return expectSame(operands[0], operands[1], operands[2], NUMERIC);
+        case ASTConstants::OR:
+        case ASTConstants::AND:
+            return expectSame(operands[0], operands[1], operands[0], DEFINED);
+        case ASTConstants::COMPARE:
+            return expectSame(operands[0], operands[1], nullptr, DEFINED);
+        case ASTConstants::NOT:
+        case ASTConstants::OUTPUT:
+            return expect(operands[0], DEFINED);
+        case ASTConstants::SHIFT:
+            return expect(operands[1], typeBit(INTEGER) | typeBit(CHARACTER)) && expect(operands[2], typeBit(INTEGER));
+        case ASTConstants::JUMP:
+        case ASTConstants::CALL:
+            return expectAddress(operands.back(), INSTRUCTION);
+        case ASTConstants::POP:
+            //The stack is not tracked either
+            types[registerIndex(operands[0])] = ALL_TYPES;
+            return true;
+        default:
+            return true;
+    }
+}
+
+void TypeInference::join(int line, const RegisterTypes& types) {
+    //The line past the end exits
+    if (line >= static_cast<int>(m_types.size()) - 1) {
+        return;
+    }
+    bool grew = false;
+    for (int reg = 0; reg < NUM_REGISTERS; reg++) {
+        grew = grew || (types[reg] & ~m_types[line][reg]) != 0;
+        m_types[line][reg] |= types[reg];
+    }
+    if (grew && !m_queued[line]) {
+        m_queued[line] = true;
+        m_worklist.push_back(line);
+    }
+}
+
+bool TypeInference::computesAddress(const AST::ASTNode* node) const {
+    auto* instruction = static_cast<const AST::InstructionNode*>(node);
+    const auto& operands = instruction->getChildren();
+    const RegisterTypes& types = m_types[instruction->getLine()];
+    auto holdsAddress = [&](const AST::ASTNode* operand) {
+        return (types[registerIndex(operand)] & typeBit(INSTRUCTION)) != 0;
+    };
+    switch (instruction->getInstructionType()) {
+        case ASTConstants::ADD:
+        case ASTConstants::SUB:
+        case ASTConstants::OR:
+        case ASTConstants::AND:
+            return holdsAddress(operands[0]) && holdsAddress(operands[1]);
+        case ASTConstants::NOT:
+            return holdsAddress(operands[0]);
+        default:
+            return mayComputeAddress(instruction);
+    }
+}
+
+void TypeInference::reportFailure(int line, const Failure& failure) {
+    const RegisterTypes& types = m_types[line];
+    Diagnostic warning{DiagnosticConstants::TYPES, failure.code, line};
+    warning.args[0] = failure.first->getNodeValue();
+    warning.number = types[registerIndex(failure.first)];
+    warning.expected = failure.expected;
+    if (failure.second != nullptr) {
+        warning.args[1] = failure.second->getNodeValue();
+        warning.number |= types[registerIndex(failure.second)] << 8;
+    }
+    DiagnosticEngine::setTextSpan(warning, m_source->line(line - 1), warning.args[0]);
+    m_diagnostics->report(std::move(warning));
+}
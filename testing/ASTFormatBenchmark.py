@@ -0,0 +1,126 @@
+import random
+import os
+import mmap
+import json
+import struct
+import subprocess
+import time
+import argparse
+
+# Set up argument parsing
+parser = argparse.ArgumentParser(description='Compare the size and load time of the JSON and binary (--format=bin) StartASM AST outputs.')
+parser.add_argument('--sizes', type=int, nargs='+', default=[10000, 100000, 1000000], help='Number of lines of each generated input')
+args = parser.parse_args()
+
+# Define the StartASM executable path
+executable_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'startasm')
+
+# Define the full paths for the generated input and outputs
+base_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'ASTFormatTest')
+source_path = base_path + '.sasm'
+json_path = base_path + '.json'
+binary_path = base_path + '.bin'
+
+# Define some basic parameters
+registers = ['r' + str(i) for i in range(10)]  # List of registers r0-r9
+operations = ['add', 'sub', 'multiply', 'divide', 'move', 'load', 'store']
+
+# Binary AST layout (see include/ast/BinaryAST.h)
+HEADER = struct.Struct('<8sIIIIQQQQ')
+NODE = struct.Struct('<BBhiIII')
+STRING = struct.Struct('<QII')
+NODE_TYPES = ['ROOT', 'INSTRUCTION', 'OPERAND']
+
+
+def generate(num_lines):
+    # Create a valid program of exactly num_lines lines
+    with open(source_path, 'w') as file:
+        file.write("comment \"Automatically generated AST format benchmark input\"\n")
+        for _ in range(max(num_lines - 2, 0)):
+            reg1 = random.choice(registers)
+            reg2 = random.choice(registers)
+            operation = random.choice(operations)
+            value = random.randint(0, 1000)
+            if operation in ['add', 'sub', 'multiply', 'divide']:
+                line = f"{operation} {reg1} with {reg2} to {random.choice(registers)}"
+            elif operation == 'move':
+                line = f"move {reg1} to {reg2}"
+            elif operation == 'load':
+                line = f"load m<{value}> to {reg1}"
+            else:
+                line = f"store {reg1} to m<{value}>"
+            file.write(line + '\n')
+        file.write("stop\n")
+
+
+class BinaryAST:
+    # Minimal in-place reader: records are decoded on access, straight from the mapped file
+    def __init__(self, path):
+        with open(path, 'rb') as file:
+            self.data = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, node_size, self.num_nodes, self.num_strings, self.nodes_offset, self.strings_offset, self.characters_offset, file_size = HEADER.unpack_from(self.data, 0)
+        if magic != b'SASMAST\0' or version != 1 or node_size != NODE.size or file_size != len(self.data):
+            raise ValueError('not a version 1 binary AST')
+
+    def node(self, index):
+        return NODE.unpack_from(self.data, self.nodes_offset + index * NODE.size)
+
+    def string(self, index):
+        offset, length, _ = STRING.unpack_from(self.data, self.strings_offset + index * STRING.size)
+        start = self.characters_offset + offset
+        return self.data[start:start + length].decode()
+
+    def count_nodes(self, index=0):
+        # Walk the whole tree through the child references
+        node_type, kind, detail, line, first_child, num_children, value = self.node(index)
+        return 1 + sum(self.count_nodes(first_child + i) for i in range(num_children))
+
+    def to_json(self, index=0):
+        # Rebuild the JSON form of a node, to check both outputs describe the same tree
+        node_type, kind, detail, line, first_child, num_children, value = self.node(index)
+        result = {'type': NODE_TYPES[node_type], 'value': self.string(value), 'children': [self.to_json(first_child + i) for i in range(num_children)]}
+        if node_type == 1:
+            result.update({'instruction_type': kind, 'num_operands': detail, 'line': line})
+        elif node_type == 2:
+            result.update({'operand_type': kind, 'line': line, 'position': detail})
+        return result
+
+
+def count_json_nodes(node):
+    return 1 + sum(count_json_nodes(child) for child in node['children'])
+
+
+print(f"{'lines':>10} {'json (MB)':>12} {'bin (MB)':>12} {'json load (s)':>14} {'bin load (s)':>14} {'bin walk (s)':>14}")
+try:
+    for num_lines in args.sizes:
+        generate(num_lines)
+        with open(json_path, 'w') as output:
+            subprocess.run([executable_path, 'ast', source_path], stdout=output, check=True)
+        with open(binary_path, 'wb') as output:
+            subprocess.run([executable_path, 'ast', source_path, '--format=bin'], stdout=output, check=True)
+
+        start = time.perf_counter()
+        with open(json_path) as file:
+            json_tree = json.load(file)
+        json_nodes = count_json_nodes(json_tree)
+        json_seconds = time.perf_counter() - start
+
+        # Loading only maps the file and checks the header - the walk touches every node
+        start = time.perf_counter()
+        binary_tree = BinaryAST(binary_path)
+        load_seconds = time.perf_counter() - start
+        binary_nodes = binary_tree.count_nodes()
+        walk_seconds = time.perf_counter() - start
+
+        if binary_nodes != json_nodes or (num_lines <= 10000 and binary_tree.to_json() != json_tree):
+            print(f"Binary and JSON ASTs differ for {num_lines} lines")
+        print(f"{num_lines:>10} {os.path.getsize(json_path) / 1e6:>12.2f} {os.path.getsize(binary_path) / 1e6:>12.2f} "
+              f"{json_seconds:>14.3f} {load_seconds:>14.6f} {walk_seconds:>14.3f}")
+        del binary_tree
+finally:
+    # Remove the generated files
+    for path in [source_path, json_path, binary_path]:
+        try:
+            os.remove(path)
+        except FileNotFoundError:
+            pass
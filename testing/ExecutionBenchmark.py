@@ -0,0 +1,121 @@
+import os
+import statistics
+import subprocess
+import time
+import argparse
+
+# Set up argument parsing
+parser = argparse.ArgumentParser(description='Measure the cost of the runtime check levels (--checks=full|fast|none) on executables emitted by StartASM.')
+parser.add_argument('--iterations', type=int, default=10000000, help='Loop iterations of each program in the suite')
+parser.add_argument('--runs', type=int, default=5, help='Timed runs of each executable (the median is reported)')
+parser.add_argument('--opt', default='-O2', help='Optimization level the executables are compiled at')
+args = parser.parse_args()
+
+# Define the StartASM executable path
+executable_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'startasm')
+
+# Define the base path for the generated programs and executables
+base_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'ExecutionTest')
+
+levels = ['full', 'fast', 'none']
+
+
+def counted_loop(body, setup=()):
+    # Run the body the requested number of times, counting in r0 up to r2, then print the total in r3
+    return [
+        "create integer 0 to r0",
+        "create integer 1 to r1",
+        f"create integer {args.iterations} to r2",
+        "create integer 0 to r3",
+        *setup,
+        "label 'loop'",
+        *body,
+        "add r0 with r1 to r0",
+        "compare r0 with r2",
+        "jump if less to 'loop'",
+        "output r3",
+        "print newline",
+        "stop",
+    ]
+
+
+# Execution suite - every instruction of a loop body is type checked, the rest also checks divisors, addresses or the stack
+suite = {
+    'arithmetic': counted_loop([
+        "add r3 with r0 to r3",
+        "multiply r3 with r4 to r5",
+        "divide r5 with r4 to r5",
+        "sub r3 with r5 to r6",
+        "add r3 with r6 to r3",
+    ], setup=["create integer 7 to r4"]),
+    'memory': counted_loop([
+        "store r0 to r6",
+        "load r6 to r5",
+        "add r3 with r5 to r3",
+        "add r6 with r7 to r6",
+        "compare r6 with r8",
+        "jump if less to 'next'",
+        "create memory m<0> to r6",
+        "label 'next'",
+    ], setup=["create memory m<0> to r6", "create memory m<1> to r7", "create memory m<4096> to r8"]),
+    'calls': counted_loop([
+        "push r0",
+        "call to 'body'",
+        "pop to r5",
+        "add r3 with r5 to r3",
+    ]) + [
+        "label 'body'",
+        "pop to r9",
+        "pop to r5",
+        "add r5 with r1 to r5",
+        "push r5",
+        "push r9",
+        "return",
+    ],
+}
+
+
+def build(name, lines, level):
+    # Emit an executable of the program with the check level, returning its path
+    source = f"{base_path}_{name}.sasm"
+    output = f"{base_path}_{name}_{level}"
+    created.extend([source, output])
+    with open(source, 'w') as file:
+        file.write('\n'.join(lines) + '\n')
+    subprocess.run([executable_path, 'compile', source, '--emit=exe', '-o', output, f'--checks={level}', args.opt, '--silent'], check=True)
+    return output
+
+
+def timed_run(path):
+    # Median wall time of the runs, and the program's output
+    times = []
+    output = None
+    for _ in range(args.runs):
+        start = time.perf_counter()
+        result = subprocess.run([path], stdout=subprocess.PIPE, stdin=subprocess.DEVNULL, check=True)
+        times.append(time.perf_counter() - start)
+        output = result.stdout
+    return statistics.median(times), output
+
+
+created = []
+print(f"{'program':>12} {'full (s)':>10} {'fast (s)':>10} {'none (s)':>10} {'full/none':>10} {'fast/none':>10}  output")
+try:
+    for name, lines in suite.items():
+        times = {}
+        outputs = set()
+        for level in levels:
+            path = build(name, lines, level)
+            times[level], output = timed_run(path)
+            outputs.add(output)
+        # Checks never fail on these programs, so every level has to print the same result
+        same = 'match' if len(outputs) == 1 else 'MISMATCH'
+        print(f"{name:>12} {times['full']:>10.3f} {times['fast']:>10.3f} {times['none']:>10.3f} "
+              f"{times['full'] / times['none']:>10.2f} {times['fast'] / times['none']:>10.2f}  {same}")
+finally:
+    # Remove the generated programs and executables
+    for path in set(created):
+        try:
+            os.remove(path)
+        except FileNotFoundError:
+            pass
@@ -0,0 +1,149 @@
+import random
+import os
+import json
+import statistics
+import subprocess
+import time
+import argparse
+
+# Set up argument parsing
+parser = argparse.ArgumentParser(description='Measure StartASM language server (startasm lsp) latency on large documents and check its diagnostics against a full compile.')
+parser.add_argument('--sizes', type=int, nargs='+', default=[10000, 100000, 1000000], help='Number of lines of each generated document')
+parser.add_argument('--edits', type=int, default=50, help='Edits (and hover/definition requests) timed per size')
+args = parser.parse_args()
+
+# Define the StartASM executable path
+executable_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'startasm')
+
+# Define the full path for the final document, compiled to check the diagnostics
+check_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'LanguageServerTest.sasm')
+
+# Define some basic parameters
+registers = ['r' + str(i) for i in range(10)]  # List of registers r0-r9
+uri = 'file:///LanguageServerTest.sasm'
+
+
+def generate(num_lines):
+    # Create a valid program with a label every 100 lines and jumps between them
+    lines = []
+    for i in range(num_lines - 1):
+        if i % 100 == 0:
+            lines.append(f"label 'L{i}'")
+        elif i % 10 == 0:
+            lines.append(f"jump if zero to 'L{random.randrange(0, num_lines - 1, 100)}'")
+        else:
+            lines.append(f"add {random.choice(registers)} with {random.choice(registers)} to {random.choice(registers)}")
+    lines.append("stop")
+    return lines
+
+
+class Client:
+    # Minimal JSON-RPC client over the server's stdio
+    def __init__(self):
+        self.process = subprocess.Popen([executable_path, 'lsp'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.next_id = 1
+
+    def send(self, message):
+        body = json.dumps(message).encode()
+        self.process.stdin.write(b'Content-Length: %d\r\n\r\n' % len(body) + body)
+        self.process.stdin.flush()
+
+    def receive(self):
+        length = 0
+        while True:
+            header = self.process.stdout.readline().strip()
+            if not header:
+                break
+            if header.lower().startswith(b'content-length:'):
+                length = int(header.split(b':')[1])
+        return json.loads(self.process.stdout.read(length))
+
+    def request(self, method, params):
+        request_id = self.next_id
+        self.next_id += 1
+        self.send({'jsonrpc': '2.0', 'id': request_id, 'method': method, 'params': params})
+        while True:
+            message = self.receive()
+            if message.get('id') == request_id:
+                return message.get('result')
+
+    def notify(self, method, params):
+        self.send({'jsonrpc': '2.0', 'method': method, 'params': params})
+
+    def diagnostics(self):
+        while True:
+            message = self.receive()
+            if message.get('method') == 'textDocument/publishDiagnostics':
+                return message['params']['diagnostics']
+
+    def close(self):
+        self.request('shutdown', None)
+        self.notify('exit', None)
+        return self.process.wait()
+
+
+def timed(function):
+    start = time.perf_counter()
+    result = function()
+    return result, (time.perf_counter() - start) * 1000
+
+
+def compile_diagnostics(lines):
+    # Errors of a full compile, keyed the way the server reports them (the document has no blank lines)
+    # Type warnings come from inference over the whole program, which the server does not run
+    with open(check_path, 'w') as file:
+        file.write('\n'.join(lines) + '\n')
+    result = subprocess.run([executable_path, 'compile', check_path, '--diagnostics=json', '--silent', '--max-errors=1000'], stderr=subprocess.PIPE, stdout=subprocess.DEVNULL)
+    return sorted((d['line'] - 1, d['column'], d['length'], d['message']) for d in json.loads(result.stderr) if d['severity'] == 'error')
+
+
+print(f"{'lines':>10} {'open (ms)':>12} {'edit (ms)':>12} {'max edit':>12} {'hover (ms)':>12} {'definition':>12}  diagnostics")
+try:
+    for num_lines in args.sizes:
+        lines = generate(num_lines)
+        client = Client()
+        client.request('initialize', {'capabilities': {}})
+        client.notify('initialized', {})
+        _, open_time = timed(lambda: (client.notify('textDocument/didOpen', {'textDocument': {'uri': uri, 'languageId': 'startasm', 'version': 1, 'text': '\n'.join(lines) + '\n'}}), client.diagnostics()))
+
+        edit_times, hover_times, definition_times = [], [], []
+        published = []
+        for version in range(2, args.edits + 2):
+            line = random.randrange(len(lines))
+            # Alternate between breaking a line (undefined labels, bad registers) and inserting or deleting one
+            choice = random.random()
+            if choice < 0.4:
+                text = random.choice(["jump if zero to 'nowhere'", "add r12 with r1 to r2", "move r1 to r2"])
+                change = {'range': {'start': {'line': line, 'character': 0}, 'end': {'line': line, 'character': len(lines[line])}}, 'text': text}
+                lines[line] = text
+            elif choice < 0.7:
+                change = {'range': {'start': {'line': line, 'character': 0}, 'end': {'line': line, 'character': 0}}, 'text': "move r1 to r2\n"}
+                lines.insert(line, "move r1 to r2")
+            else:
+                change = {'range': {'start': {'line': line, 'character': 0}, 'end': {'line': line + 1, 'character': 0}}, 'text': ""}
+                del lines[line]
+            (_, published), edit_time = timed(lambda: (client.notify('textDocument/didChange', {'textDocument': {'uri': uri, 'version': version}, 'contentChanges': [change]}), client.diagnostics()))
+            edit_times.append(edit_time)
+
+            # Hover and go to definition on the last token of a jump
+            jumps = [i for i in range(line, min(line + 20, len(lines))) if lines[i].startswith('jump')]
+            if jumps:
+                position = {'line': jumps[0], 'character': len(lines[jumps[0]]) - 2}
+                params = {'textDocument': {'uri': uri}, 'position': position}
+                hover_times.append(timed(lambda: client.request('textDocument/hover', params))[1])
+                definition_times.append(timed(lambda: client.request('textDocument/definition', params))[1])
+
+        # The last publication has to match a full compile of the final document
+        final = sorted((d['range']['start']['line'], d['range']['start']['character'], d['range']['end']['character'] - d['range']['start']['character'], d['message']) for d in published)
+        matches = final == compile_diagnostics(lines)
+        client.close()
+
+        hover = statistics.median(hover_times) if hover_times else 0
+        definition = statistics.median(definition_times) if definition_times else 0
+        print(f"{num_lines:>10} {open_time:>12.1f} {statistics.median(edit_times):>12.2f} {max(edit_times):>12.2f} {hover:>12.2f} {definition:>12.2f}  {'match' if matches else 'MISMATCH'} ({len(final)})")
+finally:
+    # Remove the generated check file
+    try:
+        os.remove(check_path)
+    except FileNotFoundError:
+        pass
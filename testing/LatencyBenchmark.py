@@ -0,0 +1,78 @@
+import random
+import os
+import statistics
+import subprocess
+import time
+import argparse
+
+# Set up argument parsing
+parser = argparse.ArgumentParser(description='Measure StartASM end-to-end latency in serial, parallel and auto (cost model) modes.')
+parser.add_argument('--sizes', type=int, nargs='+', default=[10, 100, 10000, 1000000], help='Number of lines of each generated input')
+parser.add_argument('--runs', type=int, default=5, help='Runs per size and mode (the median is reported)')
+parser.add_argument('--jobs', type=int, default=0, help='Value passed to --jobs (0 keeps the compiler default)')
+parser.add_argument('--command', default='compile', choices=['compile', 'ast'], help='Compiler subcommand to time')
+args = parser.parse_args()
+
+# Define the StartASM executable path
+executable_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'startasm')
+
+# Define the full path for the generated input file
+stress_test_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'LatencyTest.sasm')
+
+# Define some basic parameters
+registers = ['r' + str(i) for i in range(10)]  # List of registers r0-r9
+operations = ['add', 'sub', 'multiply', 'divide', 'move', 'load', 'store']
+modes = ['serial', 'parallel', 'auto']
+
+
+def generate(num_lines):
+    # Create a valid program of exactly num_lines lines
+    with open(stress_test_path, 'w') as file:
+        file.write("comment \"Automatically generated latency benchmark input\"\n")
+        for _ in range(max(num_lines - 2, 0)):
+            reg1 = random.choice(registers)
+            reg2 = random.choice(registers)
+            operation = random.choice(operations)
+            value = random.randint(0, 1000)
+            if operation in ['add', 'sub', 'multiply', 'divide']:
+                line = f"{operation} {reg1} with {reg2} to {random.choice(registers)}"
+            elif operation == 'move':
+                line = f"move {reg1} to {reg2}"
+            elif operation == 'load':
+                line = f"load m<{value}> to {reg1}"
+            else:
+                line = f"store {reg1} to m<{value}>"
+            file.write(line + '\n')
+        file.write("stop\n")
+
+
+def measure(mode):
+    # Wall time of the whole process, as seen by a caller such as an editor integration
+    cli_args = [args.command, stress_test_path, "--truesilent", f"--parallelism={mode}"]
+    if args.jobs > 0:
+        cli_args.append(f"--jobs={args.jobs}")
+    samples = []
+    for _ in range(args.runs):
+        start = time.perf_counter()
+        result = subprocess.run([executable_path] + cli_args, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        samples.append(time.perf_counter() - start)
+        if result.returncode != 0:
+            print(f"Compiler failed in {mode} mode")
+            break
+    return statistics.median(samples)
+
+
+print(f"{'lines':>10} " + " ".join(f"{mode + ' (ms)':>14}" for mode in modes))
+try:
+    for num_lines in args.sizes:
+        generate(num_lines)
+        # Warm up the page cache and the cost model calibration
+        measure('auto')
+        results = [measure(mode) for mode in modes]
+        print(f"{num_lines:>10} " + " ".join(f"{seconds * 1000:>14.2f}" for seconds in results))
+finally:
+    # Remove the generated input file
+    try:
+        os.remove(stress_test_path)
+    except FileNotFoundError:
+        pass
@@ -0,0 +1,108 @@
+import random
+import os
+import json
+import subprocess
+import argparse
+
+# Set up argument parsing
+parser = argparse.ArgumentParser(description='Check that the pipelined front end (--pipeline) reports the same diagnostics and AST as the batch passes, with and without --max-errors.')
+parser.add_argument('--lines', type=int, default=50000, help='Number of lines of each generated program')
+parser.add_argument('--caps', type=int, nargs='+', default=[1, 5, 50], help='--max-errors values to check')
+parser.add_argument('--repeats', type=int, default=3, help='Runs of each configuration, as thread timing may change the result')
+args = parser.parse_args()
+
+# Define the StartASM executable path
+executable_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'startasm')
+
+# Define the full path for the generated program
+test_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'PipelineTest.sasm')
+
+# Define some basic parameters
+registers = ['r' + str(i) for i in range(10)]  # List of registers r0-r9
+jobs = str(max(2, os.cpu_count() or 1))
+# Batch and pipelined front ends, each on a single thread and forced onto several
+configurations = {
+    'batch': ['--jobs=1'],
+    'batch parallel': ['--jobs=' + jobs, '--parallelism=parallel'],
+    'pipeline': ['--pipeline', '--jobs=1'],
+    'pipeline parallel': ['--pipeline', '--jobs=' + jobs, '--parallelism=parallel'],
+}
+
+
+def generate(num_lines, errors):
+    # Create a program with a label every 100 lines, seeded with the given kinds of errors every few hundred lines
+    lines = []
+    for i in range(num_lines - 1):
+        kind = random.choice(errors) if errors and random.random() < 0.005 else None
+        if kind == 'syntax':
+            lines.append(f"{random.choice(registers)} add")
+        elif kind == 'labels':
+            lines.append(random.choice([f"label 'L{random.randrange(0, num_lines - 1, 100)}'", "jump if zero to 'Undefined'"]))
+        elif kind == 'scope':
+            lines.append(random.choice(["move r1 to r12", "load m<99999999999> to r1", f"jump if zero to i[{num_lines * 2}]"]))
+        elif kind == 'semantics':
+            lines.append(f"create integer 5 to {random.randint(0, 1000)}")
+        elif i % 100 == 0:
+            lines.append(f"label 'L{i}'")
+        elif i % 10 == 0:
+            lines.append(f"jump if zero to 'L{random.randrange(0, num_lines - 1, 100)}'")
+        else:
+            lines.append(f"add {random.choice(registers)} with {random.choice(registers)} to {random.choice(registers)}")
+    lines.append("stop")
+    return lines
+
+
+def run(command, options):
+    result = subprocess.run([executable_path, command, test_path] + options, capture_output=True, text=True)
+    return result.returncode, result.stdout, result.stderr
+
+
+# Each kind of error hides the ones after it, so every program stops at a different phase
+programs = {
+    'valid': [],
+    'checks': ['scope', 'semantics'],
+    'labels': ['labels', 'scope', 'semantics'],
+    'syntax': ['syntax', 'labels', 'scope', 'semantics'],
+}
+
+failures = 0
+print(f"{'program':>10} {'cap':>6} {'errors':>8}  result")
+for name, errors in programs.items():
+    with open(test_path, 'w') as file:
+        file.write('\n'.join(generate(args.lines, errors)) + '\n')
+
+    # The AST of a valid program is the same however it was built
+    if not errors:
+        outputs = {run('ast', options)[1] for options in configurations.values() for _ in range(args.repeats)}
+        result = 'match' if len(outputs) == 1 else 'MISMATCH'
+        failures += result != 'match'
+        print(f"{name:>10} {'-':>6} {0:>8}  AST {result}")
+
+    # Without a cap every diagnostic is reported, with one the first ones in phase and line order
+    baseline = json.loads(run('compile', ['--diagnostics=json', '--jobs=1'])[2] or '[]')
+    for cap in [0] + args.caps:
+        options = ['--diagnostics=json'] + ([f'--max-errors={cap}'] if cap > 0 else [])
+        outputs = {run('compile', options + configuration) for configuration in configurations.values() for _ in range(args.repeats)}
+        diagnostics = json.loads(next(iter(outputs))[2] or '[]')
+        expected = [diagnostic for diagnostic in baseline if diagnostic['severity'] == 'error'][:cap if cap > 0 else None]
+        reported = [diagnostic for diagnostic in diagnostics if diagnostic['severity'] == 'error']
+        if len(outputs) != 1:
+            result = 'MISMATCH'
+        elif reported != expected:
+            result = 'NOT FIRST ERRORS'
+        else:
+            result = 'match'
+        failures += result != 'match'
+        print(f"{name:>10} {cap if cap > 0 else '-':>6} {len(reported):>8}  {result}")
+
+# Remove the generated program
+try:
+    os.remove(test_path)
+except FileNotFoundError:
+    print("File not found error deleting test file")
+except PermissionError:
+    print("Permission error deleting test file")
+except Exception as e:
+    print(f"Other error deleting test file: {e}")
+
+exit(1 if failures else 0)